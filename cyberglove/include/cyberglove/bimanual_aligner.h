@@ -0,0 +1,101 @@
+/**
+ * @file   bimanual_aligner.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Aligns the streams of two gloves on a common timebase.
+ *
+ * Both gloves are sampled on their own serial clock: their frames can't be
+ * paired one to one. The frames received on left/raw/frames and
+ * right/raw/frames are resampled at the same tick times, ~rate ticks
+ * per second, ~alignment_delay in the past so that both gloves have
+ * usually sent a frame after the tick (the frames are interpolated rather
+ * than held). Each tick is published as a BimanualFrame on bimanual_frame,
+ * with the alignment error of each glove.
+ *
+ * A glove silent for more than ~max_hold stops the frames until it's back.
+ *
+ */
+
+#ifndef   	BIMANUAL_ALIGNER_H_
+# define   	BIMANUAL_ALIGNER_H_
+
+#include <ros/ros.h>
+#include <string>
+#include <sensor_msgs/JointState.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+#include "cyberglove/BimanualFrame.h"
+#include "cyberglove/GloveFrame.h"
+#include "cyberglove/stream_resampler.h"
+#include "cyberglove/sequence_tracker.h"
+
+namespace cyberglove
+{
+  class BimanualAligner
+  {
+  public:
+    BimanualAligner();
+
+  private:
+    enum Side {LEFT, RIGHT, NB_SIDES};
+
+    ros::NodeHandle node, n_tilde;
+
+    /// the subscribers and the frames received from each glove
+    ros::Subscriber joint_states_subs[NB_SIDES];
+    StreamResampler resamplers[NB_SIDES];
+    ///the frames ignored because they were older than the previous one
+    unsigned int nb_out_of_order[NB_SIDES];
+    ///the frame numbers received from each glove: the gaps are the frames lost before the aligner
+    SequenceTracker received_frames[NB_SIDES];
+
+    ros::Publisher frame_pub;
+    ros::Publisher diagnostics_pub;
+    ros::Timer tick_timer;
+    ros::Timer diagnostics_timer;
+
+    /// the frame published at each tick (the joint names are set by the first frames received)
+    cyberglove::BimanualFrame frame;
+
+    ros::Duration alignment_delay;
+    double max_hold;
+
+    /// the alignment errors since the last diagnostics
+    double error_sum, error_max;
+    unsigned int nb_frames, nb_stale_ticks;
+
+    void frame_received(const cyberglove::GloveFrameConstPtr& msg, Side side);
+
+    /**
+     * Resamples both gloves at the time of the tick (minus alignment_delay)
+     * and publishes the frame.
+     */
+    void tick(const ros::TimerEvent& event);
+
+    void publish_diagnostics(const ros::TimerEvent& event);
+  };
+}
+
+#endif 	    /* !BIMANUAL_ALIGNER_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,108 @@
+/**
+ * @file   calibration_cache.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief A binary cache of the calibration lookup tables, so that they don't
+ * need to be rebuilt each time a node starts.
+ *
+ * The cache file contains a header followed by the tables:
+ *   - header: magic "CYBGCAL", format version, table size, number of joints,
+ *     hash of the source calibration, FNV-1a checksum of the tables.
+ *   - for each joint: the length of its name (uint32), the name, and the
+ *     table (table size floats).
+ * It is written in the native byte order: it is meant to be used on the
+ * machine which wrote it. A cache which doesn't match the source calibration,
+ * the format version or the table size, or which is corrupted, is ignored.
+ *
+ */
+
+#ifndef   	CALIBRATION_CACHE_H_
+# define   	CALIBRATION_CACHE_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+namespace cyberglove
+{
+  class CalibrationCache
+  {
+  public:
+    typedef std::map<std::string, std::vector<float> > TableMap;
+
+    /// Increase each time the format of the file or the content of the tables changes.
+    static const boost::uint32_t version;
+
+    /// The initial value of the FNV-1a hash.
+    static const boost::uint64_t hash_seed;
+
+    /**
+     * Computes the 64 bits FNV-1a hash of some data.
+     *
+     * @param data the data to hash
+     * @param size the size of the data (in bytes)
+     * @param seed the hash of the data preceding these ones, to hash
+     *             several blocks of data. hash_seed for the first one.
+     *
+     * @return the hash
+     */
+    static boost::uint64_t hash(const void* data, std::size_t size, boost::uint64_t seed = hash_seed);
+
+    /**
+     * Loads the tables from a cache file. The file is mapped in memory and
+     * validated before any table is read.
+     *
+     * @param path the path to the cache file
+     * @param source_hash the hash of the source calibration
+     * @param table_size the expected size of each table
+     * @param tables where the tables are written. Only modified if the
+     *               cache is valid.
+     *
+     * @return true if the cache was valid and loaded, false otherwise (no
+     *         file, other source, other version, corrupted...)
+     */
+    static bool load(const std::string& path, boost::uint64_t source_hash,
+                     unsigned int table_size, TableMap& tables);
+
+    /**
+     * Writes the tables to a cache file. The file is written next to its
+     * final location then renamed, so that another node never reads a
+     * partially written cache.
+     *
+     * @param path the path to the cache file
+     * @param source_hash the hash of the source calibration
+     * @param table_size the size of each table
+     * @param tables the tables
+     *
+     * @return true if the cache was written
+     */
+    static bool save(const std::string& path, boost::uint64_t source_hash,
+                     unsigned int table_size, const TableMap& tables);
+  };
+}
+
+#endif 	    /* !CALIBRATION_CACHE_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
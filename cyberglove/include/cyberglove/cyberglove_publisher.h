@@ -22,8 +22,8 @@
  * @brief The goal of this ROS publisher is to publish raw and calibrated
  * joint positions from the cyberglove at a regular time interval. We're
  * oversampling to get a better accuracy on our data.
- * To publish those data, just call the publish()
- * function.
+ * The raw and calibrated data are published at their own frequency, clocked
+ * by a PublishScheduler.
  *
  *
  */
@@ -32,13 +32,24 @@
 # define   	CYBERGLOVE_PUBLISHER_H_
 
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 #include <vector>
 #include <boost/smart_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/atomic.hpp>
 
 #include "cyberglove/serial_glove.hpp"
+#include "cyberglove/thread_config.h"
+#include "cyberglove/sample_accumulator.h"
+#include "cyberglove/publish_scheduler.h"
+#include "cyberglove/glove_joints.h"
+#include "cyberglove/sequence_tracker.h"
+#include "cyberglove/glove_clock.h"
 
 //messages
 #include <sensor_msgs/JointState.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include "cyberglove/GloveFrame.h"
 #include "cyberglove/xml_calibration_parser.h"
 
 using namespace ros;
@@ -58,14 +69,26 @@ namespace cyberglove{
     void initialize_calibration(std::string path_to_calibration);
     bool isPublishing();
     void setPublishing(bool value);
+
+    /**
+     * The callback queue for the services and parameters of the node. It is
+     * served by the service thread, never by the serial thread.
+     *
+     * @return the service callback queue
+     */
+    CallbackQueue* get_service_queue();
   private:
     /////////////////
     //  CALLBACKS  //
     /////////////////
 
+    /// The queue for the services and parameters, served by service_spinner.
+    CallbackQueue service_queue;
+    /// The spinner serving service_queue from its own thread.
+    boost::scoped_ptr<AsyncSpinner> service_spinner;
+
     //ros node handle
     NodeHandle node, n_tilde;
-    unsigned int publish_counter_max, publish_counter_index;
 
     ///the actual connection with the cyberglove is done here.
     boost::shared_ptr<CybergloveSerial> serial_glove;
@@ -77,25 +100,94 @@ namespace cyberglove{
      *
      * @param glove_pos A vector containing the current raw joints positions.
      * @param light_on true if the light is on, false otherwise.
+     * @param seq the sequence number of the frame
      */
-    void glove_callback(std::vector<float> glove_pos, bool light_on);
+    void glove_callback(std::vector<float> glove_pos, bool light_on, unsigned int seq);
+
+    /// Clocks the raw, calibrated and diagnostics outputs.
+    PublishScheduler scheduler;
+
+    ///the samples received since the last raw / calibrated publication
+    boost::scoped_ptr<SampleAccumulator> raw_samples, calibrated_samples;
+
+    /**
+     * The frames published on each output: the missing ones were merged by
+     * the averaging, or received while the output wasn't subscribed.
+     */
+    SequenceTracker raw_frames, calibrated_frames;
+
+    /**
+     * Timestamps the frames from the glove's sampling clock (if ~glove_clock
+     * is true), rather than when they're published.
+     */
+    boost::scoped_ptr<GloveClock> glove_clock;
+
+    /**
+     * Are the raw / calibrated outputs subscribed? The samples are only
+     * accumulated, calibrated and published for the subscribed outputs.
+     */
+    boost::atomic<bool> raw_subscribed, calibrated_subscribed;
+
+    /**
+     * Called each time a subscriber connects to or disconnects from one of the
+     * outputs (including intra-process subscribers, e.g. nodelets): updates
+     * raw_subscribed and calibrated_subscribed. An output is subscribed if its
+     * joint_states or its frames are.
+     */
+    void subscribers_changed();
+
+    /**
+     * Publishes the raw data. Called by the scheduler.
+     *
+     * @return true if a message was published, false if no sample was received
+     *         since the last call
+     */
+    bool publish_raw();
+
+    /**
+     * Calibrates and publishes the data. Called by the scheduler.
+     *
+     * @return true if a message was published, false if no sample was received
+     *         since the last call
+     */
+    bool publish_calibrated();
+
+    /**
+     * Publishes the diagnostics (achieved rates, number of messages received).
+     * Called by the scheduler.
+     *
+     * @return true
+     */
+    bool publish_diagnostics();
 
     std::string path_to_glove;
     bool publishing;
 
     ///the calibration parser
     xml_calibration_parser::XmlCalibrationParser calibration_parser;
+    ///protects the calibration parser, which can be reloaded from the service thread
+    boost::mutex calibration_mutex;
+    ///cache the calibration lookup tables next to the calibration file
+    bool cache_calibration;
+
+    ///when the node started, and whether a calibrated frame was published since then
+    ros::WallTime startup_time;
+    bool first_frame_published;
 
     Publisher cyberglove_raw_pub;
+    Publisher diagnostics_pub;
+    ///the same frames as the joint_states, with their frame number
+    Publisher cyberglove_frames_pub, cyberglove_raw_frames_pub;
 
     sensor_msgs::JointState jointstate_msg;
     sensor_msgs::JointState jointstate_raw_msg;
+    cyberglove::GloveFrame frame_msg, raw_frame_msg;
 
-    void add_jointstate(float position, std::string joint_name);
-
+    ///the calibrated values of the current frame
     std::vector<float> calibration_values;
 
-    std::vector<std::vector<float> > glove_positions;
+    ///the averaged (or latest) samples, filled at each tick
+    std::vector<float> raw_positions, calibrated_positions;
 
     std::string cyberglove_version_;
     std::string streaming_protocol_;
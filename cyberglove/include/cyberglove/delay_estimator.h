@@ -0,0 +1,80 @@
+/**
+ * @file   delay_estimator.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief The distribution of the last measured delays.
+ *
+ * The delays are added from one thread (e.g. a subscriber) and their
+ * percentiles read from another one: the last window_size delays are kept
+ * in a ring buffer.
+ *
+ */
+
+#ifndef   	DELAY_ESTIMATOR_H_
+# define   	DELAY_ESTIMATOR_H_
+
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace cyberglove
+{
+  class DelayEstimator : boost::noncopyable
+  {
+  public:
+    /**
+     * @param window_size the number of delays the percentiles are computed on
+     */
+    DelayEstimator(unsigned int window_size);
+
+    /**
+     * Adds a measured delay, replacing the oldest one if the window is full.
+     */
+    void add(double delay);
+
+    /**
+     * A percentile of the delays in the window.
+     *
+     * @param ratio the percentile, in [0, 1] (e.g. 0.99)
+     * @param delay where the percentile is written, left untouched if no delay
+     *        was measured
+     *
+     * @return false if no delay was measured
+     */
+    bool percentile(double ratio, double& delay);
+
+    /// the number of delays measured since the construction
+    unsigned int get_nb_delays();
+
+  private:
+    boost::mutex mutex_;
+    std::vector<double> delays_;
+    unsigned int window_size_, next_, nb_delays_;
+    ///where the delays are sorted to compute the percentiles
+    std::vector<double> sorted_;
+  };
+}
+
+#endif 	    /* !DELAY_ESTIMATOR_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,133 @@
+/**
+ * @file   glove_clock.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief A model of the glove's sampling clock, giving each frame a
+ * timestamp without the jitter of its arrival.
+ *
+ * The glove samples on a fixed period, but the frames arrive with the
+ * jitter of the USB batching and of the scheduling of the serial thread.
+ * Each frame gets a sample index: the previous one plus the gap in the
+ * frame numbers (the frames rejected by the parser were sampled too), plus
+ * the samples missed if the frames arrive more than half a period late
+ * (beyond the usual jitter). A single late frame is a stall of the serial
+ * thread, not a lost sample: the offset is only applied once confirmation
+ * frames in a row arrive with it (the frames until then are timestamped by
+ * the model and kept out of the regression), and the frames arriving as
+ * early undo it. The arrival times are fitted against the
+ * sample indexes by a linear regression, the older frames weighing less
+ * and less (exponential forgetting over ~window frames): the fitted line
+ * gives the timestamp of each frame, and its slope the actual period. The
+ * timestamps keep the mean transmission delay of the frames, not its jitter.
+ *
+ * Until warmup frames were received, the arrival times are used as they
+ * are. A frame arriving more than max_gap away from the model (e.g. the
+ * glove was restarted) restarts it.
+ *
+ */
+
+#ifndef   	GLOVE_CLOCK_H_
+# define   	GLOVE_CLOCK_H_
+
+#include <boost/thread/mutex.hpp>
+#include <boost/noncopyable.hpp>
+#include <diagnostic_msgs/DiagnosticStatus.h>
+
+namespace cyberglove
+{
+  class GloveClock : boost::noncopyable
+  {
+  public:
+    /**
+     * @param nominal_period the sampling period set on the glove (s)
+     * @param window the number of frames the regression is (mostly) computed on
+     * @param warmup the number of frames before the model is used
+     * @param max_gap the largest distance from the model (s) before it's restarted
+     * @param confirmation the number of frames in a row arriving a period (or
+     *        more) off the model before samples are counted as missed
+     */
+    GloveClock(double nominal_period, unsigned int window = 500, unsigned int warmup = 20, double max_gap = 0.5,
+               unsigned int confirmation = 3);
+
+    /**
+     * Adds a frame to the model. Called from the serial thread.
+     *
+     * @param arrival when the frame was received (s)
+     * @param seq the frame's sequence number
+     *
+     * @return the frame's timestamp (s)
+     */
+    double update(double arrival, unsigned int seq);
+
+    /// the fitted sampling period (s), the nominal one during the warmup
+    double get_period();
+
+    /// the standard deviation of the arrival times around the model (s)
+    double get_jitter();
+
+    /// the samples which never arrived, not even as a rejected frame
+    unsigned long get_nb_missed();
+
+    /**
+     * Adds the period, jitter, missed samples and restarts of the model to
+     * the status.
+     */
+    void add_diagnostics(diagnostic_msgs::DiagnosticStatus& status);
+
+  private:
+    /// restarts the model from a frame
+    void restart(double arrival, unsigned int seq);
+
+    /// the arrival time the model fits to a sample index (relative to the first frame)
+    double fit(double index) const;
+
+    boost::mutex mutex_;
+
+    double nominal_period_, forgetting_, max_gap_;
+    unsigned int warmup_, confirmation_;
+
+    /// the arrival time of the first frame: the times are relative to it
+    double origin_;
+    /// the sample index and sequence number of the last frame
+    double index_;
+    unsigned int seq_;
+    unsigned int nb_frames_;
+
+    /// the weighted means and (co)variances of the indexes and times
+    double weight_, mean_index_, mean_time_, var_index_, covar_;
+    /// the exponential average of the squared residuals
+    double residual_var_;
+
+    /// the offset (in samples) of the last frames from the model, and the number of them in a row
+    double pending_offset_;
+    unsigned int nb_pending_;
+    /// the samples added to the indexes since the restart (the most that can be undone)
+    double shift_;
+
+    unsigned long nb_missed_, nb_restarts_;
+  };
+}
+
+#endif 	    /* !GLOVE_CLOCK_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,214 @@
+/**
+ * @file   glove_joints.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief The sensors of the glove and the joints of the hand, with their
+ * index in the glove frames / hand vectors and their names.
+ *
+ * The enums give the index of each sensor / joint, so that the per frame
+ * processing never looks anything up by name. The names are only used to
+ * fill the messages and to read the calibration.
+ *
+ * There are two sets of hand joints:
+ *   - mapped_joints: the joints the mapping matrix (see CalibrationParser)
+ *     remaps the glove to. J1 and J2 of the fingers are coupled in a J0.
+ *   - hand_joints: the joints of the hand, as sent to the controllers. The
+ *     J0s are split in J1 and J2.
+ *
+ */
+
+#ifndef   	GLOVE_JOINTS_H_
+# define   	GLOVE_JOINTS_H_
+
+#include <boost/static_assert.hpp>
+
+namespace cyberglove
+{
+  namespace glove_sensors
+  {
+    /// The sensors of the glove, in the order they're streamed.
+    enum sensor
+    {
+      THUMB_ROTATE,
+      THUMB_MPJ,
+      THUMB_IJ,
+      THUMB_AB,
+      INDEX_MPJ,
+      INDEX_PIJ,
+      INDEX_DIJ,
+      MIDDLE_MPJ,
+      MIDDLE_PIJ,
+      MIDDLE_DIJ,
+      MIDDLE_INDEX_AB,
+      RING_MPJ,
+      RING_PIJ,
+      RING_DIJ,
+      RING_MIDDLE_AB,
+      PINKIE_MPJ,
+      PINKIE_PIJ,
+      PINKIE_DIJ,
+      PINKIE_RING_AB,
+      PALM_ARCH,
+      WRIST_PITCH,
+      WRIST_YAW,
+      NB_SENSORS
+    };
+
+    static const char* const names[] = {
+      "G_ThumbRotate",
+      "G_ThumbMPJ",
+      "G_ThumbIJ",
+      "G_ThumbAb",
+      "G_IndexMPJ",
+      "G_IndexPIJ",
+      "G_IndexDIJ",
+      "G_MiddleMPJ",
+      "G_MiddlePIJ",
+      "G_MiddleDIJ",
+      "G_MiddleIndexAb",
+      "G_RingMPJ",
+      "G_RingPIJ",
+      "G_RingDIJ",
+      "G_RingMiddleAb",
+      "G_PinkieMPJ",
+      "G_PinkiePIJ",
+      "G_PinkieDIJ",
+      "G_PinkieRingAb",
+      "G_PalmArch",
+      "G_WristPitch",
+      "G_WristYaw"
+    };
+    BOOST_STATIC_ASSERT(sizeof(names) / sizeof(names[0]) == NB_SENSORS);
+  }
+
+  namespace hand_joints
+  {
+    /// The joints of the hand, as sent to the controllers.
+    enum joint
+    {
+      THJ1,
+      THJ2,
+      THJ3,
+      THJ4,
+      THJ5,
+      FFJ1,
+      FFJ2,
+      FFJ3,
+      FFJ4,
+      MFJ1,
+      MFJ2,
+      MFJ3,
+      MFJ4,
+      RFJ1,
+      RFJ2,
+      RFJ3,
+      RFJ4,
+      LFJ1,
+      LFJ2,
+      LFJ3,
+      LFJ4,
+      LFJ5,
+      WRJ1,
+      WRJ2,
+      NB_JOINTS
+    };
+
+    static const char* const names[] = {
+      "THJ1", "THJ2", "THJ3", "THJ4", "THJ5",
+      "FFJ1", "FFJ2", "FFJ3", "FFJ4",
+      "MFJ1", "MFJ2", "MFJ3", "MFJ4",
+      "RFJ1", "RFJ2", "RFJ3", "RFJ4",
+      "LFJ1", "LFJ2", "LFJ3", "LFJ4", "LFJ5",
+      "WRJ1", "WRJ2"
+    };
+    BOOST_STATIC_ASSERT(sizeof(names) / sizeof(names[0]) == NB_JOINTS);
+  }
+
+  namespace mapped_joints
+  {
+    /// The joints the mapping matrix remaps the glove to (the rows of the matrix).
+    enum joint
+    {
+      THJ1,
+      THJ2,
+      THJ3,
+      THJ4,
+      THJ5,
+      FFJ0,
+      FFJ3,
+      FFJ4,
+      MFJ0,
+      MFJ3,
+      MFJ4,
+      RFJ0,
+      RFJ3,
+      RFJ4,
+      LFJ0,
+      LFJ3,
+      LFJ4,
+      LFJ5,
+      WRJ1,
+      WRJ2,
+      NB_JOINTS
+    };
+
+    static const char* const names[] = {
+      "THJ1", "THJ2", "THJ3", "THJ4", "THJ5",
+      "FFJ0", "FFJ3", "FFJ4",
+      "MFJ0", "MFJ3", "MFJ4",
+      "RFJ0", "RFJ3", "RFJ4",
+      "LFJ0", "LFJ3", "LFJ4", "LFJ5",
+      "WRJ1", "WRJ2"
+    };
+    BOOST_STATIC_ASSERT(sizeof(names) / sizeof(names[0]) == NB_JOINTS);
+
+    /**
+     * The hand joint each mapped joint is written to. A J0 is split in
+     * halves between this joint (J1) and the next one (J2).
+     */
+    static const int to_hand_joint[] = {
+      hand_joints::THJ1, hand_joints::THJ2, hand_joints::THJ3, hand_joints::THJ4, hand_joints::THJ5,
+      hand_joints::FFJ1, hand_joints::FFJ3, hand_joints::FFJ4,
+      hand_joints::MFJ1, hand_joints::MFJ3, hand_joints::MFJ4,
+      hand_joints::RFJ1, hand_joints::RFJ3, hand_joints::RFJ4,
+      hand_joints::LFJ1, hand_joints::LFJ3, hand_joints::LFJ4, hand_joints::LFJ5,
+      hand_joints::WRJ1, hand_joints::WRJ2
+    };
+    BOOST_STATIC_ASSERT(sizeof(to_hand_joint) / sizeof(to_hand_joint[0]) == NB_JOINTS);
+
+    /// Is the mapped joint a J0 (J1 + J2 of a finger)?
+    static const bool is_j0[] = {
+      false, false, false, false, false,
+      true, false, false,
+      true, false, false,
+      true, false, false,
+      true, false, false, false,
+      false, false
+    };
+    BOOST_STATIC_ASSERT(sizeof(is_j0) / sizeof(is_j0[0]) == NB_JOINTS);
+  }
+}
+
+#endif 	    /* !GLOVE_JOINTS_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
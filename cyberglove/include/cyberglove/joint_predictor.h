@@ -0,0 +1,125 @@
+/**
+ * @file   joint_predictor.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Predicts where the joints will be a short time ahead.
+ *
+ * Each joint is predicted independently from the frames received so far:
+ *  - constant velocity: the velocity is the (smoothed) difference between
+ *    the last two frames.
+ *  - constant acceleration: the acceleration is estimated the same way from
+ *    the velocities.
+ *  - kalman: a constant velocity kalman filter, the acceleration being the
+ *    process noise. It is less sensitive to the noise of the glove.
+ *
+ * The predictions are used to compensate the transport delay to the hand,
+ * they should only be made a few frames ahead.
+ *
+ */
+
+#ifndef   	JOINT_PREDICTOR_H_
+# define   	JOINT_PREDICTOR_H_
+
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace cyberglove
+{
+  namespace predictor_types
+  {
+    enum predictor_type
+    {
+      NONE,
+      CONSTANT_VELOCITY,
+      CONSTANT_ACCELERATION,
+      KALMAN
+    };
+  }
+
+  class JointPredictor : boost::noncopyable
+  {
+  public:
+    /**
+     * @param size the number of joints
+     * @param type the prediction model
+     * @param smoothing the weight of the previous estimate when the velocity
+     *        and acceleration are updated, in [0, 1[ (0: no smoothing)
+     * @param process_noise the variance of the acceleration, for the kalman
+     *        filter (rad^2/s^4)
+     * @param measurement_noise the variance of the positions received, for
+     *        the kalman filter (rad^2)
+     */
+    JointPredictor(unsigned int size, predictor_types::predictor_type type, double smoothing = 0.5,
+                   double process_noise = 1000.0, double measurement_noise = 1e-4);
+
+    /**
+     * Reads a predictor type: "none", "constant_velocity",
+     * "constant_acceleration" or "kalman".
+     *
+     * @return false if the name is unknown (type is left untouched)
+     */
+    static bool parse_type(const std::string& name, predictor_types::predictor_type& type);
+
+    /**
+     * Updates the estimates with a new frame.
+     *
+     * @param time when the positions were measured (s)
+     * @param positions the positions of the joints, must contain size values
+     */
+    void update(double time, const std::vector<double>& positions);
+
+    /**
+     * Predicts the positions from the last frame received.
+     *
+     * @param horizon how long after the last frame (s)
+     * @param positions where the predicted positions are written. They're left
+     *        untouched if no frame was received.
+     */
+    void predict(double horizon, std::vector<double>& positions) const;
+
+    /**
+     * Forgets the previous frames, e.g. when they come from a different
+     * calibration.
+     */
+    void reset();
+
+    predictor_types::predictor_type get_type() const { return type_; };
+
+  private:
+    predictor_types::predictor_type type_;
+    double smoothing_, process_noise_, measurement_noise_;
+
+    unsigned int nb_updates_;
+    double last_time_;
+
+    ///the estimates for each joint
+    std::vector<double> position_, velocity_, acceleration_;
+    ///the covariance of the kalman filter's (position, velocity) estimate
+    std::vector<double> p00_, p01_, p11_;
+  };
+}
+
+#endif 	    /* !JOINT_PREDICTOR_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,98 @@
+/**
+ * @file   message_pool.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Preallocated messages, published as shared pointers.
+ *
+ * A message published as a shared pointer is passed as is to the intra
+ * process subscribers (no serialization), which can keep it as long as they
+ * want: it must not be modified once published. The pool only hands out
+ * again a message nobody else references anymore; the fields which don't
+ * change (names, sizes) are set once in the prototype and only the values
+ * need to be rewritten at each frame.
+ *
+ */
+
+#ifndef   	MESSAGE_POOL_H_
+# define   	MESSAGE_POOL_H_
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace cyberglove
+{
+  template <class M>
+  class MessagePool : boost::noncopyable
+  {
+  public:
+    typedef boost::shared_ptr<M> MessagePtr;
+
+    /**
+     * @param prototype the message the pooled messages are copied from
+     * @param max_size the maximum number of messages kept in the pool. If
+     *        they're all still referenced, get() returns a new message which
+     *        isn't kept.
+     */
+    MessagePool(const M& prototype, unsigned int max_size = 4)
+      : prototype_(prototype), max_size_(max_size)
+    {
+      messages_.reserve(max_size_);
+    }
+
+    /**
+     * A message nobody references anymore. It contains what was written in
+     * it the last time it was used (or the prototype).
+     *
+     * Only call it from one thread.
+     */
+    MessagePtr get()
+    {
+      for (unsigned int i = 0; i < messages_.size(); ++i)
+      {
+        if( messages_[i].unique() )
+          return messages_[i];
+      }
+
+      MessagePtr message(new M(prototype_));
+      if( messages_.size() < max_size_ )
+        messages_.push_back(message);
+      return message;
+    }
+
+    /// the number of messages allocated in the pool
+    unsigned int size() const
+    {
+      return messages_.size();
+    }
+
+  private:
+    M prototype_;
+    unsigned int max_size_;
+    std::vector<MessagePtr> messages_;
+  };
+}
+
+#endif 	    /* !MESSAGE_POOL_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,89 @@
+/**
+ * @file   monotone_spline.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief A monotone cubic interpolation (Fritsch-Carlson) of the calibration
+ * points of a joint.
+ *
+ * Unlike the piecewise linear interpolation, the curve is C1: the calibrated
+ * velocity doesn't jump when the raw value crosses a calibration point. The
+ * tangents are limited so that the curve is monotone wherever the calibration
+ * points are, i.e. it never overshoots between two points. Outside of the
+ * calibration points, the curve is extrapolated linearly with the slope of
+ * its end.
+ *
+ * With only 2 calibration points, the curve is the straight line going
+ * through them.
+ *
+ */
+
+#ifndef   	MONOTONE_SPLINE_H_
+# define   	MONOTONE_SPLINE_H_
+
+#include <vector>
+#include <utility>
+
+namespace cyberglove
+{
+  class MonotoneSpline
+  {
+  public:
+    MonotoneSpline();
+
+    /**
+     * Computes the spline going through the given points. The points don't
+     * need to be ordered. If several points have the same x, only the first
+     * one is kept.
+     *
+     * @param x the abscissas of the points (the raw values)
+     * @param y the ordinates of the points (the calibrated values)
+     *
+     * @return false if there are less than 2 distinct points (the spline is
+     *         then constant, or 0 if there's no point at all)
+     */
+    bool set_points(const std::vector<double>& x, const std::vector<double>& y);
+
+    /**
+     * Evaluates the spline.
+     *
+     * @param x the abscissa
+     *
+     * @return the value of the spline at x, extrapolated linearly outside of
+     *         the points.
+     */
+    double evaluate(double x) const;
+
+  private:
+    /// orders the points by ascending x
+    static bool compare_x(const std::pair<double, double>& a, const std::pair<double, double>& b);
+
+    /// the points, ordered by ascending x
+    std::vector<double> x_, y_;
+    /// the tangent of the curve at each point
+    std::vector<double> m_;
+  };
+}
+
+#endif 	    /* !MONOTONE_SPLINE_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,129 @@
+/**
+ * @file   publish_scheduler.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Clocks the outputs of the glove nodes on a steady timer.
+ *
+ * Each output (raw, calibrated, trajectory...) has its own frequency. The
+ * ticks are computed from the steady clock, so that the publishing rate
+ * doesn't depend on the glove sampling frequency and doesn't drift when
+ * frames are dropped. The achieved rate of each output is measured and can
+ * be added to a diagnostic status.
+ *
+ */
+
+#ifndef   	PUBLISH_SCHEDULER_H_
+# define   	PUBLISH_SCHEDULER_H_
+
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/chrono.hpp>
+#include <boost/noncopyable.hpp>
+#include <diagnostic_msgs/DiagnosticStatus.h>
+
+#include "cyberglove/thread_config.h"
+
+namespace cyberglove
+{
+  class PublishScheduler : boost::noncopyable
+  {
+  public:
+    /**
+     * The function called at each tick of an output.
+     *
+     * @return true if something was published, false if there was nothing
+     *         to publish (e.g. no new sample since the last tick).
+     */
+    typedef boost::function<bool()> PublishFunction;
+
+    PublishScheduler();
+    ~PublishScheduler();
+
+    /**
+     * Adds an output. All the outputs must be added before calling start().
+     *
+     * @param name the name of the output, used for the diagnostics
+     * @param frequency the frequency (Hz) at which publish_function is called
+     * @param publish_function the function called at each tick
+     */
+    void add_output(const std::string& name, double frequency, PublishFunction publish_function);
+
+    /**
+     * Starts the publishing thread.
+     *
+     * @param config the scheduling settings for the publishing thread
+     */
+    void start(const ThreadConfig& config);
+
+    /**
+     * Stops and joins the publishing thread.
+     */
+    void stop();
+
+    /**
+     * Adds the target and achieved rates of the outputs to the given status.
+     * Must be called from one of the publish functions (i.e. from the
+     * publishing thread).
+     *
+     * @param status the status to which the rates are added
+     */
+    void add_diagnostics(diagnostic_msgs::DiagnosticStatus& status) const;
+
+  private:
+    typedef boost::chrono::steady_clock Clock;
+
+    struct Output
+    {
+      std::string name;
+      double frequency;
+      Clock::duration period;
+      Clock::time_point next_tick;
+      PublishFunction publish_function;
+      /// messages published since the beginning of the measurement window
+      unsigned int nb_published;
+      /// ticks skipped because the publishing thread was late
+      unsigned int nb_overruns;
+      /// the rate measured over the last window
+      double achieved_frequency;
+    };
+
+    /// The publishing loop, running in its own thread.
+    void run(ThreadConfig config);
+
+    /// Updates the achieved frequencies once per measurement window.
+    void update_rates(Clock::time_point now);
+
+    std::vector<Output> outputs_;
+    boost::thread thread_;
+    Clock::time_point window_start_;
+
+    /// The length of the window over which the achieved rates are measured.
+    static const double rate_window;
+  };
+}
+
+#endif 	    /* !PUBLISH_SCHEDULER_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,100 @@
+/**
+ * @file   sample_accumulator.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Accumulates the glove samples received between two publishing ticks.
+ *
+ * The samples are added from the serial thread and taken from the publishing
+ * thread: depending on the mode, the output is either the average of all the
+ * samples received since the last tick (oversampling) or the latest one.
+ *
+ */
+
+#ifndef   	SAMPLE_ACCUMULATOR_H_
+# define   	SAMPLE_ACCUMULATOR_H_
+
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace cyberglove
+{
+  class SampleAccumulator : boost::noncopyable
+  {
+  public:
+    /**
+     * @param size the number of values in a sample
+     * @param averaging true to average the samples, false to keep the latest one
+     */
+    SampleAccumulator(unsigned int size, bool averaging);
+
+    /**
+     * Adds a sample. Called from the serial thread.
+     *
+     * @param sample the sample, must contain size values
+     * @param seq the sequence number of the sample's frame
+     * @param stamp when the sample was taken (s)
+     */
+    void add_sample(const std::vector<float>& sample, unsigned int seq = 0, double stamp = 0.0);
+
+    /**
+     * Computes the output from the samples received since the last call,
+     * and starts a new accumulation.
+     *
+     * @param output where the average (or latest) sample is written. It is
+     *               left untouched if no sample was received.
+     *
+     * @return the number of samples received since the last call.
+     */
+    unsigned int take(std::vector<float>& output);
+
+    /**
+     * Same as take(output), also giving the sequence number of the latest
+     * sample taken, and when the output was sampled.
+     *
+     * @param seq where the sequence number is written, left untouched if no
+     *            sample was received.
+     * @param stamp where the average (or latest) stamp of the samples is
+     *              written, left untouched if no sample was received.
+     */
+    unsigned int take(std::vector<float>& output, unsigned int& seq, double& stamp);
+
+    /**
+     * Drops the samples received since the last call to take().
+     */
+    void reset();
+
+  private:
+    boost::mutex mutex_;
+    bool averaging_;
+    unsigned int nb_samples_;
+    std::vector<double> sum_;
+    std::vector<float> latest_;
+    unsigned int latest_seq_;
+    double stamp_sum_, latest_stamp_;
+  };
+}
+
+#endif 	    /* !SAMPLE_ACCUMULATOR_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
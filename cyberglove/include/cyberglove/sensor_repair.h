@@ -0,0 +1,107 @@
+/**
+ * @file   sensor_repair.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Repairs the invalid sensor values of the glove frames.
+ *
+ * A flaky sensor sends a glitch (a value of 0 or out of range) now and
+ * then: rather than dropping the whole frame, the invalid value is replaced
+ * by the median of the last valid values of that sensor (held when the
+ * history is 1). A frame with too many invalid sensors is more likely a
+ * garbled stream than glitches: it's rejected, as is a frame with an
+ * invalid sensor which has no valid history yet. With a history of 0,
+ * nothing is repaired: any invalid sensor rejects the frame.
+ *
+ */
+
+#ifndef   	SENSOR_REPAIR_H_
+# define   	SENSOR_REPAIR_H_
+
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/noncopyable.hpp>
+#include <diagnostic_msgs/DiagnosticStatus.h>
+
+namespace cyberglove
+{
+  class SensorRepair : boost::noncopyable
+  {
+  public:
+    /**
+     * @param nb_sensors the number of sensors in a frame
+     * @param history the number of valid values kept per sensor (the median is
+     *        taken on them), 0 to reject the frames instead of repairing them
+     * @param max_invalid the largest number of sensors repaired in a frame
+     */
+    SensorRepair(unsigned int nb_sensors, unsigned int history = 5, unsigned int max_invalid = 4);
+
+    /**
+     * Changes the settings. The history of each sensor is cleared.
+     */
+    void configure(unsigned int history, unsigned int max_invalid);
+
+    /**
+     * Repairs the invalid values of a frame, and adds its valid ones to the
+     * history. Called from the serial thread.
+     *
+     * @param positions the frame: the invalid values are overwritten
+     * @param valid which of the values are valid
+     *
+     * @return false if the frame can't be repaired (it's then left untouched)
+     */
+    bool repair(std::vector<float>& positions, const std::vector<bool>& valid);
+
+    /// the number of values of a sensor which were repaired
+    unsigned long get_nb_repaired(unsigned int sensor);
+
+    /// the ratio of the frames in which a sensor was repaired (0 before the first frame)
+    double get_repair_rate(unsigned int sensor);
+
+    /**
+     * Adds the number of repaired frames and the repair rate of each sensor
+     * repaired so far to the status.
+     */
+    void add_diagnostics(diagnostic_msgs::DiagnosticStatus& status);
+
+  private:
+    /// the median of the last valid values of a sensor
+    float median(unsigned int sensor);
+
+    boost::mutex mutex_;
+
+    unsigned int history_, max_invalid_;
+
+    /// the last valid values of each sensor (ring buffers), and where the next one goes
+    std::vector<std::vector<float> > values_;
+    std::vector<unsigned int> next_;
+    /// where the median is computed, sized to the history: no allocation on the serial thread
+    std::vector<float> scratch_;
+
+    std::vector<unsigned long> nb_repaired_;
+    unsigned long nb_frames_, nb_repaired_frames_;
+  };
+}
+
+#endif 	    /* !SENSOR_REPAIR_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,83 @@
+/**
+ * @file   sequence_tracker.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Counts the frames missing from a stage's output.
+ *
+ * The glove frames are numbered when they're parsed (see
+ * CybergloveSerial::get_nb_msgs_received()). Each stage passes the number
+ * of the frames it outputs: the gaps are the frames which didn't make it
+ * through that stage or the ones before it. Comparing the counts of
+ * successive stages tells where the frames were lost.
+ *
+ */
+
+#ifndef   	SEQUENCE_TRACKER_H_
+# define   	SEQUENCE_TRACKER_H_
+
+#include <string>
+#include <diagnostic_msgs/DiagnosticStatus.h>
+
+namespace cyberglove
+{
+  class SequenceTracker
+  {
+  public:
+    SequenceTracker();
+
+    /**
+     * Call it for each frame output by the stage.
+     *
+     * @param seq the frame's sequence number
+     *
+     * @return the number of frames missing just before this one
+     */
+    unsigned int add(unsigned int seq);
+
+    /// the sequence number of the last frame output
+    unsigned int get_last_seq() const { return last_seq_; };
+
+    /// the number of frames output
+    unsigned long get_nb_frames() const { return nb_frames_; };
+
+    /// the number of frames missing between the first and the last ones output
+    unsigned long get_nb_missing() const { return nb_missing_; };
+
+    /**
+     * Adds the last frame number and the number of missing frames to the
+     * status.
+     *
+     * @param output the name of the stage's output, prepended to the keys
+     */
+    void add_diagnostics(const std::string& output, diagnostic_msgs::DiagnosticStatus& status) const;
+
+  private:
+    bool first_;
+    unsigned int last_seq_;
+    unsigned long nb_frames_, nb_missing_;
+  };
+}
+
+#endif 	    /* !SEQUENCE_TRACKER_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -70,6 +70,9 @@
 
 #include <boost/function.hpp>
 
+#include "cyberglove/thread_config.h"
+#include "cyberglove/sensor_repair.h"
+
 namespace cyberglove_freq
 {
   /**
@@ -122,9 +125,10 @@ namespace cyberglove
      *
      * @param serial_port the path to the serial port, /dev/ttyS0 by default
      * @param callback a pointer to a callback function, which will be called each time a
-     *                 complete joint message is received.
+     *                 complete joint message is received, with the positions, the light
+     *                 status and the frame's sequence number (see get_nb_msgs_received()).
      */
-    CybergloveSerial(std::string serial_port, std::string cyberglove_version, std::string streaming_protocol, boost::function<void(std::vector<float>, bool)> callback);
+    CybergloveSerial(std::string serial_port, std::string cyberglove_version, std::string streaming_protocol, boost::function<void(std::vector<float>, bool, unsigned int)> callback);
     ~CybergloveSerial();
 
     /**
@@ -166,13 +170,48 @@ namespace cyberglove
      */
     int start_stream();
 
+    /**
+     * Sets the scheduling of the serial thread (the cereal_port thread on which
+     * the data is parsed and the callback function is called). The settings are
+     * applied when the first data is received, so this must be called before
+     * start_stream().
+     *
+     * @param config the cpu affinity and priority for the serial thread
+     */
+    void set_thread_config(const ThreadConfig& config);
+
+    /**
+     * Sets how the invalid sensor values (0 or out of range) are repaired,
+     * rather than rejecting their frame (see SensorRepair).
+     *
+     * @param history the number of valid values the median is taken on (1 holds
+     *        the last valid value, 0 rejects the frames instead)
+     * @param max_invalid the frames with more invalid sensors are rejected
+     */
+    void set_sensor_repair(unsigned int history, unsigned int max_invalid);
+
+    /**
+     * The repairs of the invalid sensor values, per sensor.
+     */
+    SensorRepair& get_sensor_repair();
+
     /**
      * We keep the count of all the messages received for the glove.
+     * Each frame is numbered with this count when it starts: that's the
+     * sequence number passed to the callback.
      *
      * @return the number of received messages.
      */
     int get_nb_msgs_received();
 
+    /**
+     * The frames started but not passed to the callback: an unexpected end of
+     * frame, or sensor values of 0 or out of range which couldn't be repaired.
+     *
+     * @return the number of rejected frames.
+     */
+    unsigned int get_nb_frames_rejected();
+
     /**
      * The number of sensors in the glove.
      */
@@ -202,7 +241,18 @@ namespace cyberglove
      */
     void stream_callback(char* world, int length);
 
+    /**
+     * Called at the end of each frame: passes the frame to the callback
+     * function, or counts it as rejected.
+     *
+     * @param valid was the frame received without errors (the invalid sensor
+     *        values are repaired, if possible)?
+     * @param light the light status passed to the callback
+     */
+    void frame_end(bool valid, bool light);
+
     int nb_msgs_received, glove_pos_index, timestamp_bytes_, byte_index_;
+    unsigned int nb_frames_rejected;
     /// A vector containing the current joints positions.
     std::vector<float> glove_positions;
 
@@ -213,17 +263,23 @@ namespace cyberglove
      * The pointer to the function called each time a full message is received.
      * This function is linked when instantiating the class.
      */
-    boost::function<void(std::vector<float>, bool)> callback_function;
+    boost::function<void(std::vector<float>, bool, unsigned int)> callback_function;
 
     bool light_on, button_on;
 
-    ///Did we get any garbage in the received message?
-    bool no_errors;
+    /// Which sensor values of the current frame are valid
+    std::vector<bool> sensor_valid;
+    SensorRepair sensor_repair;
 
     std::string cyberglove_version_;
     std::string streaming_protocol_;
 
     unsigned int reception_state_;
+
+    /// The scheduling settings for the serial thread.
+    ThreadConfig thread_config_;
+    /// Were the scheduling settings already applied to the serial thread?
+    bool thread_configured_;
   };
 }
 
@@ -0,0 +1,87 @@
+/**
+ * @file   stream_resampler.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Resamples a stream of timestamped frames at arbitrary times.
+ *
+ * The last few frames are kept: a time between two of them is linearly
+ * interpolated, a time after the newest one (the stream is late) or before
+ * the oldest one holds the closest frame. Each resampled frame comes with
+ * its alignment error, the time to the closest frame received.
+ *
+ */
+
+#ifndef   	STREAM_RESAMPLER_H_
+# define   	STREAM_RESAMPLER_H_
+
+#include <deque>
+#include <vector>
+
+namespace cyberglove
+{
+  class StreamResampler
+  {
+  public:
+    /**
+     * @param history the number of frames kept
+     */
+    StreamResampler(unsigned int history = 8);
+
+    /**
+     * Adds a frame. A frame older than the newest one is ignored.
+     *
+     * @return false if the frame was ignored
+     */
+    bool add(double stamp, const std::vector<double>& positions);
+
+    /**
+     * The positions at a given time.
+     *
+     * @param time the time to resample at
+     * @param positions where the positions are written (resized)
+     * @param error the time from time to the closest frame received
+     *
+     * @return false if no frame was received yet
+     */
+    bool sample(double time, std::vector<double>& positions, double& error) const;
+
+    /// the stamp of the newest frame, 0 if none was received
+    double newest_stamp() const;
+
+    void clear() { frames_.clear(); };
+
+  private:
+    struct Frame
+    {
+      double stamp;
+      std::vector<double> positions;
+    };
+
+    unsigned int history_;
+    std::deque<Frame> frames_;
+  };
+}
+
+#endif 	    /* !STREAM_RESAMPLER_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,107 @@
+/**
+ * @file   thread_config.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Scheduling settings (cpu affinity, realtime priority) for the
+ * threads of the glove nodes.
+ *
+ * The glove nodes use three threads:
+ *   - the serial thread, owned by the cereal_port, which parses the glove
+ *     data and accumulates the samples. It never spins any ROS queue.
+ *   - the publish thread, clocking the outputs (see PublishScheduler).
+ *   - the service thread, an AsyncSpinner serving the node's own callback
+ *     queue (services, subscriber connections, ...).
+ * Each of them is configured from the parameters <thread>/cpu_affinity and
+ * <thread>/priority.
+ *
+ */
+
+#ifndef   	THREAD_CONFIG_H_
+# define   	THREAD_CONFIG_H_
+
+#include <ros/ros.h>
+#include <ros/callback_queue_interface.h>
+#include <string>
+
+namespace cyberglove
+{
+  /**
+   * The scheduling settings for one thread.
+   */
+  struct ThreadConfig
+  {
+    ThreadConfig();
+
+    /// The cpu the thread is pinned to, -1 to let the kernel decide.
+    int cpu_affinity;
+    /// The SCHED_FIFO priority (1-99), 0 to keep the default scheduling.
+    int priority;
+
+    /**
+     * Reads the settings from the parameter server.
+     *
+     * @param nh the node handle used to read the parameters
+     * @param thread_name the name of the thread, the parameters read are
+     *                    thread_name/cpu_affinity and thread_name/priority
+     *
+     * @return the settings, defaults for the missing parameters
+     */
+    static ThreadConfig from_parameters(const ros::NodeHandle& nh, const std::string& thread_name);
+
+    /**
+     * Applies the settings to the calling thread.
+     *
+     * @param thread_name the name of the thread, used for logging
+     *
+     * @return 0 if success
+     */
+    int apply_to_current_thread(const std::string& thread_name) const;
+  };
+
+  /**
+   * A callback applying a ThreadConfig to the thread calling it. It is queued
+   * before anything else on the callback queue of a single threaded spinner,
+   * so that the spinner thread is configured before serving any callback.
+   */
+  class ThreadConfigCallback : public ros::CallbackInterface
+  {
+  public:
+    ThreadConfigCallback(const ThreadConfig& config, const std::string& thread_name)
+      : config_(config), thread_name_(thread_name)
+    {};
+
+    virtual CallResult call()
+    {
+      config_.apply_to_current_thread(thread_name_);
+      return Success;
+    };
+
+  private:
+    ThreadConfig config_;
+    std::string thread_name_;
+  };
+}
+
+#endif 	    /* !THREAD_CONFIG_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
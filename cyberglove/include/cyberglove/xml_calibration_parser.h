@@ -32,6 +32,9 @@
  * The calibration will be used by the glove node to stream coherent
  * angles (and not an uncalibrated sensor value between 0 and 1).
  *
+ * The calibration points are interpolated with a monotone cubic spline,
+ * evaluated once into a lookup table when the calibration is loaded.
+ *
  *
  */
 
@@ -47,16 +50,59 @@
 #include <vector>
 #include <map>
 
+#include <boost/cstdint.hpp>
+
+#include "cyberglove/monotone_spline.h"
+
 namespace xml_calibration_parser{
 
 class XmlCalibrationParser
 {
  public:
   XmlCalibrationParser(){};
-  XmlCalibrationParser(std::string path_to_calibration);
+  /**
+   * Parses the calibration file and builds the lookup tables.
+   *
+   * @param path_to_calibration the path to the xml calibration file
+   * @param path_to_cache the path to the binary cache of the lookup tables
+   *        (see CalibrationCache). The tables are loaded from it if it
+   *        matches the calibration, built and cached otherwise. No cache is
+   *        used if empty.
+   */
+  XmlCalibrationParser(const std::string& path_to_calibration, const std::string& path_to_cache = "");
   ~XmlCalibrationParser(){};
 
-  float get_calibration_value(float position, std::string joint_name);
+  /**
+   * Calibrates one value.
+   *
+   * @param position the raw value
+   * @param joint_name the joint to calibrate
+   *
+   * @return the calibrated value, 1.0 if the joint isn't calibrated
+   */
+  float get_calibration_value(float position, const std::string& joint_name) const;
+
+  /**
+   * Sets the channels calibrated by calibrate(): their lookup tables are
+   * copied contiguously, in this order. Call it once, after loading the
+   * calibration.
+   *
+   * @param joint_names the joint of each channel
+   *
+   * @return the number of joints which aren't calibrated (their channel
+   *         will be calibrated to 1.0)
+   */
+  int set_channels(const std::vector<std::string>& joint_names);
+
+  /**
+   * Calibrates a whole frame, one value per channel (see set_channels()).
+   * Uses AVX2 gathers when compiled with AVX2 support.
+   *
+   * @param raw the raw values, at least one per channel
+   * @param calibrated where the calibrated values are written (resized to
+   *        the number of channels)
+   */
+  void calibrate(const std::vector<float>& raw, std::vector<float>& calibrated) const;
 
   struct Calibration
   {
@@ -70,6 +116,17 @@ class XmlCalibrationParser
     std::vector<Calibration> calibrations;
   };
 
+  /**
+   * Builds the lookup tables from calibrations which were already parsed
+   * (e.g. read from the parameter server).
+   *
+   * @param joints_calibrations the calibration points of each joint
+   * @param path_to_cache the path to the binary cache of the lookup tables,
+   *        no cache is used if empty.
+   */
+  XmlCalibrationParser(const std::vector<JointCalibration>& joints_calibrations,
+                       const std::string& path_to_cache = "");
+
 
   std::vector<JointCalibration> getJointsCalibrations();
 
@@ -83,15 +140,27 @@ class XmlCalibrationParser
   typedef std::map<std::string, std::vector<float> > mapType;
   mapType joints_calibrations_map;
 
-  int build_calibration_table();
+  /// The lookup tables of the channels (see set_channels()), one after the other.
+  std::vector<float> channel_tables;
+  /// The start of the table of each channel in channel_tables.
+  std::vector<int> channel_offsets;
 
-  std::vector<float> calibration_to_lookup_table(std::vector<Calibration> calib);
+  /**
+   * Builds the lookup tables, or loads them from the cache if it is valid.
+   *
+   * @param path_to_cache the path to the cache, empty for no cache
+   *
+   * @return 0 if success
+   */
+  int build_calibration_table(const std::string& path_to_cache);
 
-  float compute_lookup_value(int index, std::vector<Calibration> calib);
+  /**
+   * @return the hash of the calibration points: the cache is only used
+   *         if it was built from the same points.
+   */
+  boost::uint64_t hash_calibrations() const;
 
-  float linear_interpolate( float x ,
-			    float x0, float y0,
-			    float x1, float y1 );
+  float compute_lookup_value(int index, const cyberglove::MonotoneSpline& spline);
 
   // consts for the lookup tables
   static const float lookup_precision;
@@ -104,17 +173,30 @@ class XmlCalibrationParser
    *
    * @return the float rounded to the closest int
    */
-  int round(float number);
+  static int round(float number);
 
   /**
    * inline function to convert a raw position to a valid index for
-   * our lookup table
+   * our lookup table: the entry below the position (clamped to [0, 1]),
+   * the value being interpolated between it and the next one.
    *
    * @param raw_position the raw position (directly read from the glove)
+   * @param fraction where the position between the two entries is
+   *        written (0 to 1)
+   *
+   * @return the index of the entry below the position
+   */
+  static int return_index_from_raw_position(float raw_position, float& fraction);
+
+  /**
+   * Interpolates linearly between an entry of a lookup table and the next one.
+   *
+   * @param entry the entry below the position
+   * @param fraction the position between the two entries (0 to 1)
    *
    * @return the calibrated value
    */
-  int return_index_from_raw_position(float raw_position);
+  static float interpolate(const float* entry, float fraction);
 
   /**
    * inline function to convert an index of our lookup table to a raw
@@ -0,0 +1,174 @@
+/**
+ * @file   bimanual_aligner.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Aligns the streams of two gloves on a common timebase.
+ *
+ */
+
+#include "cyberglove/bimanual_aligner.h"
+#include <algorithm>
+#include <sstream>
+#include <boost/bind.hpp>
+
+namespace cyberglove
+{
+  BimanualAligner::BimanualAligner()
+    : n_tilde("~"), max_hold(0.1), error_sum(0.0), error_max(0.0), nb_frames(0), nb_stale_ticks(0)
+  {
+    double rate, delay;
+    int history;
+    n_tilde.param("rate", rate, 100.0);
+    n_tilde.param("alignment_delay", delay, 0.02);
+    n_tilde.param("max_hold", max_hold, 0.1);
+    n_tilde.param("history", history, 8);
+    alignment_delay = ros::Duration(delay);
+
+    const char* topics[NB_SIDES] = {"left/raw/frames", "right/raw/frames"};
+    for (unsigned int i = 0; i < NB_SIDES; ++i)
+    {
+      resamplers[i] = StreamResampler(std::max(history, 2));
+      nb_out_of_order[i] = 0;
+      //all the frames are needed to interpolate: no conflation
+      joint_states_subs[i] = node.subscribe<cyberglove::GloveFrame>(topics[i], 10,
+                                                                    boost::bind(&BimanualAligner::frame_received, this, _1, static_cast<Side>(i)));
+    }
+
+    frame_pub = node.advertise<cyberglove::BimanualFrame>("bimanual_frame", 1);
+    diagnostics_pub = node.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+
+    tick_timer = node.createTimer(ros::Duration(1.0 / rate), &BimanualAligner::tick, this);
+    diagnostics_timer = node.createTimer(ros::Duration(1.0), &BimanualAligner::publish_diagnostics, this);
+
+    ROS_INFO("Aligning %s and %s at %.0fHz, %.0fms behind", joint_states_subs[LEFT].getTopic().c_str(),
+             joint_states_subs[RIGHT].getTopic().c_str(), rate, delay * 1000.0);
+  }
+
+  void BimanualAligner::frame_received(const cyberglove::GloveFrameConstPtr& msg, Side side)
+  {
+    received_frames[side].add(msg->frame_number);
+    if( !resamplers[side].add(msg->header.stamp.toSec(), msg->position) )
+    {
+      ++nb_out_of_order[side];
+      return;
+    }
+
+    sensor_msgs::JointState& joint_states = side == LEFT ? frame.left : frame.right;
+    if( joint_states.name.empty() )
+      joint_states.name = msg->name;
+  }
+
+  void BimanualAligner::tick(const ros::TimerEvent& event)
+  {
+    //the expected time of the tick: the ticks are evenly spaced, whatever the timer's jitter
+    ros::Time time = event.current_expected - alignment_delay;
+
+    double* errors[NB_SIDES] = {&frame.left_error, &frame.right_error};
+    sensor_msgs::JointState* joint_states[NB_SIDES] = {&frame.left, &frame.right};
+    for (unsigned int i = 0; i < NB_SIDES; ++i)
+    {
+      if( !resamplers[i].sample(time.toSec(), joint_states[i]->position, *errors[i]) || *errors[i] > max_hold )
+      {
+        ++nb_stale_ticks;
+        ROS_WARN_THROTTLE(1.0, "No recent frame on %s, the gloves can't be aligned", joint_states_subs[i].getTopic().c_str());
+        return;
+      }
+    }
+
+    frame.header.stamp = time;
+    frame.left.header.stamp = time;
+    frame.right.header.stamp = time;
+    frame_pub.publish(frame);
+
+    double error = std::max(frame.left_error, frame.right_error);
+    error_sum += error;
+    error_max = std::max(error_max, error);
+    ++nb_frames;
+  }
+
+  void BimanualAligner::publish_diagnostics(const ros::TimerEvent& event)
+  {
+    diagnostic_msgs::DiagnosticArray diagnostics;
+    diagnostics.header.stamp = ros::Time::now();
+
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = ros::this_node::getName() + ": alignment";
+    status.hardware_id = "bimanual cyberglove";
+    if( nb_frames > 0 )
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::OK;
+      status.message = "Aligning";
+    }
+    else
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+      status.message = "Waiting for both gloves";
+    }
+
+    diagnostic_msgs::KeyValue key_value;
+    std::stringstream ss;
+    ss << nb_frames;
+    key_value.key = "frames published";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << nb_stale_ticks;
+    key_value.key = "stale ticks";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    //the time to the closest frame received, over both gloves
+    ss.str("");
+    ss << (nb_frames > 0 ? error_sum / nb_frames * 1000.0 : 0.0);
+    key_value.key = "alignment error (ms)";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << error_max * 1000.0;
+    key_value.key = "max alignment error (ms)";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    const char* sides[NB_SIDES] = {"left", "right"};
+    for (unsigned int i = 0; i < NB_SIDES; ++i)
+    {
+      ss.str("");
+      ss << nb_out_of_order[i];
+      key_value.key = std::string(sides[i]) + " out of order frames";
+      key_value.value = ss.str();
+      status.values.push_back(key_value);
+
+      received_frames[i].add_diagnostics(sides[i], status);
+    }
+
+    error_sum = error_max = 0.0;
+    nb_frames = nb_stale_ticks = 0;
+
+    diagnostics.status.push_back(status);
+    diagnostics_pub.publish(diagnostics);
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
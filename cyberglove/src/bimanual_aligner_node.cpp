@@ -0,0 +1,61 @@
+/**
+ * @file   bimanual_aligner_node.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief  Publishes the frames of two gloves aligned on a common
+ * timebase.
+ *
+ *
+ */
+
+#include <ros/ros.h>
+#include "cyberglove/bimanual_aligner.h"
+
+using namespace cyberglove;
+
+/////////////////////////////////
+//           MAIN              //
+/////////////////////////////////
+
+
+/**
+ *  Start the bimanual aligner.
+ *
+ * @param argc
+ * @param argv
+ *
+ * @return 0
+ */
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "bimanual_aligner");
+  BimanualAligner aligner;
+
+  //the frames and the ticks are processed on this thread: no locking needed
+  ros::spin();
+
+  return 0;
+}
+
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,214 @@
+/**
+ * @file   calibration_cache.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief A binary cache of the calibration lookup tables.
+ *
+ */
+
+#include "cyberglove/calibration_cache.h"
+
+#include <ros/ros.h>
+
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace cyberglove
+{
+  namespace
+  {
+    const char cache_magic[8] = {'C', 'Y', 'B', 'G', 'C', 'A', 'L', '\0'};
+
+    struct CacheHeader
+    {
+      char magic[8];
+      boost::uint32_t version;
+      boost::uint32_t table_size;
+      boost::uint32_t nb_joints;
+      boost::uint32_t padding;
+      boost::uint64_t source_hash;
+      /// the hash of everything following the header
+      boost::uint64_t checksum;
+    };
+  }
+
+  const boost::uint32_t CalibrationCache::version = 1;
+  const boost::uint64_t CalibrationCache::hash_seed = 14695981039346656037ULL;
+
+  boost::uint64_t CalibrationCache::hash(const void* data, std::size_t size, boost::uint64_t seed)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    boost::uint64_t hash = seed;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  bool CalibrationCache::load(const std::string& path, boost::uint64_t source_hash,
+                              unsigned int table_size, TableMap& tables)
+  {
+    int fd = open(path.c_str(), O_RDONLY);
+    if( fd < 0 )
+    {
+      ROS_DEBUG("No calibration cache %s", path.c_str());
+      return false;
+    }
+
+    struct stat file_stat;
+    if( fstat(fd, &file_stat) != 0 || file_stat.st_size < (off_t)sizeof(CacheHeader) )
+    {
+      close(fd);
+      ROS_WARN("Ignoring the calibration cache %s: the file is truncated", path.c_str());
+      return false;
+    }
+
+    std::size_t size = file_stat.st_size;
+    void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if( mapped == MAP_FAILED )
+    {
+      ROS_WARN("Ignoring the calibration cache %s: can't map it in memory", path.c_str());
+      return false;
+    }
+
+    const char* data = static_cast<const char*>(mapped);
+    CacheHeader header;
+    memcpy(&header, data, sizeof(CacheHeader));
+
+    const char* reason = NULL;
+    if( memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 )
+      reason = "not a calibration cache";
+    else if( header.version != version )
+      reason = "other format version";
+    else if( header.table_size != table_size )
+      reason = "other table size";
+    else if( header.source_hash != source_hash )
+      reason = "the calibration changed";
+    else if( header.checksum != hash(data + sizeof(CacheHeader), size - sizeof(CacheHeader)) )
+      reason = "bad checksum";
+
+    //read the tables, checking they all fit in the file
+    TableMap loaded_tables;
+    std::size_t offset = sizeof(CacheHeader);
+    std::size_t table_bytes = table_size * sizeof(float);
+    for (unsigned int i = 0; reason == NULL && i < header.nb_joints; ++i)
+    {
+      boost::uint32_t name_size;
+      if( size - offset < sizeof(name_size) )
+      {
+        reason = "truncated";
+        break;
+      }
+      memcpy(&name_size, data + offset, sizeof(name_size));
+      offset += sizeof(name_size);
+
+      if( size - offset < name_size + table_bytes )
+      {
+        reason = "truncated";
+        break;
+      }
+      std::string name(data + offset, name_size);
+      offset += name_size;
+
+      std::vector<float>& table = loaded_tables[name];
+      table.resize(table_size);
+      memcpy(&table[0], data + offset, table_bytes);
+      offset += table_bytes;
+    }
+
+    munmap(mapped, size);
+
+    if( reason != NULL )
+    {
+      ROS_INFO("Ignoring the calibration cache %s: %s", path.c_str(), reason);
+      return false;
+    }
+
+    tables.swap(loaded_tables);
+    return true;
+  }
+
+  bool CalibrationCache::save(const std::string& path, boost::uint64_t source_hash,
+                              unsigned int table_size, const TableMap& tables)
+  {
+    //serialize the tables
+    std::vector<char> payload;
+    for (TableMap::const_iterator it = tables.begin(); it != tables.end(); ++it)
+    {
+      if( it->second.size() != table_size )
+      {
+        ROS_ERROR("Not caching the calibration: the table of %s has %u values instead of %u.",
+                  it->first.c_str(), (unsigned int)it->second.size(), table_size);
+        return false;
+      }
+
+      boost::uint32_t name_size = it->first.size();
+      const char* name_size_bytes = reinterpret_cast<const char*>(&name_size);
+      payload.insert(payload.end(), name_size_bytes, name_size_bytes + sizeof(name_size));
+      payload.insert(payload.end(), it->first.begin(), it->first.end());
+      const char* table_bytes = reinterpret_cast<const char*>(&it->second[0]);
+      payload.insert(payload.end(), table_bytes, table_bytes + table_size * sizeof(float));
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(CacheHeader));
+    memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = version;
+    header.table_size = table_size;
+    header.nb_joints = tables.size();
+    header.source_hash = source_hash;
+    header.checksum = hash(payload.empty() ? NULL : &payload[0], payload.size());
+
+    //write next to the cache, then rename: the cache is replaced atomically
+    std::string tmp_path = path + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "wb");
+    if( file == NULL )
+    {
+      ROS_WARN("Can't write the calibration cache %s: the tables will be rebuilt at each start.", path.c_str());
+      return false;
+    }
+
+    bool written = fwrite(&header, sizeof(CacheHeader), 1, file) == 1;
+    if( written && !payload.empty() )
+      written = fwrite(&payload[0], payload.size(), 1, file) == 1;
+    written = (fclose(file) == 0) && written;
+
+    if( !written || rename(tmp_path.c_str(), path.c_str()) != 0 )
+    {
+      unlink(tmp_path.c_str());
+      ROS_WARN("Can't write the calibration cache %s: the tables will be rebuilt at each start.", path.c_str());
+      return false;
+    }
+
+    return true;
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -55,7 +55,9 @@ int main(int argc, char** argv)
 
   CybergloveService service(cyberglove_pub);
 
-  ros::spin();
+  //the services are served by the publisher's service thread and the data is
+  // processed on the serial thread: nothing to spin here.
+  ros::waitForShutdown();
 
   return 0;
 }
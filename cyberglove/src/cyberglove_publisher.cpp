@@ -32,6 +32,7 @@
 //generic C/C++ include
 #include <string>
 #include <sstream>
+#include <algorithm>
 
 #include "cyberglove/cyberglove_publisher.h"
 
@@ -45,28 +46,52 @@ namespace cyberglove{
   /////////////////////////////////
 
   CyberglovePublisher::CyberglovePublisher()
-    : n_tilde("~"), publish_counter_max(0), publish_counter_index(0),
-      path_to_glove("/dev/ttyS0"), publishing(true)
+    : n_tilde("~"), raw_subscribed(false), calibrated_subscribed(false),
+      path_to_glove("/dev/ttyS0"), publishing(true), cache_calibration(false),
+      startup_time(ros::WallTime::now()), first_frame_published(false)
   {
+    //the services and parameters are served from their own thread
+    n_tilde.setCallbackQueue(&service_queue);
 
     std::string path_to_calibration;
     n_tilde.param("path_to_calibration", path_to_calibration, std::string("/etc/robot/calibration.d/cyberglove.cal"));
     ROS_INFO("Calibration file loaded for the Cyberglove: %s", path_to_calibration.c_str());
 
-    initialize_calibration(path_to_calibration);
+    //the lookup tables can be cached in <path_to_calibration>.cache, and only rebuilt
+    // when the calibration changes. Off by default: the calibrations are usually
+    // installed read-only, where the cache can't be written.
+    n_tilde.param("cache_calibration", cache_calibration, false);
 
     //set sampling frequency
     double sampling_freq;
     n_tilde.param("sampling_frequency", sampling_freq, 100.0);
 
-    // set publish_counter: the number of data we'll average
-    // before publishing.
-    double publish_freq;
+    // set the publishing frequencies: the raw and calibrated data are clocked
+    // independently from the sampling. publish_frequency is the default for both.
+    double publish_freq, raw_publish_freq, calibrated_publish_freq;
     n_tilde.param("publish_frequency", publish_freq, 20.0);
-    publish_counter_max = (int)(sampling_freq / publish_freq);
-
-    ROS_INFO_STREAM("Sampling at " << sampling_freq << "Hz ; Publishing at "
-                    << publish_freq << "Hz ; Publish counter: "<< publish_counter_max);
+    n_tilde.param("raw_publish_frequency", raw_publish_freq, publish_freq);
+    n_tilde.param("calibrated_publish_frequency", calibrated_publish_freq, publish_freq);
+
+    // average the samples received between two publications (oversampling),
+    // or only publish the latest one.
+    bool averaging;
+    n_tilde.param("averaging", averaging, true);
+    raw_samples.reset(new SampleAccumulator(CybergloveSerial::glove_size, averaging));
+    calibrated_samples.reset(new SampleAccumulator(CybergloveSerial::glove_size, averaging));
+
+    // timestamp the frames from a model of the glove's sampling clock (fitted
+    // on their arrival times), or when they're published
+    bool use_glove_clock;
+    int glove_clock_window;
+    n_tilde.param("glove_clock", use_glove_clock, true);
+    n_tilde.param("glove_clock_window", glove_clock_window, 500);
+    if( use_glove_clock )
+      glove_clock.reset(new GloveClock(1.0 / sampling_freq, std::max(glove_clock_window, 2)));
+
+    ROS_INFO_STREAM("Sampling at " << sampling_freq << "Hz ; Publishing raw data at "
+                    << raw_publish_freq << "Hz, calibrated data at " << calibrated_publish_freq
+                    << "Hz ; " << (averaging ? "averaging the samples" : "publishing the latest sample"));
 
     //Get the cyberglove version '2' or '3'
     n_tilde.param("cyberglove_version", cyberglove_version_, std::string("2"));
@@ -81,7 +106,15 @@ namespace cyberglove{
     ROS_INFO("Opening glove on port: %s", path_to_glove.c_str());
 
     //initialize the connection with the cyberglove and binds the callback function
-    serial_glove = boost::shared_ptr<CybergloveSerial>(new CybergloveSerial(path_to_glove, cyberglove_version_, streaming_protocol_, boost::bind(&CyberglovePublisher::glove_callback, this, _1, _2)));
+    serial_glove = boost::shared_ptr<CybergloveSerial>(new CybergloveSerial(path_to_glove, cyberglove_version_, streaming_protocol_, boost::bind(&CyberglovePublisher::glove_callback, this, _1, _2, _3)));
+    serial_glove->set_thread_config(ThreadConfig::from_parameters(n_tilde, "serial_thread"));
+
+    // the invalid sensor values are repaired from the last valid ones (median
+    // of sensor_repair_history values), unless too many sensors are invalid
+    int sensor_repair_history, max_repaired_sensors;
+    n_tilde.param("sensor_repair_history", sensor_repair_history, 5);
+    n_tilde.param("max_repaired_sensors", max_repaired_sensors, 4);
+    serial_glove->set_sensor_repair(std::max(sensor_repair_history, 0), std::max(max_repaired_sensors, 0));
 
     int res = -1;
     if(cyberglove_version_ == "2")
@@ -123,39 +156,48 @@ namespace cyberglove{
     n_tilde.searchParam("cyberglove_prefix", searched_param);
     n_tilde.param(searched_param, prefix, std::string());
     std::string full_topic = prefix + "/calibrated/joint_states";
-    cyberglove_pub = n_tilde.advertise<sensor_msgs::JointState>(full_topic, 2);
+    cyberglove_pub = n_tilde.advertise<sensor_msgs::JointState>(full_topic, 2,
+                                                                boost::bind(&CyberglovePublisher::subscribers_changed, this),
+                                                                boost::bind(&CyberglovePublisher::subscribers_changed, this));
 
     //publishes raw JointState messages
     n_tilde.searchParam("cyberglove_prefix", searched_param);
     n_tilde.param(searched_param, prefix, std::string());
     full_topic = prefix + "/raw/joint_states";
-    cyberglove_raw_pub = n_tilde.advertise<sensor_msgs::JointState>(full_topic, 2);
+    cyberglove_raw_pub = n_tilde.advertise<sensor_msgs::JointState>(full_topic, 2,
+                                                                    boost::bind(&CyberglovePublisher::subscribers_changed, this),
+                                                                    boost::bind(&CyberglovePublisher::subscribers_changed, this));
+
+    //publishes the same frames with their frame number (roscpp renumbers header.seq)
+    cyberglove_frames_pub = n_tilde.advertise<cyberglove::GloveFrame>(prefix + "/calibrated/frames", 2,
+                                                                      boost::bind(&CyberglovePublisher::subscribers_changed, this),
+                                                                      boost::bind(&CyberglovePublisher::subscribers_changed, this));
+    cyberglove_raw_frames_pub = n_tilde.advertise<cyberglove::GloveFrame>(prefix + "/raw/frames", 2,
+                                                                          boost::bind(&CyberglovePublisher::subscribers_changed, this),
+                                                                          boost::bind(&CyberglovePublisher::subscribers_changed, this));
 
     //initialises joint names (the order is important)
-    jointstate_msg.name.push_back("G_ThumbRotate");
-    jointstate_msg.name.push_back("G_ThumbMPJ");
-    jointstate_msg.name.push_back("G_ThumbIJ");
-    jointstate_msg.name.push_back("G_ThumbAb");
-    jointstate_msg.name.push_back("G_IndexMPJ");
-    jointstate_msg.name.push_back("G_IndexPIJ");
-    jointstate_msg.name.push_back("G_IndexDIJ");
-    jointstate_msg.name.push_back("G_MiddleMPJ");
-    jointstate_msg.name.push_back("G_MiddlePIJ");
-    jointstate_msg.name.push_back("G_MiddleDIJ");
-    jointstate_msg.name.push_back("G_MiddleIndexAb");
-    jointstate_msg.name.push_back("G_RingMPJ");
-    jointstate_msg.name.push_back("G_RingPIJ");
-    jointstate_msg.name.push_back("G_RingDIJ");
-    jointstate_msg.name.push_back("G_RingMiddleAb");
-    jointstate_msg.name.push_back("G_PinkieMPJ");
-    jointstate_msg.name.push_back("G_PinkiePIJ");
-    jointstate_msg.name.push_back("G_PinkieDIJ");
-    jointstate_msg.name.push_back("G_PinkieRingAb");
-    jointstate_msg.name.push_back("G_PalmArch");
-    jointstate_msg.name.push_back("G_WristPitch");
-    jointstate_msg.name.push_back("G_WristYaw");
+    jointstate_msg.name.assign(glove_sensors::names, glove_sensors::names + glove_sensors::NB_SENSORS);
 
     jointstate_raw_msg.name = jointstate_msg.name;
+    frame_msg.name = jointstate_msg.name;
+    raw_frame_msg.name = jointstate_msg.name;
+
+    //the calibration tables are laid out in the order of the joint names
+    initialize_calibration(path_to_calibration);
+
+    diagnostics_pub = node.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 2);
+
+    //start the publishing thread
+    scheduler.add_output("raw", raw_publish_freq, boost::bind(&CyberglovePublisher::publish_raw, this));
+    scheduler.add_output("calibrated", calibrated_publish_freq, boost::bind(&CyberglovePublisher::publish_calibrated, this));
+    scheduler.add_output("diagnostics", 1.0, boost::bind(&CyberglovePublisher::publish_diagnostics, this));
+    scheduler.start(ThreadConfig::from_parameters(n_tilde, "publish_thread"));
+
+    //start serving the services: the thread is configured by the first callback it runs
+    service_queue.addCallback(CallbackInterfacePtr(new ThreadConfigCallback(ThreadConfig::from_parameters(n_tilde, "service_thread"), "service")));
+    service_spinner.reset(new AsyncSpinner(1, &service_queue));
+    service_spinner->start();
 
     //start reading the data.
     res = serial_glove->start_stream();
@@ -163,11 +205,30 @@ namespace cyberglove{
 
   CyberglovePublisher::~CyberglovePublisher()
   {
+    //stop the publishing and serial threads before destroying what they use
+    scheduler.stop();
+    serial_glove.reset();
+
+    //stop serving the services before the publisher is destroyed
+    if( service_spinner )
+      service_spinner->stop();
   }
 
   void CyberglovePublisher::initialize_calibration(std::string path_to_calibration)
   {
-    calibration_parser = XmlCalibrationParser(path_to_calibration);
+    //parse the new calibration outside of the lock, the serial thread keeps on
+    // using the current one in the meantime
+    XmlCalibrationParser new_calibration(path_to_calibration,
+                                         cache_calibration ? path_to_calibration + ".cache" : std::string());
+    new_calibration.set_channels(jointstate_msg.name);
+
+    boost::mutex::scoped_lock lock(calibration_mutex);
+    calibration_parser = new_calibration;
+  }
+
+  CallbackQueue* CyberglovePublisher::get_service_queue()
+  {
+    return &service_queue;
   }
 
   bool CyberglovePublisher::isPublishing()
@@ -190,68 +251,169 @@ namespace cyberglove{
   /////////////////////////////////
   //       CALLBACK METHOD       //
   /////////////////////////////////
-  void CyberglovePublisher::glove_callback(std::vector<float> glove_pos, bool light_on)
+  void CyberglovePublisher::glove_callback(std::vector<float> glove_pos, bool light_on, unsigned int seq)
   {
+    //all the frames are sampled on the glove's clock, even with the light off
+    double stamp = ros::Time::now().toSec();
+    if( glove_clock )
+      stamp = glove_clock->update(stamp, seq);
+
     //if the light is off, we don't publish any data.
     if( !light_on )
     {
       publishing = false;
       ROS_DEBUG("The glove button is off, no data will be read / sent");
-      ros::spinOnce();
       return;
     }
     publishing = true;
 
-    //appends the current position to the vector of position
-    glove_positions.push_back( glove_pos );
+    //the samples are averaged and published from the publishing thread,
+    // only for the outputs which are subscribed
+    if( raw_subscribed )
+      raw_samples->add_sample(glove_pos, seq, stamp);
+    if( calibrated_subscribed )
+      calibrated_samples->add_sample(glove_pos, seq, stamp);
+  }
 
-    publish_counter_index += 1;
+  void CyberglovePublisher::subscribers_changed()
+  {
+    bool raw = cyberglove_raw_pub.getNumSubscribers() + cyberglove_raw_frames_pub.getNumSubscribers() > 0;
+    bool calibrated = cyberglove_pub.getNumSubscribers() + cyberglove_frames_pub.getNumSubscribers() > 0;
+
+    //drop what was accumulated before the output was last unsubscribed
+    if( raw && !raw_subscribed )
+      raw_samples->reset();
+    if( calibrated && !calibrated_subscribed )
+      calibrated_samples->reset();
+
+    if( raw != raw_subscribed )
+      ROS_INFO("Raw data %s", raw ? "subscribed: publishing" : "unsubscribed: stopped publishing");
+    if( calibrated != calibrated_subscribed )
+      ROS_INFO("Calibrated data %s", calibrated ? "subscribed: publishing" : "unsubscribed: stopped publishing");
+
+    raw_subscribed = raw;
+    calibrated_subscribed = calibrated;
+  }
 
-    //if we've enough samples, publish the data:
-    if( publish_counter_index == publish_counter_max )
-    {
-      //reset the messages
-      jointstate_msg.position.clear();
-      jointstate_msg.velocity.clear();
-      jointstate_raw_msg.position.clear();
-      jointstate_raw_msg.velocity.clear();
-      jointstate_raw_msg.header.stamp = ros::Time::now();
-
-      //fill the joint_state msg with the averaged glove data
-      for(unsigned int index_joint = 0; index_joint < CybergloveSerial::glove_size; ++index_joint)
-      {
-        //compute the average over the samples for the current joint
-        float averaged_value = 0.0f;
-        for (unsigned int index_sample = 0; index_sample < publish_counter_max; ++index_sample)
-        {
-          averaged_value += glove_positions[index_sample][index_joint];
-        }
-        averaged_value /= publish_counter_max;
-
-        jointstate_raw_msg.position.push_back(averaged_value);
-        add_jointstate(averaged_value, jointstate_msg.name[index_joint]);
-      }
+  bool CyberglovePublisher::publish_raw()
+  {
+    unsigned int seq;
+    double stamp;
+    if( !raw_subscribed || raw_samples->take(raw_positions, seq, stamp) == 0 )
+      return false;
+    raw_frames.add(seq);
 
-      //publish the msgs
-      cyberglove_pub.publish(jointstate_msg);
+    jointstate_raw_msg.header.stamp = glove_clock ? ros::Time(stamp) : ros::Time::now();
+    jointstate_raw_msg.position.assign(raw_positions.begin(), raw_positions.end());
+    if( cyberglove_raw_pub.getNumSubscribers() > 0 )
       cyberglove_raw_pub.publish(jointstate_raw_msg);
 
-      publish_counter_index = 0;
-      glove_positions.clear();
+    if( cyberglove_raw_frames_pub.getNumSubscribers() > 0 )
+    {
+      raw_frame_msg.header.stamp = jointstate_raw_msg.header.stamp;
+      raw_frame_msg.frame_number = seq;
+      raw_frame_msg.position = jointstate_raw_msg.position;
+      cyberglove_raw_frames_pub.publish(raw_frame_msg);
     }
-    
-    ros::spinOnce();
+
+    return true;
   }
 
-  void CyberglovePublisher::add_jointstate(float position, std::string joint_name)
+  bool CyberglovePublisher::publish_calibrated()
   {
-    //get the calibration value
-    float calibration_value = calibration_parser.get_calibration_value(position, joint_name);
-    //publish the glove position
-    jointstate_msg.position.push_back(calibration_value);
+    unsigned int seq;
+    double stamp;
+    if( !calibrated_subscribed || calibrated_samples->take(calibrated_positions, seq, stamp) == 0 )
+      return false;
+    calibrated_frames.add(seq);
+
+    {
+      boost::mutex::scoped_lock lock(calibration_mutex);
+
+      //calibrate the whole frame at once
+      calibration_parser.calibrate(calibrated_positions, calibration_values);
+    }
+
+    //fill the joint_state msg with the calibrated glove data
+    jointstate_msg.header.stamp = glove_clock ? ros::Time(stamp) : ros::Time::now();
+    jointstate_msg.position.assign(calibration_values.begin(), calibration_values.end());
     //set velocity to 0.
     //@TODO : send the correct velocity ?
-    jointstate_msg.velocity.push_back(0.0);
+    jointstate_msg.velocity.assign(calibration_values.size(), 0.0);
+
+    if( cyberglove_pub.getNumSubscribers() > 0 )
+      cyberglove_pub.publish(jointstate_msg);
+
+    if( cyberglove_frames_pub.getNumSubscribers() > 0 )
+    {
+      frame_msg.header.stamp = jointstate_msg.header.stamp;
+      frame_msg.frame_number = seq;
+      frame_msg.position = jointstate_msg.position;
+      cyberglove_frames_pub.publish(frame_msg);
+    }
+
+    if( !first_frame_published )
+    {
+      ROS_INFO("First calibrated frame published %.3fs after startup",
+               (ros::WallTime::now() - startup_time).toSec());
+      first_frame_published = true;
+    }
+
+    return true;
+  }
+
+  bool CyberglovePublisher::publish_diagnostics()
+  {
+    diagnostic_msgs::DiagnosticArray diagnostics;
+    diagnostics.header.stamp = ros::Time::now();
+
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = ros::this_node::getName() + ": publishing";
+    status.hardware_id = path_to_glove;
+    if( publishing )
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::OK;
+      status.message = "Publishing";
+    }
+    else
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+      status.message = "The glove button is off";
+    }
+    scheduler.add_diagnostics(status);
+    if( glove_clock )
+      glove_clock->add_diagnostics(status);
+
+    diagnostic_msgs::KeyValue key_value;
+    std::stringstream ss;
+    ss << serial_glove->get_nb_msgs_received();
+    key_value.key = "messages received";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    key_value.key = "raw subscribed";
+    key_value.value = raw_subscribed ? "True" : "False";
+    status.values.push_back(key_value);
+
+    key_value.key = "calibrated subscribed";
+    key_value.value = calibrated_subscribed ? "True" : "False";
+    status.values.push_back(key_value);
+
+    //where the frames were lost: in the parser, or before being published
+    ss.str("");
+    ss << serial_glove->get_nb_frames_rejected();
+    key_value.key = "frames rejected by the parser";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+    serial_glove->get_sensor_repair().add_diagnostics(status);
+
+    raw_frames.add_diagnostics("raw", status);
+    calibrated_frames.add_diagnostics("calibrated", status);
+
+    diagnostics.status.push_back(status);
+    diagnostics_pub.publish(diagnostics);
+
+    return true;
   }
 }// end namespace
 
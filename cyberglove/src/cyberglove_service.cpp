@@ -40,6 +40,8 @@ namespace cyberglove{
 CybergloveService::CybergloveService(boost::shared_ptr<CyberglovePublisher> publish)
  :  node("~"), pub(publish)
 {
+  //the services are served by the publisher's service thread
+  node.setCallbackQueue(pub->get_service_queue());
   service_start = node.advertiseService("start",&CybergloveService::start,this);
   service_calibration = node.advertiseService("calibration", &CybergloveService::calibration, this);
   ROS_INFO("Listening for service");
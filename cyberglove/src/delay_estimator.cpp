@@ -0,0 +1,76 @@
+/**
+ * @file   delay_estimator.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief The distribution of the last measured delays.
+ *
+ */
+
+#include "cyberglove/delay_estimator.h"
+#include <algorithm>
+
+namespace cyberglove
+{
+  DelayEstimator::DelayEstimator(unsigned int window_size)
+    : window_size_(std::max(window_size, 1u)), next_(0), nb_delays_(0)
+  {
+    delays_.reserve(window_size_);
+    sorted_.reserve(window_size_);
+  }
+
+  void DelayEstimator::add(double delay)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if( delays_.size() < window_size_ )
+      delays_.push_back(delay);
+    else
+      delays_[next_] = delay;
+    next_ = (next_ + 1) % window_size_;
+    ++nb_delays_;
+  }
+
+  bool DelayEstimator::percentile(double ratio, double& delay)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if( delays_.empty() )
+      return false;
+
+    //only the requested element needs to be in place
+    sorted_.assign(delays_.begin(), delays_.end());
+    ratio = std::min(std::max(ratio, 0.0), 1.0);
+    std::vector<double>::iterator nth = sorted_.begin() + static_cast<unsigned int>(ratio * (sorted_.size() - 1) + 0.5);
+    std::nth_element(sorted_.begin(), nth, sorted_.end());
+    delay = *nth;
+    return true;
+  }
+
+  unsigned int DelayEstimator::get_nb_delays()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return nb_delays_;
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,204 @@
+/**
+ * @file   glove_clock.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief A model of the glove's sampling clock.
+ *
+ */
+
+#include "cyberglove/glove_clock.h"
+#include <algorithm>
+#include <math.h>
+#include <sstream>
+
+namespace cyberglove
+{
+  GloveClock::GloveClock(double nominal_period, unsigned int window, unsigned int warmup, double max_gap,
+                         unsigned int confirmation)
+    : nominal_period_(nominal_period), forgetting_(1.0 - 1.0 / std::max(window, 2u)), max_gap_(max_gap),
+      warmup_(std::max(warmup, 2u)), confirmation_(std::max(confirmation, 1u)), origin_(0.0), index_(0.0), seq_(0),
+      nb_frames_(0), weight_(0.0), mean_index_(0.0), mean_time_(0.0), var_index_(0.0), covar_(0.0), residual_var_(0.0),
+      pending_offset_(0.0), nb_pending_(0), shift_(0.0), nb_missed_(0), nb_restarts_(0)
+  {
+  }
+
+  double GloveClock::update(double arrival, unsigned int seq)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if( nb_frames_ == 0 )
+    {
+      restart(arrival, seq);
+      return arrival;
+    }
+    //the frame numbering restarted
+    if( seq <= seq_ )
+    {
+      restart(arrival, seq);
+      ++nb_restarts_;
+      return arrival;
+    }
+
+    //the frames rejected by the parser were sampled too
+    double time = arrival - origin_;
+    double index = index_ + (seq - seq_);
+    double residual = time - fit(index);
+    if( fabs(residual) > max_gap_ )
+    {
+      restart(arrival, seq);
+      ++nb_restarts_;
+      return arrival;
+    }
+
+    if( nb_frames_ >= warmup_ )
+    {
+      double period = var_index_ > 0.0 ? covar_ / var_index_ : nominal_period_;
+      double threshold = period / 2.0 + 2.0 * sqrt(residual_var_);
+
+      //later than the usual jitter: samples may have been lost before being
+      // parsed. Earlier: a previous offset was a long stall after all.
+      double offset = 0.0;
+      if( residual > threshold )
+        offset = floor(residual / period + 0.5);
+      else if( residual < -threshold && shift_ > 0.0 )
+        offset = -std::min(floor(-residual / period + 0.5), shift_);
+
+      if( offset == 0.0 )
+        nb_pending_ = 0;
+      else
+      {
+        nb_pending_ = offset == pending_offset_ ? nb_pending_ + 1 : 1;
+        pending_offset_ = offset;
+
+        //a late frame on its own was sampled on time (the serial thread
+        // stalled): it's timestamped by the model, and kept out of it
+        if( nb_pending_ < confirmation_ )
+        {
+          index_ = index;
+          seq_ = seq;
+          return origin_ + fit(index);
+        }
+
+        //the following frames confirmed the offset
+        index += offset;
+        shift_ += offset;
+        if( offset > 0.0 )
+          nb_missed_ += static_cast<unsigned long>(offset);
+        else
+          nb_missed_ -= std::min(static_cast<unsigned long>(-offset), nb_missed_);
+        residual = time - fit(index);
+        nb_pending_ = 0;
+      }
+    }
+
+    //exponentially weighted regression of the times against the indexes
+    weight_ = forgetting_ * weight_ + 1.0;
+    double delta_index = index - mean_index_;
+    mean_index_ += delta_index / weight_;
+    mean_time_ += (time - mean_time_) / weight_;
+    var_index_ = forgetting_ * var_index_ + delta_index * (index - mean_index_);
+    covar_ = forgetting_ * covar_ + delta_index * (time - mean_time_);
+    residual_var_ = forgetting_ * residual_var_ + (1.0 - forgetting_) * residual * residual;
+
+    index_ = index;
+    seq_ = seq;
+    ++nb_frames_;
+
+    if( nb_frames_ < warmup_ )
+      return arrival;
+    return origin_ + fit(index);
+  }
+
+  double GloveClock::get_period()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if( nb_frames_ < warmup_ || var_index_ <= 0.0 )
+      return nominal_period_;
+    return covar_ / var_index_;
+  }
+
+  double GloveClock::get_jitter()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return sqrt(residual_var_);
+  }
+
+  unsigned long GloveClock::get_nb_missed()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return nb_missed_;
+  }
+
+  void GloveClock::add_diagnostics(diagnostic_msgs::DiagnosticStatus& status)
+  {
+    double period = get_period();
+
+    boost::mutex::scoped_lock lock(mutex_);
+    diagnostic_msgs::KeyValue key_value;
+    std::stringstream ss;
+
+    ss << period * 1000.0;
+    key_value.key = "glove period (ms)";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << sqrt(residual_var_) * 1000.0;
+    key_value.key = "arrival jitter (ms)";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << nb_missed_;
+    key_value.key = "samples missed";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << nb_restarts_;
+    key_value.key = "clock model restarts";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+  }
+
+  void GloveClock::restart(double arrival, unsigned int seq)
+  {
+    origin_ = arrival;
+    index_ = 0.0;
+    seq_ = seq;
+    nb_frames_ = 1;
+    weight_ = 1.0;
+    mean_index_ = mean_time_ = 0.0;
+    var_index_ = covar_ = 0.0;
+    pending_offset_ = shift_ = 0.0;
+    nb_pending_ = 0;
+  }
+
+  double GloveClock::fit(double index) const
+  {
+    double period = nb_frames_ >= warmup_ && var_index_ > 0.0 ? covar_ / var_index_ : nominal_period_;
+    return mean_time_ + period * (index - mean_index_);
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
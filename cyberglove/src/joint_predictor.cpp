@@ -0,0 +1,166 @@
+/**
+ * @file   joint_predictor.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Predicts where the joints will be a short time ahead.
+ *
+ */
+
+#include "cyberglove/joint_predictor.h"
+
+namespace cyberglove
+{
+  JointPredictor::JointPredictor(unsigned int size, predictor_types::predictor_type type, double smoothing,
+                                 double process_noise, double measurement_noise)
+    : type_(type), smoothing_(smoothing), process_noise_(process_noise), measurement_noise_(measurement_noise),
+      nb_updates_(0), last_time_(0.0),
+      position_(size, 0.0), velocity_(size, 0.0), acceleration_(size, 0.0),
+      p00_(size, 0.0), p01_(size, 0.0), p11_(size, 0.0)
+  {
+  }
+
+  bool JointPredictor::parse_type(const std::string& name, predictor_types::predictor_type& type)
+  {
+    if( name == "none" )
+      type = predictor_types::NONE;
+    else if( name == "constant_velocity" )
+      type = predictor_types::CONSTANT_VELOCITY;
+    else if( name == "constant_acceleration" )
+      type = predictor_types::CONSTANT_ACCELERATION;
+    else if( name == "kalman" )
+      type = predictor_types::KALMAN;
+    else
+      return false;
+    return true;
+  }
+
+  void JointPredictor::update(double time, const std::vector<double>& positions)
+  {
+    double dt = time - last_time_;
+
+    //the first frame: nothing to estimate the velocity from
+    if( nb_updates_ == 0 )
+    {
+      for (unsigned int i = 0; i < position_.size(); ++i)
+      {
+        position_[i] = positions[i];
+        velocity_[i] = acceleration_[i] = 0.0;
+        //the velocity is unknown
+        p00_[i] = measurement_noise_;
+        p01_[i] = 0.0;
+        p11_[i] = 1.0;
+      }
+      last_time_ = time;
+      ++nb_updates_;
+      return;
+    }
+
+    //a frame measured at the same time as the previous one replaces it
+    if( dt <= 0.0 )
+    {
+      position_.assign(positions.begin(), positions.begin() + position_.size());
+      return;
+    }
+
+    for (unsigned int i = 0; i < position_.size(); ++i)
+    {
+      switch( type_ )
+      {
+      case predictor_types::CONSTANT_VELOCITY:
+      case predictor_types::CONSTANT_ACCELERATION:
+      {
+        double velocity = (positions[i] - position_[i]) / dt;
+
+        //the acceleration needs two velocities
+        if( type_ == predictor_types::CONSTANT_ACCELERATION && nb_updates_ >= 2 )
+        {
+          double acceleration = (velocity - velocity_[i]) / dt;
+          if( nb_updates_ == 2 )
+            acceleration_[i] = acceleration;
+          else
+            acceleration_[i] = smoothing_ * acceleration_[i] + (1.0 - smoothing_) * acceleration;
+        }
+
+        if( nb_updates_ == 1 )
+          velocity_[i] = velocity;
+        else
+          velocity_[i] = smoothing_ * velocity_[i] + (1.0 - smoothing_) * velocity;
+
+        position_[i] = positions[i];
+        break;
+      }
+
+      case predictor_types::KALMAN:
+      {
+        //prediction, the acceleration being white noise
+        double dt2 = dt * dt;
+        position_[i] += velocity_[i] * dt;
+        p00_[i] += dt * (2.0 * p01_[i] + dt * p11_[i]) + process_noise_ * dt2 * dt2 / 4.0;
+        p01_[i] += dt * p11_[i] + process_noise_ * dt2 * dt / 2.0;
+        p11_[i] += process_noise_ * dt2;
+
+        //correction with the measured position
+        double innovation = positions[i] - position_[i];
+        double k0 = p00_[i] / (p00_[i] + measurement_noise_);
+        double k1 = p01_[i] / (p00_[i] + measurement_noise_);
+        position_[i] += k0 * innovation;
+        velocity_[i] += k1 * innovation;
+        p11_[i] -= k1 * p01_[i];
+        p01_[i] -= k0 * p01_[i];
+        p00_[i] -= k0 * p00_[i];
+        break;
+      }
+
+      default:
+        position_[i] = positions[i];
+        break;
+      }
+    }
+
+    last_time_ = time;
+    ++nb_updates_;
+  }
+
+  void JointPredictor::predict(double horizon, std::vector<double>& positions) const
+  {
+    if( nb_updates_ == 0 )
+      return;
+
+    positions.resize(position_.size());
+    for (unsigned int i = 0; i < position_.size(); ++i)
+    {
+      positions[i] = position_[i];
+      if( type_ != predictor_types::NONE )
+        positions[i] += velocity_[i] * horizon;
+      if( type_ == predictor_types::CONSTANT_ACCELERATION )
+        positions[i] += 0.5 * acceleration_[i] * horizon * horizon;
+    }
+  }
+
+  void JointPredictor::reset()
+  {
+    nb_updates_ = 0;
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,142 @@
+/**
+ * @file   monotone_spline.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief A monotone cubic interpolation (Fritsch-Carlson) of the calibration
+ * points of a joint.
+ *
+ */
+
+#include "cyberglove/monotone_spline.h"
+
+#include <algorithm>
+#include <utility>
+#include <math.h>
+
+namespace cyberglove
+{
+  MonotoneSpline::MonotoneSpline()
+  {
+  }
+
+  bool MonotoneSpline::set_points(const std::vector<double>& x, const std::vector<double>& y)
+  {
+    //order the points by ascending x (stable: the first of the duplicates is kept)
+    std::vector<std::pair<double, double> > points;
+    for (unsigned int i = 0; i < x.size() && i < y.size(); ++i)
+      points.push_back(std::make_pair(x[i], y[i]));
+    std::stable_sort(points.begin(), points.end(), compare_x);
+
+    x_.clear();
+    y_.clear();
+    for (unsigned int i = 0; i < points.size(); ++i)
+    {
+      if( !x_.empty() && points[i].first == x_.back() )
+        continue;
+      x_.push_back(points[i].first);
+      y_.push_back(points[i].second);
+    }
+
+    unsigned int n = x_.size();
+    m_.assign(n, 0.0);
+    if( n < 2 )
+      return false;
+
+    //the slopes of the segments
+    std::vector<double> delta(n - 1);
+    for (unsigned int k = 0; k < n - 1; ++k)
+      delta[k] = (y_[k + 1] - y_[k]) / (x_[k + 1] - x_[k]);
+
+    //initial tangents: the slope of the segment at the ends, the average of the
+    // neighbouring slopes inside (0 at the local extrema)
+    m_[0] = delta[0];
+    m_[n - 1] = delta[n - 2];
+    for (unsigned int k = 1; k < n - 1; ++k)
+    {
+      if( delta[k - 1] * delta[k] <= 0.0 )
+        m_[k] = 0.0;
+      else
+        m_[k] = (delta[k - 1] + delta[k]) / 2.0;
+    }
+
+    //limit the tangents so that each segment is monotone
+    for (unsigned int k = 0; k < n - 1; ++k)
+    {
+      if( delta[k] == 0.0 )
+      {
+        m_[k] = 0.0;
+        m_[k + 1] = 0.0;
+        continue;
+      }
+
+      double alpha = m_[k] / delta[k];
+      double beta = m_[k + 1] / delta[k];
+      double norm = alpha * alpha + beta * beta;
+      if( norm > 9.0 )
+      {
+        double tau = 3.0 / sqrt(norm);
+        m_[k] = tau * alpha * delta[k];
+        m_[k + 1] = tau * beta * delta[k];
+      }
+    }
+
+    return true;
+  }
+
+  double MonotoneSpline::evaluate(double x) const
+  {
+    if( x_.empty() )
+      return 0.0;
+
+    unsigned int n = x_.size();
+
+    //linear extrapolation with the slope of the ends
+    if( x <= x_[0] )
+      return y_[0] + (x - x_[0]) * m_[0];
+    if( x >= x_[n - 1] )
+      return y_[n - 1] + (x - x_[n - 1]) * m_[n - 1];
+
+    //the segment [x_[k], x_[k+1]] containing x
+    unsigned int k = std::upper_bound(x_.begin(), x_.end(), x) - x_.begin() - 1;
+
+    double h = x_[k + 1] - x_[k];
+    double t = (x - x_[k]) / h;
+    double t2 = t * t;
+    double t3 = t2 * t;
+
+    //cubic Hermite basis
+    double h00 = 2.0 * t3 - 3.0 * t2 + 1.0;
+    double h10 = t3 - 2.0 * t2 + t;
+    double h01 = -2.0 * t3 + 3.0 * t2;
+    double h11 = t3 - t2;
+
+    return h00 * y_[k] + h10 * h * m_[k] + h01 * y_[k + 1] + h11 * h * m_[k + 1];
+  }
+
+  bool MonotoneSpline::compare_x(const std::pair<double, double>& a, const std::pair<double, double>& b)
+  {
+    return a.first < b.first;
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,170 @@
+/**
+ * @file   publish_scheduler.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Clocks the outputs of the glove nodes on a steady timer.
+ *
+ */
+
+#include "cyberglove/publish_scheduler.h"
+
+#include <sstream>
+#include <diagnostic_msgs/KeyValue.h>
+
+namespace cyberglove
+{
+  const double PublishScheduler::rate_window = 1.0;
+
+  PublishScheduler::PublishScheduler()
+  {
+  }
+
+  PublishScheduler::~PublishScheduler()
+  {
+    stop();
+  }
+
+  void PublishScheduler::add_output(const std::string& name, double frequency, PublishFunction publish_function)
+  {
+    if( frequency <= 0.0 )
+    {
+      ROS_WARN("The %s output has a null frequency, it won't be published", name.c_str());
+      return;
+    }
+
+    Output output;
+    output.name = name;
+    output.frequency = frequency;
+    output.period = boost::chrono::duration_cast<Clock::duration>(boost::chrono::duration<double>(1.0 / frequency));
+    output.publish_function = publish_function;
+    output.nb_published = 0;
+    output.nb_overruns = 0;
+    output.achieved_frequency = 0.0;
+    outputs_.push_back(output);
+
+    ROS_INFO("Publishing %s at %fHz", name.c_str(), frequency);
+  }
+
+  void PublishScheduler::start(const ThreadConfig& config)
+  {
+    thread_ = boost::thread(boost::bind(&PublishScheduler::run, this, config));
+  }
+
+  void PublishScheduler::stop()
+  {
+    thread_.interrupt();
+    if( thread_.joinable() )
+      thread_.join();
+  }
+
+  void PublishScheduler::run(ThreadConfig config)
+  {
+    config.apply_to_current_thread("publish");
+
+    Clock::time_point now = Clock::now();
+    window_start_ = now;
+    for (unsigned int i = 0; i < outputs_.size(); ++i)
+      outputs_[i].next_tick = now + outputs_[i].period;
+
+    try
+    {
+      while( !outputs_.empty() )
+      {
+        //sleep until the next output is due
+        Clock::time_point next_tick = outputs_[0].next_tick;
+        for (unsigned int i = 1; i < outputs_.size(); ++i)
+          next_tick = std::min(next_tick, outputs_[i].next_tick);
+        boost::this_thread::sleep_until(next_tick);
+
+        now = Clock::now();
+        for (unsigned int i = 0; i < outputs_.size(); ++i)
+        {
+          Output& output = outputs_[i];
+          if( output.next_tick > now )
+            continue;
+
+          if( output.publish_function() )
+            ++output.nb_published;
+
+          //the ticks are computed from the previous tick, not from now, so
+          // that the rate doesn't drift. If we're late by more than a period,
+          // the missed ticks are skipped.
+          output.next_tick += output.period;
+          if( output.next_tick <= now )
+          {
+            ++output.nb_overruns;
+            output.next_tick = now + output.period;
+          }
+        }
+
+        update_rates(now);
+      }
+    }
+    catch(boost::thread_interrupted&)
+    {
+    }
+  }
+
+  void PublishScheduler::update_rates(Clock::time_point now)
+  {
+    double elapsed = boost::chrono::duration<double>(now - window_start_).count();
+    if( elapsed < rate_window )
+      return;
+
+    for (unsigned int i = 0; i < outputs_.size(); ++i)
+    {
+      outputs_[i].achieved_frequency = outputs_[i].nb_published / elapsed;
+      outputs_[i].nb_published = 0;
+      ROS_DEBUG("%s: target %fHz, achieved %fHz", outputs_[i].name.c_str(), outputs_[i].frequency, outputs_[i].achieved_frequency);
+    }
+    window_start_ = now;
+  }
+
+  void PublishScheduler::add_diagnostics(diagnostic_msgs::DiagnosticStatus& status) const
+  {
+    for (unsigned int i = 0; i < outputs_.size(); ++i)
+    {
+      diagnostic_msgs::KeyValue key_value;
+      std::stringstream ss;
+
+      key_value.key = outputs_[i].name + " target rate (Hz)";
+      ss << outputs_[i].frequency;
+      key_value.value = ss.str();
+      status.values.push_back(key_value);
+
+      key_value.key = outputs_[i].name + " achieved rate (Hz)";
+      ss.str("");
+      ss << outputs_[i].achieved_frequency;
+      key_value.value = ss.str();
+      status.values.push_back(key_value);
+
+      key_value.key = outputs_[i].name + " overruns";
+      ss.str("");
+      ss << outputs_[i].nb_overruns;
+      key_value.value = ss.str();
+      status.values.push_back(key_value);
+    }
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,97 @@
+/**
+ * @file   sample_accumulator.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Accumulates the glove samples received between two publishing ticks.
+ *
+ */
+
+#include "cyberglove/sample_accumulator.h"
+
+namespace cyberglove
+{
+  SampleAccumulator::SampleAccumulator(unsigned int size, bool averaging)
+    : averaging_(averaging), nb_samples_(0), sum_(size, 0.0), latest_(size, 0.0f), latest_seq_(0), stamp_sum_(0.0), latest_stamp_(0.0)
+  {
+  }
+
+  void SampleAccumulator::add_sample(const std::vector<float>& sample, unsigned int seq, double stamp)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    for (unsigned int i = 0; i < sum_.size(); ++i)
+    {
+      sum_[i] += sample[i];
+      latest_[i] = sample[i];
+    }
+    latest_seq_ = seq;
+    stamp_sum_ += stamp;
+    latest_stamp_ = stamp;
+    ++nb_samples_;
+  }
+
+  unsigned int SampleAccumulator::take(std::vector<float>& output)
+  {
+    unsigned int seq;
+    double stamp;
+    return take(output, seq, stamp);
+  }
+
+  unsigned int SampleAccumulator::take(std::vector<float>& output, unsigned int& seq, double& stamp)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    unsigned int nb_samples = nb_samples_;
+    if( nb_samples == 0 )
+      return 0;
+
+    output.resize(sum_.size());
+    for (unsigned int i = 0; i < sum_.size(); ++i)
+    {
+      if( averaging_ )
+        output[i] = static_cast<float>(sum_[i] / nb_samples);
+      else
+        output[i] = latest_[i];
+      sum_[i] = 0.0;
+    }
+    nb_samples_ = 0;
+    seq = latest_seq_;
+    //the average sample was taken at the average time
+    stamp = averaging_ ? stamp_sum_ / nb_samples : latest_stamp_;
+    stamp_sum_ = 0.0;
+
+    return nb_samples;
+  }
+
+  void SampleAccumulator::reset()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    for (unsigned int i = 0; i < sum_.size(); ++i)
+      sum_[i] = 0.0;
+    stamp_sum_ = 0.0;
+    nb_samples_ = 0;
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
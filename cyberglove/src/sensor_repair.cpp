@@ -0,0 +1,159 @@
+/**
+ * @file   sensor_repair.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Repairs the invalid sensor values of the glove frames.
+ *
+ */
+
+#include "cyberglove/sensor_repair.h"
+#include "cyberglove/glove_joints.h"
+#include <algorithm>
+#include <sstream>
+
+namespace cyberglove
+{
+  SensorRepair::SensorRepair(unsigned int nb_sensors, unsigned int history, unsigned int max_invalid)
+    : history_(history), max_invalid_(max_invalid), values_(nb_sensors), next_(nb_sensors, 0),
+      scratch_(history), nb_repaired_(nb_sensors, 0), nb_frames_(0), nb_repaired_frames_(0)
+  {
+    for (size_t i = 0; i < values_.size(); ++i)
+      values_[i].reserve(history_);
+  }
+
+  void SensorRepair::configure(unsigned int history, unsigned int max_invalid)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    history_ = history;
+    max_invalid_ = max_invalid;
+    scratch_.resize(history_);
+    for (size_t i = 0; i < values_.size(); ++i)
+    {
+      values_[i].clear();
+      values_[i].reserve(history_);
+      next_[i] = 0;
+    }
+  }
+
+  bool SensorRepair::repair(std::vector<float>& positions, const std::vector<bool>& valid)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    size_t size = std::min(positions.size(), values_.size());
+    unsigned int nb_invalid = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+      if( valid[i] )
+        continue;
+      //nothing to repair it from
+      if( history_ == 0 || values_[i].empty() )
+        return false;
+      ++nb_invalid;
+    }
+    if( nb_invalid > max_invalid_ )
+      return false;
+
+    ++nb_frames_;
+    if( nb_invalid > 0 )
+      ++nb_repaired_frames_;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+      if( !valid[i] )
+      {
+        positions[i] = median(i);
+        ++nb_repaired_[i];
+        continue;
+      }
+
+      if( history_ == 0 )
+        continue;
+      //the oldest value is overwritten once the history is full
+      if( values_[i].size() < history_ )
+        values_[i].push_back(positions[i]);
+      else
+        values_[i][next_[i]] = positions[i];
+      next_[i] = (next_[i] + 1) % history_;
+    }
+    return true;
+  }
+
+  float SensorRepair::median(unsigned int sensor)
+  {
+    //the history is left in its order: the median is selected in the scratch buffer
+    const std::vector<float>& values = values_[sensor];
+    std::copy(values.begin(), values.end(), scratch_.begin());
+    std::vector<float>::iterator end = scratch_.begin() + values.size();
+    std::vector<float>::iterator middle = scratch_.begin() + values.size() / 2;
+    std::nth_element(scratch_.begin(), middle, end);
+    return *middle;
+  }
+
+  unsigned long SensorRepair::get_nb_repaired(unsigned int sensor)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return sensor < nb_repaired_.size() ? nb_repaired_[sensor] : 0;
+  }
+
+  double SensorRepair::get_repair_rate(unsigned int sensor)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if( nb_frames_ == 0 || sensor >= nb_repaired_.size() )
+      return 0.0;
+    return static_cast<double>(nb_repaired_[sensor]) / nb_frames_;
+  }
+
+  void SensorRepair::add_diagnostics(diagnostic_msgs::DiagnosticStatus& status)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    diagnostic_msgs::KeyValue key_value;
+    std::stringstream ss;
+
+    ss << nb_repaired_frames_;
+    key_value.key = "frames repaired";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    //only the sensors which glitched: a healthy glove doesn't list all of them
+    for (size_t i = 0; i < nb_repaired_.size(); ++i)
+    {
+      if( nb_repaired_[i] == 0 )
+        continue;
+
+      ss.str("");
+      ss << 100.0 * nb_repaired_[i] / nb_frames_ << " (" << nb_repaired_[i] << ")";
+      if( i < glove_sensors::NB_SENSORS )
+        key_value.key = std::string(glove_sensors::names[i]) + " repaired (%)";
+      else
+      {
+        std::stringstream name;
+        name << "sensor " << i << " repaired (%)";
+        key_value.key = name.str();
+      }
+      key_value.value = ss.str();
+      status.values.push_back(key_value);
+    }
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
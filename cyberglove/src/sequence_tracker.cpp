@@ -0,0 +1,71 @@
+/**
+ * @file   sequence_tracker.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Counts the frames missing from a stage's output.
+ *
+ */
+
+#include "cyberglove/sequence_tracker.h"
+#include <sstream>
+
+namespace cyberglove
+{
+  SequenceTracker::SequenceTracker()
+    : first_(true), last_seq_(0), nb_frames_(0), nb_missing_(0)
+  {
+  }
+
+  unsigned int SequenceTracker::add(unsigned int seq)
+  {
+    unsigned int missing = 0;
+    //the first frame, or the numbering restarted: nothing to compare to
+    if( !first_ && seq > last_seq_ )
+      missing = seq - last_seq_ - 1;
+
+    first_ = false;
+    last_seq_ = seq;
+    ++nb_frames_;
+    nb_missing_ += missing;
+    return missing;
+  }
+
+  void SequenceTracker::add_diagnostics(const std::string& output, diagnostic_msgs::DiagnosticStatus& status) const
+  {
+    diagnostic_msgs::KeyValue key_value;
+    std::stringstream ss;
+
+    ss << last_seq_;
+    key_value.key = output + " last frame";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << nb_missing_;
+    key_value.key = output + " missing frames";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -41,9 +41,11 @@ namespace cyberglove
   const unsigned short CybergloveSerial::glove_size = 22;
   const unsigned short CybergloveSerial::timestamp_size = 14;
 
-  CybergloveSerial::CybergloveSerial(std::string serial_port, std::string cyberglove_version, std::string streaming_protocol, boost::function<void(std::vector<float>, bool)> callback) :
-    nb_msgs_received(0), glove_pos_index(0), timestamp_bytes_(0), byte_index_(0), current_value(0), sensor_value_(0), light_on(true), button_on(true), no_errors(true),
-    cyberglove_version_(cyberglove_version), reception_state_(INITIAL), streaming_protocol_(streaming_protocol)
+  CybergloveSerial::CybergloveSerial(std::string serial_port, std::string cyberglove_version, std::string streaming_protocol, boost::function<void(std::vector<float>, bool, unsigned int)> callback) :
+    nb_msgs_received(0), glove_pos_index(0), timestamp_bytes_(0), byte_index_(0), nb_frames_rejected(0), current_value(0), sensor_value_(0), light_on(true), button_on(true),
+    sensor_valid(glove_size, true), sensor_repair(glove_size),
+    cyberglove_version_(cyberglove_version), streaming_protocol_(streaming_protocol), reception_state_(INITIAL),
+    thread_configured_(false)
   {
     //initialize the vector of positions with 0s
     for (int i = 0; i < glove_size; ++i)
@@ -120,6 +122,21 @@ namespace cyberglove
     return 0;
   }
 
+  void CybergloveSerial::set_thread_config(const ThreadConfig& config)
+  {
+    thread_config_ = config;
+  }
+
+  void CybergloveSerial::set_sensor_repair(unsigned int history, unsigned int max_invalid)
+  {
+    sensor_repair.configure(history, max_invalid);
+  }
+
+  SensorRepair& CybergloveSerial::get_sensor_repair()
+  {
+    return sensor_repair;
+  }
+
   int CybergloveSerial::start_stream()
   {
     std::cout << "starting stream"<<std::endl;
@@ -147,6 +164,13 @@ namespace cyberglove
 
   void CybergloveSerial::stream_callback(char* world, int length)
   {
+    //the cereal_port thread is only known once it calls us
+    if( !thread_configured_ )
+    {
+      thread_config_.apply_to_current_thread("serial");
+      thread_configured_ = true;
+    }
+
     //read each received char.
     for (int i = 0; i < length; ++i)
     {
@@ -154,9 +178,6 @@ namespace cyberglove
 
       if((cyberglove_version_ == "3") && (streaming_protocol_ == "16bit"))
       {
-        char aux[30];
-//        sprintf(aux, "0x%X", current_value);
-//        std::cout << aux << std::endl;
         switch(reception_state_)
         {
           case reception_16bit::SYNCHRONIZATION_1:
@@ -210,8 +231,8 @@ namespace cyberglove
                 //reset the index to 0
                 glove_pos_index = 0;
                 byte_index_ = 0;
-                //reset no_errors to true for the new message
-                no_errors = true;
+                //all the sensors are valid until proven otherwise
+                sensor_valid.assign(glove_size, true);
                 reception_state_ = reception_16bit::RECEIVING_FRAME;
               }
               else
@@ -230,16 +251,12 @@ namespace cyberglove
 //              char aux[30];
 //              sprintf(aux, "%u", sensor_value_);
 //              std::cout << aux << std::endl;
-              if (sensor_value_ > 0x0FFF)
-              {
-                sprintf(aux, "%u", sensor_value_);
-
-                std::cout << "bad sensor value: " << aux << " Reset frame" << std::endl;
-                reception_state_ = reception_16bit::SYNCHRONIZATION_1;
-                break;
-              }
-
-              glove_positions[glove_pos_index] = (((float)sensor_value_) - 1.0f) / (float)(0x0FFF - 1);
+              //the value in the message should never be 0 or out of range:
+              // that sensor is repaired when the frame ends
+              if ((sensor_value_ == 0) || (sensor_value_ > 0x0FFF))
+                sensor_valid[glove_pos_index] = false;
+              else
+                glove_positions[glove_pos_index] = (((float)sensor_value_) - 1.0f) / (float)(0x0FFF - 1);
               ++glove_pos_index;
               byte_index_ = 0;
             }
@@ -248,18 +265,10 @@ namespace cyberglove
               sensor_value_ = current_value << 8;
               byte_index_ = 1;
             }
-            //this is a joint data from the glove
-            //the value in the message should never be 0.
-            if((byte_index_ == 0) && (sensor_value_ == 0))
-            {
-              no_errors = false;
-              std::cout << "error detected" << std::endl;
-            }
 
             if (glove_pos_index == glove_size)
             {
-              if(no_errors)
-                callback_function(glove_positions, true);
+              frame_end(true, true);
               reception_state_ = reception_16bit::SYNCHRONIZATION_1;
             }
             break;
@@ -277,8 +286,8 @@ namespace cyberglove
               ++nb_msgs_received;
               //reset the index to 0
               glove_pos_index = 0;
-              //reset no_errors to true for the new message
-              no_errors = true;
+              //all the sensors are valid until proven otherwise
+              sensor_valid.assign(glove_size, true);
               reception_state_ = RECEIVING_FRAME;
               break;
             }
@@ -314,8 +323,7 @@ namespace cyberglove
                 //the last char of the line should be 0
                 //if it is 0, then the full message has been received,
                 //and we call the callback function.
-                if( current_value == 0 && no_errors)
-                  callback_function(glove_positions, light_on);
+                frame_end(current_value == 0, light_on);
                 if( current_value != 0)
                   std::cout << "Last char is not 0: " << current_value << std::endl;
 
@@ -330,8 +338,7 @@ namespace cyberglove
                 // most of the time we get 83, but other numbers have been observed occasionally
                 //if it is 83, then the full message has been received,
                 //and we call the callback function.
-                if( current_value == 83 && no_errors)
-                  callback_function(glove_positions, light_on);
+                frame_end(current_value == 83, light_on);
                 if( current_value != 83)
                   std::cout << "Last char is not 0: " << current_value << std::endl;
               }
@@ -340,8 +347,7 @@ namespace cyberglove
                 //the last char of the line should be 0
                 //if it is 0, then the full message has been received,
                 //and we call the callback function.
-                if( current_value == 0 && no_errors)
-                  callback_function(glove_positions, light_on);
+                frame_end(current_value == 0, light_on);
                 if( current_value != 0)
                   std::cout << "Last char is not 0: " << current_value << std::endl;
               }
@@ -350,10 +356,12 @@ namespace cyberglove
 
             default:
               //this is a joint data from the glove
-              //the value in the message should never be 0.
+              //the value in the message should never be 0: that sensor
+              // is repaired when the frame ends
               if( current_value == 0)
               {
-                no_errors = false;
+                sensor_valid[glove_pos_index] = false;
+                break;
               }
               // the values sent by the glove are in the range [1;254]
               //   -> we convert them to float in the range [0;1]
@@ -367,10 +375,25 @@ namespace cyberglove
     }
   }
 
+  void CybergloveSerial::frame_end(bool valid, bool light)
+  {
+    //the frame number is the count of the frames started, so the frames
+    // rejected or lost in the stream leave a gap in the numbers
+    if( valid && sensor_repair.repair(glove_positions, sensor_valid) )
+      callback_function(glove_positions, light, nb_msgs_received);
+    else
+      ++nb_frames_rejected;
+  }
+
   int CybergloveSerial::get_nb_msgs_received()
   {
     return nb_msgs_received;
   }
+
+  unsigned int CybergloveSerial::get_nb_frames_rejected()
+  {
+    return nb_frames_rejected;
+  }
 }
 
 /* For the emacs weenies in the crowd.
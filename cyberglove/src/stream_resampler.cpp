@@ -0,0 +1,101 @@
+/**
+ * @file   stream_resampler.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Resamples a stream of timestamped frames at arbitrary times.
+ *
+ */
+
+#include "cyberglove/stream_resampler.h"
+#include <algorithm>
+
+namespace cyberglove
+{
+  StreamResampler::StreamResampler(unsigned int history)
+    : history_(std::max(history, 2u))
+  {
+  }
+
+  bool StreamResampler::add(double stamp, const std::vector<double>& positions)
+  {
+    if( !frames_.empty() && stamp <= frames_.back().stamp )
+      return false;
+
+    //the oldest frame is recycled
+    if( frames_.size() >= history_ )
+    {
+      frames_.push_back(Frame());
+      frames_.back().positions.swap(frames_.front().positions);
+      frames_.pop_front();
+    }
+    else
+      frames_.push_back(Frame());
+
+    frames_.back().stamp = stamp;
+    frames_.back().positions.assign(positions.begin(), positions.end());
+    return true;
+  }
+
+  bool StreamResampler::sample(double time, std::vector<double>& positions, double& error) const
+  {
+    if( frames_.empty() )
+      return false;
+
+    //outside of the frames received: the closest one is held
+    if( time <= frames_.front().stamp )
+    {
+      positions.assign(frames_.front().positions.begin(), frames_.front().positions.end());
+      error = frames_.front().stamp - time;
+      return true;
+    }
+    if( time >= frames_.back().stamp )
+    {
+      positions.assign(frames_.back().positions.begin(), frames_.back().positions.end());
+      error = time - frames_.back().stamp;
+      return true;
+    }
+
+    //the frames are sorted: the first one after time
+    size_t next = 1;
+    while( frames_[next].stamp < time )
+      ++next;
+    const Frame& before = frames_[next - 1];
+    const Frame& after = frames_[next];
+
+    double ratio = (time - before.stamp) / (after.stamp - before.stamp);
+    size_t size = std::min(before.positions.size(), after.positions.size());
+    positions.resize(size);
+    for (size_t i = 0; i < size; ++i)
+      positions[i] = before.positions[i] + ratio * (after.positions[i] - before.positions[i]);
+
+    error = std::min(time - before.stamp, after.stamp - time);
+    return true;
+  }
+
+  double StreamResampler::newest_stamp() const
+  {
+    return frames_.empty() ? 0.0 : frames_.back().stamp;
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
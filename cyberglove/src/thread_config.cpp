@@ -0,0 +1,88 @@
+/**
+ * @file   thread_config.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Scheduling settings (cpu affinity, realtime priority) for the
+ * threads of the glove nodes.
+ *
+ */
+
+#include "cyberglove/thread_config.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+namespace cyberglove
+{
+  ThreadConfig::ThreadConfig()
+    : cpu_affinity(-1), priority(0)
+  {
+  }
+
+  ThreadConfig ThreadConfig::from_parameters(const ros::NodeHandle& nh, const std::string& thread_name)
+  {
+    ThreadConfig config;
+    nh.param(thread_name + "/cpu_affinity", config.cpu_affinity, -1);
+    nh.param(thread_name + "/priority", config.priority, 0);
+    return config;
+  }
+
+  int ThreadConfig::apply_to_current_thread(const std::string& thread_name) const
+  {
+    int res = 0;
+
+    if( cpu_affinity >= 0 )
+    {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      CPU_SET(cpu_affinity, &cpu_set);
+      int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+      if( err != 0 )
+      {
+        ROS_WARN("Couldn't pin the %s thread to cpu %d: %s", thread_name.c_str(), cpu_affinity, strerror(err));
+        res = -1;
+      }
+      else
+        ROS_INFO("The %s thread is pinned to cpu %d", thread_name.c_str(), cpu_affinity);
+    }
+
+    if( priority > 0 )
+    {
+      struct sched_param param;
+      param.sched_priority = priority;
+      int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+      if( err != 0 )
+      {
+        ROS_WARN("Couldn't set the %s thread priority to %d (SCHED_FIFO): %s", thread_name.c_str(), priority, strerror(err));
+        res = -1;
+      }
+      else
+        ROS_INFO("The %s thread runs with SCHED_FIFO priority %d", thread_name.c_str(), priority);
+    }
+
+    return res;
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
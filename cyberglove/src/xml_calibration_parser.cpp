@@ -32,6 +32,10 @@
  * The calibration will be used by the glove node to stream coherent
  * angles (and not an uncalibrated sensor value between 0 and 1).
  *
+ * The calibration points are interpolated with a monotone cubic spline,
+ * evaluated once into a lookup table when the calibration is loaded. The
+ * raw values are interpolated linearly between the entries of the table.
+ *
  *
  */
 
@@ -39,8 +43,14 @@
 #include <ros/ros.h>
 
 #include "cyberglove/xml_calibration_parser.h"
+#include "cyberglove/calibration_cache.h"
 
 #include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 namespace xml_calibration_parser{
 
@@ -54,8 +64,10 @@ namespace xml_calibration_parser{
    * @param path_to_calibration the path to the xml calibration
    * file. Please note that it is best to use ros parameters to set
    * the path in your code calling this constructor.
+   * @param path_to_cache the path to the binary cache of the lookup
+   * tables, empty for no cache.
    */
-  XmlCalibrationParser::XmlCalibrationParser(std::string path_to_calibration)
+  XmlCalibrationParser::XmlCalibrationParser(const std::string& path_to_calibration, const std::string& path_to_cache)
   {
     TiXmlDocument doc(path_to_calibration.c_str());
     bool loadOkay = doc.LoadFile();
@@ -64,7 +76,7 @@ namespace xml_calibration_parser{
 	ROS_DEBUG("loading calibration %s", path_to_calibration.c_str());
 	parse_calibration_file( doc.RootElement() );
 
-	build_calibration_table();
+	build_calibration_table(path_to_cache);
       }
     else
       {
@@ -72,6 +84,13 @@ namespace xml_calibration_parser{
       }
   }
 
+  XmlCalibrationParser::XmlCalibrationParser(const std::vector<JointCalibration>& joints_calibrations,
+                                             const std::string& path_to_cache)
+    : jointsCalibrations(joints_calibrations)
+  {
+    build_calibration_table(path_to_cache);
+  }
+
   /**
    * Parses the calibration file and retreive the full calibration for
    * the cyberglove.
@@ -168,109 +187,108 @@ namespace xml_calibration_parser{
   /**
    * Transform the calibration values to a lookup table for fast
    * processing of the calibration process.
-   * NB: the lookup table ranges from 0 to +lookup_offset
+   * NB: the lookup table ranges from 0 to +lookup_offset (both included)
    * with a precision of 1/lookup_precision.
    *
    */
-  int XmlCalibrationParser::build_calibration_table()
+  int XmlCalibrationParser::build_calibration_table(const std::string& path_to_cache)
   {
-    for (unsigned int index_calib = 0; index_calib < jointsCalibrations.size(); ++index_calib)
-    {
-      std::string name = jointsCalibrations[index_calib].name;
-      std::cout << name << std::endl;
-
-      std::vector<Calibration> calib = jointsCalibrations[index_calib].calibrations;
+    ros::WallTime start = ros::WallTime::now();
+    unsigned int table_size = (int)lookup_offset*(int)lookup_precision + 1;
+    boost::uint64_t source_hash = hash_calibrations();
 
-      std::vector<float> lookup_table((int)lookup_offset*(int)lookup_precision);
-
-      if( calib.size() < 2 )
-	ROS_ERROR("Not enough points were defined to set up the calibration.");
+    if( !path_to_cache.empty() &&
+        cyberglove::CalibrationCache::load(path_to_cache, source_hash, table_size, joints_calibrations_map) )
+    {
+      ROS_INFO("Calibration lookup tables loaded from %s in %.2fms", path_to_cache.c_str(),
+               (ros::WallTime::now() - start).toSec() * 1000.0);
+      return 0;
+    }
 
-      //order the calibration vector by ascending values of raw_value
-      //      ROS_ERROR("TODO: calibration vector not ordered yet");
+    for (unsigned int index_calib = 0; index_calib < jointsCalibrations.size(); ++index_calib)
+    {
+      const std::string& name = jointsCalibrations[index_calib].name;
+      const std::vector<Calibration>& calib = jointsCalibrations[index_calib].calibrations;
 
-      std::cout << "lookup table : ";
+      //the calibration curve goes through all the calibration points, which
+      // don't need to be ordered
+      std::vector<double> raw_values, calibrated_values;
+      for (unsigned int i = 0; i < calib.size(); ++i)
+      {
+        raw_values.push_back(calib[i].raw_value);
+        calibrated_values.push_back(calib[i].calibrated_value);
+      }
+      cyberglove::MonotoneSpline spline;
+      if( !spline.set_points(raw_values, calibrated_values) )
+	ROS_ERROR("Not enough points were defined to set up the calibration of %s.", name.c_str());
 
-      //setup the lookup table
+      //setup the lookup table, directly in the map
+      std::vector<float>& lookup_table = joints_calibrations_map[name];
+      lookup_table.resize(table_size);
       for( unsigned int index_lookup = 0;
 	   index_lookup < lookup_table.size() ;
 	   ++ index_lookup )
-	{
-	  float value = compute_lookup_value(index_lookup, calib);
-	  std::cout << index_lookup<<":"<<value << " ";
-	  lookup_table[index_lookup] = value;
-	}
-
-      std::cout << std::endl;
+	lookup_table[index_lookup] = compute_lookup_value(index_lookup, spline);
 
-      //add the values to the map
-      joints_calibrations_map[name] = lookup_table;
-      //joints_calibrations_map.insert(std::pair <std::string, std::vector<float> >(name, lookup_table));
+      ROS_DEBUG_STREAM("Calibration lookup table for " << name << " built from "
+                       << calib.size() << " points");
     }
 
+    ROS_INFO("Calibration lookup tables built in %.2fms", (ros::WallTime::now() - start).toSec() * 1000.0);
+
+    if( !path_to_cache.empty() &&
+        cyberglove::CalibrationCache::save(path_to_cache, source_hash, table_size, joints_calibrations_map) )
+      ROS_INFO("Calibration lookup tables cached in %s", path_to_cache.c_str());
+
     return 0;
   }
 
+  boost::uint64_t XmlCalibrationParser::hash_calibrations() const
+  {
+    boost::uint64_t hash = cyberglove::CalibrationCache::hash_seed;
+    for (unsigned int i = 0; i < jointsCalibrations.size(); ++i)
+    {
+      const JointCalibration& joint = jointsCalibrations[i];
+      //hash the name with its terminating 0, so that the names are delimited
+      hash = cyberglove::CalibrationCache::hash(joint.name.c_str(), joint.name.size() + 1, hash);
+      for (unsigned int j = 0; j < joint.calibrations.size(); ++j)
+      {
+        hash = cyberglove::CalibrationCache::hash(&joint.calibrations[j].raw_value, sizeof(float), hash);
+        hash = cyberglove::CalibrationCache::hash(&joint.calibrations[j].calibrated_value, sizeof(float), hash);
+      }
+      //delimit the joints
+      boost::uint32_t nb_points = joint.calibrations.size();
+      hash = cyberglove::CalibrationCache::hash(&nb_points, sizeof(nb_points), hash);
+    }
+    return hash;
+  }
+
   /**
    * return the value to store in the lookup table for a given index,
-   * using the calibration information.
+   * using the calibration curve.
    *
    * @param index the index for which we compute the value
    *
-   * @param calib the vector containing the calibration informations
-   * (a list of raw_value <=> calibrated_value)
+   * @param spline the calibration curve of the joint (monotone cubic
+   * interpolation of the calibration points, extrapolated linearly)
    *
    * @return the value to be stored in the lookup table
    */
-  float XmlCalibrationParser::compute_lookup_value(int index, std::vector<XmlCalibrationParser::Calibration> calib)
+  float XmlCalibrationParser::compute_lookup_value(int index, const cyberglove::MonotoneSpline& spline)
   {
-    float raw_pos = return_raw_position_from_index(index);
-
-    if(calib.size() == 2)
-      return linear_interpolate( raw_pos,
-				 calib[0].raw_value,
-				 calib[0].calibrated_value,
-				 calib[1].raw_value,
-				 calib[1].calibrated_value
-			     );
-
-
-    for( unsigned int index_calib = 0; index_calib < calib.size() - 1;
-	 ++index_calib)
-      {
-	if(calib[index_calib].raw_value > raw_pos)
-	  {
-	    return linear_interpolate( raw_pos,
-				       calib[index_calib].raw_value,
-				       calib[index_calib].calibrated_value,
-				       calib[index_calib+1].raw_value,
-				       calib[index_calib+1].calibrated_value
-				     );
-	  }
-      }
-
-    //bigger than last calibrated value => extrapolate the value from
-    //last 2 values
-    //TODO: ca marche la formule si on est en dehors des points ? oui
-    return linear_interpolate( raw_pos,
-			       calib[calib.size()-1].raw_value,
-			       calib[calib.size()-1].calibrated_value,
-			       calib[calib.size()].raw_value,
-			       calib[calib.size()].calibrated_value
-			     );
-
+    return static_cast<float>(spline.evaluate(return_raw_position_from_index(index)));
   }
 
-  float XmlCalibrationParser::get_calibration_value(float position, std::string joint_name)
+  float XmlCalibrationParser::get_calibration_value(float position, const std::string& joint_name) const
   {
-    mapType::iterator iter = joints_calibrations_map.find(joint_name);
+    mapType::const_iterator iter = joints_calibrations_map.find(joint_name);
 
     if( iter != joints_calibrations_map.end() )
       {
-	//reads from the lookup table
-	int index = return_index_from_raw_position(position);
-	std::cout << index << std::endl;
-	return iter->second[index];
+	//interpolates between the entries of the lookup table
+	float fraction;
+	int index = return_index_from_raw_position(position, fraction);
+	return interpolate(&iter->second[index], fraction);
       }
     else
       {
@@ -279,33 +297,106 @@ namespace xml_calibration_parser{
       }
   }
 
-  float XmlCalibrationParser::linear_interpolate( float x ,
-						  float x0, float y0,
-						  float x1, float y1 )
+  int XmlCalibrationParser::set_channels(const std::vector<std::string>& joint_names)
   {
+    int table_size = (int)lookup_offset*(int)lookup_precision + 1;
+    int nb_missing = 0;
 
-    //TODO ca marche qd c'est decroissant ca? oui
-    float y = 0.0f;
-    if( x1 - x0 == 0.0f )
+    channel_tables.resize(joint_names.size() * table_size);
+    channel_offsets.resize(joint_names.size());
+    for (unsigned int channel = 0; channel < joint_names.size(); ++channel)
+    {
+      channel_offsets[channel] = channel * table_size;
+      std::vector<float>::iterator table = channel_tables.begin() + channel_offsets[channel];
+
+      mapType::const_iterator iter = joints_calibrations_map.find(joint_names[channel]);
+      if( iter != joints_calibrations_map.end() && (int)iter->second.size() == table_size )
+        std::copy(iter->second.begin(), iter->second.end(), table);
+      else
       {
-	ROS_WARN("Bad calibration: raw_calib[1] = raw_calib[0]");
-	return 0.0f;
+        ROS_ERROR("%s is not calibrated", joint_names[channel].c_str());
+        std::fill(table, table + table_size, 1.0f);
+        ++nb_missing;
       }
+    }
 
-    y = y0 + (x-x0)* ((y1-y0)/(x1-x0));
-    return y;
+    return nb_missing;
   }
 
+  void XmlCalibrationParser::calibrate(const std::vector<float>& raw, std::vector<float>& calibrated) const
+  {
+    unsigned int nb_channels = channel_offsets.size();
+    calibrated.resize(nb_channels);
+    if( raw.size() < nb_channels )
+    {
+      ROS_ERROR("Received %u values to calibrate %u channels", (unsigned int)raw.size(), nb_channels);
+      return;
+    }
 
-  int XmlCalibrationParser::return_index_from_raw_position(float raw_position)
+    unsigned int channel = 0;
+
+#ifdef __AVX2__
+    //8 channels at a time: same clamping and interpolation as return_index_from_raw_position
+    // and interpolate, so that the results are exactly the same
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 precision = _mm256_set1_ps(lookup_precision);
+    const __m256i last_index = _mm256_set1_epi32((int)lookup_precision - 1);
+    const __m256i next = _mm256_set1_epi32(1);
+    for (; channel + 8 <= nb_channels; channel += 8)
+    {
+      //clamp to [0, 1] (a NaN is clamped to 0: max returns its second operand)
+      __m256 position = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(&raw[channel]), zero), one);
+      //the entry below (positive: truncating floors it), the last one ending at 1
+      __m256 scaled = _mm256_mul_ps(position, precision);
+      __m256i index = _mm256_min_epi32(_mm256_cvttps_epi32(scaled), last_index);
+      __m256 fraction = _mm256_sub_ps(scaled, _mm256_cvtepi32_ps(index));
+
+      index = _mm256_add_epi32(index, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&channel_offsets[channel])));
+      __m256 below = _mm256_i32gather_ps(&channel_tables[0], index, 4);
+      __m256 above = _mm256_i32gather_ps(&channel_tables[0], _mm256_add_epi32(index, next), 4);
+#ifdef __FMA__
+      __m256 value = _mm256_fmadd_ps(fraction, _mm256_sub_ps(above, below), below);
+#else
+      __m256 value = _mm256_add_ps(below, _mm256_mul_ps(fraction, _mm256_sub_ps(above, below)));
+#endif
+      _mm256_storeu_ps(&calibrated[channel], value);
+    }
+#endif
+
+    for (; channel < nb_channels; ++channel)
+    {
+      float fraction;
+      int index = return_index_from_raw_position(raw[channel], fraction);
+      calibrated[channel] = interpolate(&channel_tables[channel_offsets[channel] + index], fraction);
+    }
+  }
+
+  int XmlCalibrationParser::return_index_from_raw_position(float raw_position, float& fraction)
   {
-    if (raw_position < 0.0f)
-      return 0;
+    //(a NaN goes to the first index too)
+    if( !(raw_position >= 0.0f) )
+      raw_position = 0.0f;
     if(raw_position > 1.0f)
-      return lookup_precision;
-    return round(raw_position * lookup_precision);
+      raw_position = 1.0f;
+
+    //the entry below the position, the last one ending at 1
+    float scaled = raw_position * lookup_precision;
+    int index = std::min((int)scaled, (int)lookup_precision - 1);
+    fraction = scaled - (float)index;
+    return index;
   };
 
+  float XmlCalibrationParser::interpolate(const float* entry, float fraction)
+  {
+    //the same operations as the AVX2 path of calibrate() (fused if it is)
+#ifdef __FMA__
+    return fmaf(fraction, entry[1] - entry[0], entry[0]);
+#else
+    return entry[0] + fraction * (entry[1] - entry[0]);
+#endif
+  }
+
   int XmlCalibrationParser::round(float number)
   {
     //we only have positive numbers
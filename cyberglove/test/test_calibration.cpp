@@ -29,6 +29,8 @@
 #include <ros/ros.h>
 
 #include <math.h>
+#include <stdio.h>
+#include <unistd.h>
 #include <cyberglove/xml_calibration_parser.h>
 #include <gtest/gtest.h>
 
@@ -38,10 +40,12 @@ using namespace ros;
 using namespace xml_calibration_parser;
 
 std::string path_to_calibration = "test/cyberglove_test.cal";
+std::string path_to_spline_calibration = "test/cyberglove_spline_test.cal";
 
 float epsilon = 0.01f;
 
 XmlCalibrationParser calib_parser;
+XmlCalibrationParser spline_parser;
 
 TEST(LookupTable, testSimple)
 {
@@ -150,10 +154,191 @@ TEST(LookupTable, tableNotOrdered)
     << "Received value : "<< valtmp;
 }
 
+TEST(SplineLookupTable, collinearPointsGiveALine)
+{
+  //the points of "collinear" (unevenly spaced, not in order) are on
+  // 200 * raw - 40: so is the whole curve, extrapolation included
+  for (unsigned int i = 0; i <= 1000; ++i)
+  {
+    float position = (float)i / 1000.0f;
+    EXPECT_NEAR(200.0 * position - 40.0, spline_parser.get_calibration_value(position, "collinear"), epsilon)
+      << "at raw position " << position;
+  }
+}
+
+TEST(SplineLookupTable, interpolatesBetweenTheEntries)
+{
+  //the 12 bit raw values fall between the 1001 entries of the table: they're
+  // interpolated, not rounded to the closest entry (0.1 off on this slope)
+  for (unsigned int i = 0; i <= 4095; ++i)
+  {
+    float position = (float)i / 4095.0f;
+    EXPECT_NEAR(200.0 * position - 40.0, spline_parser.get_calibration_value(position, "collinear"), 0.001)
+      << "at raw position " << position;
+  }
+}
+
+TEST(SplineLookupTable, stepBetweenPlateaus)
+{
+  //"step" rises from a plateau at 0 to a plateau at 100: all the tangents are
+  // 0, so the plateaus and the extrapolation stay flat, and the rise between
+  // them is the cubic 100 * (3t^2 - 2t^3)
+  for (unsigned int i = 0; i <= 1000; ++i)
+  {
+    float position = (float)i / 1000.0f;
+    double expected;
+    if( position <= 0.4f )
+      expected = 0.0;
+    else if( position >= 0.6f )
+      expected = 100.0;
+    else
+    {
+      double t = (position - 0.4) / 0.2;
+      expected = 100.0 * (3.0 * t * t - 2.0 * t * t * t);
+    }
+    EXPECT_NEAR(expected, spline_parser.get_calibration_value(position, "step"), epsilon)
+      << "at raw position " << position;
+  }
+}
+
+TEST(SplineLookupTable, goesThroughThePoints)
+{
+  EXPECT_NEAR(0.0f, spline_parser.get_calibration_value(0.1f, "spline1"), epsilon);
+  EXPECT_NEAR(10.0f, spline_parser.get_calibration_value(0.3f, "spline1"), epsilon);
+  EXPECT_NEAR(60.0f, spline_parser.get_calibration_value(0.5f, "spline1"), epsilon);
+  EXPECT_NEAR(70.0f, spline_parser.get_calibration_value(0.7f, "spline1"), epsilon);
+  EXPECT_NEAR(120.0f, spline_parser.get_calibration_value(0.9f, "spline1"), epsilon);
+
+  EXPECT_NEAR(90.0f, spline_parser.get_calibration_value(0.2f, "spline2"), epsilon);
+  EXPECT_NEAR(80.0f, spline_parser.get_calibration_value(0.4f, "spline2"), epsilon);
+  EXPECT_NEAR(80.0f, spline_parser.get_calibration_value(0.6f, "spline2"), epsilon);
+  EXPECT_NEAR(0.0f, spline_parser.get_calibration_value(0.8f, "spline2"), epsilon);
+
+  //the order of the points in the file doesn't matter
+  for (unsigned int i = 0; i <= 1000; ++i)
+    EXPECT_EQ(spline_parser.get_calibration_value((float)i / 1000.0f, "spline1"),
+              spline_parser.get_calibration_value((float)i / 1000.0f, "spline3"));
+}
+
+TEST(SplineLookupTable, monotone)
+{
+  for (unsigned int i = 1; i <= 1000; ++i)
+  {
+    float previous = (float)(i - 1) / 1000.0f, current = (float)i / 1000.0f;
+
+    //increasing points: the curve never decreases
+    EXPECT_LE(spline_parser.get_calibration_value(previous, "spline1"),
+              spline_parser.get_calibration_value(current, "spline1"))
+      << "at raw position " << current;
+
+    //decreasing points with a plateau: the curve never increases, and doesn't
+    // overshoot on the plateau
+    EXPECT_GE(spline_parser.get_calibration_value(previous, "spline2"),
+              spline_parser.get_calibration_value(current, "spline2"))
+      << "at raw position " << current;
+  }
+
+  for (unsigned int i = 400; i <= 600; ++i)
+    EXPECT_NEAR(80.0f, spline_parser.get_calibration_value((float)i / 1000.0f, "spline2"), epsilon);
+}
+
+TEST(SplineLookupTable, linearExtrapolation)
+{
+  //below the first point and above the last one, the curve is a straight line
+  float below[] = {spline_parser.get_calibration_value(0.0f, "spline1"),
+                   spline_parser.get_calibration_value(0.05f, "spline1"),
+                   spline_parser.get_calibration_value(0.1f, "spline1")};
+  EXPECT_LT(below[0], 0.0f);
+  EXPECT_NEAR(below[1] - below[0], below[2] - below[1], epsilon);
+
+  float above[] = {spline_parser.get_calibration_value(0.9f, "spline1"),
+                   spline_parser.get_calibration_value(0.95f, "spline1"),
+                   spline_parser.get_calibration_value(1.0f, "spline1")};
+  EXPECT_GT(above[2], 120.0f);
+  EXPECT_NEAR(above[1] - above[0], above[2] - above[1], epsilon);
+
+  //the slope of the last segment (-400 / unit), the tangent at 0.6 being 0
+  EXPECT_NEAR(-80.0f, spline_parser.get_calibration_value(1.0f, "spline2"), epsilon);
+
+  //the end slopes of "collinear" are the slope of its line
+  EXPECT_NEAR(-40.0f, spline_parser.get_calibration_value(0.0f, "collinear"), epsilon);
+  EXPECT_NEAR(160.0f, spline_parser.get_calibration_value(1.0f, "collinear"), epsilon);
+
+  //the raw position is clamped to the table
+  EXPECT_NEAR(above[2], spline_parser.get_calibration_value(1.5f, "spline1"), epsilon);
+  EXPECT_NEAR(below[0], spline_parser.get_calibration_value(-0.5f, "spline1"), epsilon);
+}
+
+TEST(BatchCalibration, sameAsPerJoint)
+{
+  //more channels than a SIMD register, with a joint which isn't calibrated
+  const char* names[] = {"spline1", "spline2", "spline3", "spline1", "spline2", "spline3",
+                         "spline1", "spline2", "spline3", "not_calibrated", "spline1"};
+  std::vector<std::string> channels(names, names + 11);
+  XmlCalibrationParser parser(spline_parser.getJointsCalibrations());
+  EXPECT_EQ(1, parser.set_channels(channels));
+
+  std::vector<float> raw(channels.size()), calibrated;
+  for (unsigned int i = 0; i <= 1200; ++i)
+  {
+    //different positions on each channel, some of them out of [0, 1]
+    for (unsigned int channel = 0; channel < channels.size(); ++channel)
+      raw[channel] = (float)((i + 97 * channel) % 1201) / 1000.0f - 0.1f;
+
+    parser.calibrate(raw, calibrated);
+    ASSERT_EQ(channels.size(), calibrated.size());
+    for (unsigned int channel = 0; channel < channels.size(); ++channel)
+    {
+      if( channel == 9 )
+        EXPECT_EQ(1.0f, calibrated[channel]);
+      else
+        EXPECT_EQ(parser.get_calibration_value(raw[channel], channels[channel]), calibrated[channel])
+          << "channel " << channel << " at raw position " << raw[channel];
+    }
+  }
+}
+
+TEST(CalibrationCache, sameTablesAsBuilt)
+{
+  std::string path_to_cache = "/tmp/test_cyberglove_calibration.cache";
+  unlink(path_to_cache.c_str());
+
+  //the first parser builds the tables and writes the cache, the second one
+  // loads them from the cache
+  std::vector<XmlCalibrationParser::JointCalibration> calibrations = spline_parser.getJointsCalibrations();
+  XmlCalibrationParser built(calibrations, path_to_cache);
+  XmlCalibrationParser cached(calibrations, path_to_cache);
+
+  for (unsigned int i = 0; i <= 1000; ++i)
+  {
+    float position = (float)i / 1000.0f;
+    EXPECT_EQ(spline_parser.get_calibration_value(position, "spline1"), cached.get_calibration_value(position, "spline1"));
+    EXPECT_EQ(spline_parser.get_calibration_value(position, "spline2"), cached.get_calibration_value(position, "spline2"));
+  }
+
+  //a modified calibration doesn't use the stale cache
+  calibrations[0].calibrations[0].calibrated_value = 20.0f;
+  XmlCalibrationParser modified(calibrations, path_to_cache);
+  EXPECT_NEAR(20.0f, modified.get_calibration_value(0.1f, "spline1"), epsilon);
+
+  //a corrupted cache is ignored
+  FILE* file = fopen(path_to_cache.c_str(), "r+b");
+  ASSERT_TRUE(file != NULL);
+  fseek(file, -1, SEEK_END);
+  fputc(0x55, file);
+  fclose(file);
+  XmlCalibrationParser rebuilt(calibrations, path_to_cache);
+  EXPECT_NEAR(120.0f, rebuilt.get_calibration_value(0.9f, "spline1"), epsilon);
+  EXPECT_NEAR(20.0f, rebuilt.get_calibration_value(0.1f, "spline1"), epsilon);
+
+  unlink(path_to_cache.c_str());
+}
+
 // Run all the tests that were declared with TEST()
 int main(int argc, char **argv){
 
   calib_parser = XmlCalibrationParser(path_to_calibration);
+  spline_parser = XmlCalibrationParser(path_to_spline_calibration);
 
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
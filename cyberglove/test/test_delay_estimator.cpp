@@ -0,0 +1,54 @@
+/**
+ * @file   test_delay_estimator.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Checks the percentiles of the DelayEstimator, over its window of
+ * the latest delays.
+ *
+ */
+
+#include <cyberglove/delay_estimator.h>
+#include <gtest/gtest.h>
+
+TEST(DelayEstimator, percentilesOfTheWindow)
+{
+  cyberglove::DelayEstimator estimator(100);
+  double delay = -1.0;
+  EXPECT_FALSE(estimator.percentile(0.5, delay));
+  EXPECT_EQ(-1.0, delay);
+
+  //the old delays are replaced by the new ones: only 100 to 199 are left
+  for (unsigned int i = 0; i < 200; ++i)
+    estimator.add(i * 0.001);
+  EXPECT_EQ(200u, estimator.get_nb_delays());
+
+  ASSERT_TRUE(estimator.percentile(0.0, delay));
+  EXPECT_NEAR(0.100, delay, 1e-9);
+  ASSERT_TRUE(estimator.percentile(0.99, delay));
+  EXPECT_NEAR(0.198, delay, 1e-9);
+  ASSERT_TRUE(estimator.percentile(1.0, delay));
+  EXPECT_NEAR(0.199, delay, 1e-9);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
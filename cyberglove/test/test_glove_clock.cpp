@@ -0,0 +1,127 @@
+/**
+ * @file   test_glove_clock.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Checks the GloveClock on simulated arrival times: the jitter is
+ * removed, the lost samples are counted once confirmed, and the late
+ * frames don't move the stamps.
+ *
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <cyberglove/glove_clock.h>
+#include <gtest/gtest.h>
+
+TEST(GloveClock, removesTheArrivalJitter)
+{
+  //the glove's period is a bit off the nominal 10ms, the frames arrive 2 to 6ms after being sampled
+  cyberglove::GloveClock clock(0.01);
+  double period = 0.01002, max_error = 0.0;
+  unsigned int seq = 0;
+  for (unsigned int i = 0; i < 2000; ++i)
+  {
+    //a sample lost before being parsed, and a frame rejected by the parser (numbered)
+    if( i == 1000 )
+      continue;
+    ++seq;
+    if( i == 1500 )
+      continue;
+
+    double sampled = 100.0 + i * period;
+    double latency = 0.002 + 0.004 * ((i * 7919) % 101) / 100.0;
+    double stamp = clock.update(sampled + latency, seq);
+    //the lost sample is only counted once 3 frames confirmed it: the 2
+    // frames before are a period off
+    if( i > 200 && (i < 1000 || i > 1002) )
+      max_error = std::max(max_error, fabs(stamp - (sampled + 0.004)));
+  }
+
+  EXPECT_NEAR(period, clock.get_period(), 1e-6);
+  EXPECT_LT(max_error, 0.0005);
+  EXPECT_GT(clock.get_jitter(), 0.0005);
+  EXPECT_EQ(1u, clock.get_nb_missed());
+}
+
+TEST(GloveClock, restartsAfterAPause)
+{
+  cyberglove::GloveClock clock(0.01);
+  for (unsigned int i = 0; i < 100; ++i)
+    clock.update(i * 0.01, i + 1);
+
+  //the glove was stopped for 2s: the model restarts from the arrival times
+  EXPECT_DOUBLE_EQ(3.0, clock.update(3.0, 101));
+  EXPECT_EQ(0u, clock.get_nb_missed());
+}
+
+/// the arrival latency of a frame: 2ms +- 0.3ms
+double glove_latency(unsigned int i)
+{
+  return 0.002 + 0.0006 * (((i * 7919) % 101) / 100.0 - 0.5);
+}
+
+TEST(GloveClock, ignoresASingleLateFrame)
+{
+  cyberglove::GloveClock clock(0.01);
+  double max_error = 0.0;
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    double sampled = 100.0 + i * 0.01;
+    //the serial thread stalled for 7ms: that frame is late, the next ones aren't
+    double latency = glove_latency(i) + (i == 500 ? 0.007 : 0.0);
+    double stamp = clock.update(sampled + latency, i + 1);
+    if( i > 200 )
+      max_error = std::max(max_error, fabs(stamp - (sampled + 0.002)));
+  }
+
+  //including the late frame itself, and all the ones after it
+  EXPECT_LT(max_error, 0.0005);
+  EXPECT_EQ(0u, clock.get_nb_missed());
+  EXPECT_NEAR(0.01, clock.get_period(), 1e-6);
+}
+
+TEST(GloveClock, undoesAnOffsetWhenTheFramesComeBack)
+{
+  cyberglove::GloveClock clock(0.01);
+  double max_error = 0.0;
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    double sampled = 100.0 + i * 0.01;
+    //a stall long enough to confirm an offset: 4 frames a period late
+    double latency = glove_latency(i) + (i >= 500 && i < 504 ? 0.01 : 0.0);
+    double stamp = clock.update(sampled + latency, i + 1);
+    if( i == 503 )
+    {
+      EXPECT_EQ(1u, clock.get_nb_missed());
+    }
+    if( i > 520 )
+      max_error = std::max(max_error, fabs(stamp - (sampled + 0.002)));
+  }
+
+  //the frames arriving on time again undid the offset
+  EXPECT_LT(max_error, 0.0005);
+  EXPECT_EQ(0u, clock.get_nb_missed());
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
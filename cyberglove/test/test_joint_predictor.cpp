@@ -0,0 +1,116 @@
+/**
+ * @file   test_joint_predictor.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Checks the predictions of the JointPredictor: exact on the motions
+ * its model assumes, and the kalman filter converging on a ramp.
+ *
+ */
+
+#include <math.h>
+#include <vector>
+#include <cyberglove/joint_predictor.h>
+#include <gtest/gtest.h>
+
+TEST(JointPredictor, constantVelocity)
+{
+  //without smoothing, a ramp is extrapolated exactly
+  cyberglove::JointPredictor predictor(2, cyberglove::predictor_types::CONSTANT_VELOCITY, 0.0);
+  std::vector<double> positions(2), predicted;
+
+  predictor.predict(0.04, predicted);
+  EXPECT_TRUE(predicted.empty());
+
+  for (unsigned int i = 0; i < 10; ++i)
+  {
+    positions[0] = 0.5 * i * 0.01;
+    positions[1] = 1.0 - 2.0 * i * 0.01;
+    predictor.update(i * 0.01, positions);
+  }
+
+  predictor.predict(0.04, predicted);
+  ASSERT_EQ(2u, predicted.size());
+  EXPECT_NEAR(0.5 * 0.13, predicted[0], 1e-9);
+  EXPECT_NEAR(1.0 - 2.0 * 0.13, predicted[1], 1e-9);
+
+  //after a reset, the last frame is held until the velocity is known again
+  predictor.reset();
+  predictor.update(1.0, positions);
+  predictor.predict(0.04, predicted);
+  EXPECT_NEAR(positions[0], predicted[0], 1e-9);
+}
+
+TEST(JointPredictor, constantAcceleration)
+{
+  cyberglove::JointPredictor predictor(1, cyberglove::predictor_types::CONSTANT_ACCELERATION, 0.0);
+  std::vector<double> positions(1), predicted;
+
+  //the acceleration is estimated from the last three frames, i.e. with a lag
+  // of one frame on the velocity: the prediction error is bounded by a*dt*h
+  const double acceleration = 3.0, dt = 0.01, horizon = 0.04;
+  for (unsigned int i = 0; i < 10; ++i)
+  {
+    positions[0] = 0.5 * acceleration * (i * dt) * (i * dt);
+    predictor.update(i * dt, positions);
+  }
+
+  predictor.predict(horizon, predicted);
+  double t = 9 * dt + horizon;
+  EXPECT_NEAR(0.5 * acceleration * t * t, predicted[0], acceleration * dt * horizon);
+
+  //the constant velocity predictor trails further behind
+  cyberglove::JointPredictor velocity_predictor(1, cyberglove::predictor_types::CONSTANT_VELOCITY, 0.0);
+  for (unsigned int i = 0; i < 10; ++i)
+  {
+    positions[0] = 0.5 * acceleration * (i * dt) * (i * dt);
+    velocity_predictor.update(i * dt, positions);
+  }
+  std::vector<double> velocity_predicted;
+  velocity_predictor.predict(horizon, velocity_predicted);
+  EXPECT_LT(fabs(0.5 * acceleration * t * t - predicted[0]), fabs(0.5 * acceleration * t * t - velocity_predicted[0]));
+}
+
+TEST(JointPredictor, kalmanConvergesOnARamp)
+{
+  cyberglove::JointPredictor predictor(1, cyberglove::predictor_types::KALMAN);
+  std::vector<double> positions(1), predicted;
+
+  for (unsigned int i = 0; i < 200; ++i)
+  {
+    positions[0] = 0.2 + 1.5 * i * 0.01;
+    predictor.update(i * 0.01, positions);
+  }
+
+  predictor.predict(0.04, predicted);
+  EXPECT_NEAR(0.2 + 1.5 * 2.03, predicted[0], 1e-3);
+
+  //no prediction: the last frame
+  cyberglove::JointPredictor none(1, cyberglove::predictor_types::NONE);
+  none.update(0.0, positions);
+  none.update(0.01, positions);
+  none.predict(0.04, predicted);
+  EXPECT_EQ(positions[0], predicted[0]);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,81 @@
+/**
+ * @file   test_sensor_repair.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Checks the SensorRepair: the invalid sensors are repaired from the
+ * median of their history, the frames with too many are rejected.
+ *
+ */
+
+#include <vector>
+#include <cyberglove/sensor_repair.h>
+#include <gtest/gtest.h>
+
+TEST(SensorRepair, repairsFromTheMedian)
+{
+  cyberglove::SensorRepair repair(2, 3, 1);
+  std::vector<bool> valid(2, true);
+  std::vector<float> positions(2, 0.0f);
+
+  //no history yet: the glitch can't be repaired
+  valid[1] = false;
+  EXPECT_FALSE(repair.repair(positions, valid));
+
+  valid[1] = true;
+  float values[] = {0.2f, 0.9f, 0.3f};
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    positions[0] = 0.5f;
+    positions[1] = values[i];
+    EXPECT_TRUE(repair.repair(positions, valid));
+  }
+
+  //the spike of the history is ignored
+  valid[1] = false;
+  positions[1] = 0.0f;
+  EXPECT_TRUE(repair.repair(positions, valid));
+  EXPECT_FLOAT_EQ(0.5f, positions[0]);
+  EXPECT_FLOAT_EQ(0.3f, positions[1]);
+  EXPECT_EQ(0u, repair.get_nb_repaired(0));
+  EXPECT_EQ(1u, repair.get_nb_repaired(1));
+  EXPECT_DOUBLE_EQ(0.25, repair.get_repair_rate(1));
+
+  //more invalid sensors than max_invalid: the frame is rejected
+  valid[0] = false;
+  EXPECT_FALSE(repair.repair(positions, valid));
+  EXPECT_EQ(1u, repair.get_nb_repaired(1));
+}
+
+TEST(SensorRepair, rejectsWithoutHistory)
+{
+  cyberglove::SensorRepair repair(2, 0, 2);
+  std::vector<bool> valid(2, true);
+  std::vector<float> positions(2, 0.5f);
+
+  EXPECT_TRUE(repair.repair(positions, valid));
+  valid[0] = false;
+  EXPECT_FALSE(repair.repair(positions, valid));
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
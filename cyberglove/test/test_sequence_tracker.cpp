@@ -0,0 +1,51 @@
+/**
+ * @file   test_sequence_tracker.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Checks the missing frames counted by the SequenceTracker.
+ *
+ */
+
+#include <cyberglove/sequence_tracker.h>
+#include <gtest/gtest.h>
+
+TEST(SequenceTracker, countsTheMissingFrames)
+{
+  cyberglove::SequenceTracker tracker;
+  //the frames before the first one aren't missing
+  EXPECT_EQ(0u, tracker.add(5));
+  EXPECT_EQ(0u, tracker.add(6));
+  EXPECT_EQ(2u, tracker.add(9));
+  EXPECT_EQ(0u, tracker.add(10));
+
+  //a restarted numbering isn't a gap
+  EXPECT_EQ(0u, tracker.add(1));
+  EXPECT_EQ(1u, tracker.add(3));
+
+  EXPECT_EQ(6u, tracker.get_nb_frames());
+  EXPECT_EQ(3u, tracker.get_nb_missing());
+  EXPECT_EQ(3u, tracker.get_last_seq());
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
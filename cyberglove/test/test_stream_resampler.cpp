@@ -0,0 +1,81 @@
+/**
+ * @file   test_stream_resampler.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Checks the StreamResampler: interpolated between the frames, and
+ * held outside of them.
+ *
+ */
+
+#include <vector>
+#include <cyberglove/stream_resampler.h>
+#include <gtest/gtest.h>
+
+TEST(StreamResampler, interpolatesBetweenFrames)
+{
+  cyberglove::StreamResampler resampler(4);
+  std::vector<double> positions(2), resampled;
+  double error;
+  EXPECT_FALSE(resampler.sample(0.0, resampled, error));
+
+  //a ramp sampled every 10ms, from an unrelated clock
+  for (unsigned int i = 0; i < 6; ++i)
+  {
+    positions[0] = i * 1.0;
+    positions[1] = -(i * 2.0);
+    EXPECT_TRUE(resampler.add(0.003 + i * 0.01, positions));
+  }
+  //an older frame is ignored
+  EXPECT_FALSE(resampler.add(0.03, positions));
+
+  ASSERT_TRUE(resampler.sample(0.04, resampled, error));
+  ASSERT_EQ(2u, resampled.size());
+  EXPECT_NEAR(3.7, resampled[0], 1e-9);
+  EXPECT_NEAR(-7.4, resampled[1], 1e-9);
+  EXPECT_NEAR(0.003, error, 1e-9);
+}
+
+TEST(StreamResampler, holdsOutsideOfTheFrames)
+{
+  cyberglove::StreamResampler resampler(4);
+  std::vector<double> positions(1), resampled;
+  double error;
+  for (unsigned int i = 0; i < 6; ++i)
+  {
+    positions[0] = i * 1.0;
+    resampler.add(i * 0.01, positions);
+  }
+
+  //the stream is late: the newest frame is held
+  ASSERT_TRUE(resampler.sample(0.08, resampled, error));
+  EXPECT_EQ(5.0, resampled[0]);
+  EXPECT_NEAR(0.03, error, 1e-9);
+
+  //only the last 4 frames are kept
+  ASSERT_TRUE(resampler.sample(0.0, resampled, error));
+  EXPECT_EQ(2.0, resampled[0]);
+  EXPECT_NEAR(0.02, error, 1e-9);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,123 @@
+/**
+ * @file   cyberglove_controller.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief A ros_control controller driving the hand joints from the glove.
+ *
+ * The glove frames (raw or calibrated joint_states of the cyberglove node)
+ * are passed to the controller's loop through a realtime buffer. Each new
+ * frame goes through the calibration / mapping pipeline in the update, and
+ * the hand positions are upsampled to the controller's rate with a cubic
+ * interpolation (see FrameInterpolator), then written to the position
+ * joint interface: no trajectory or action server is involved.
+ *
+ */
+
+#ifndef   	CYBERGLOVE_CONTROLLER_H_
+# define   	CYBERGLOVE_CONTROLLER_H_
+
+#include <ros/ros.h>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include <controller_interface/controller.h>
+#include <hardware_interface/joint_command_interface.h>
+#include <realtime_tools/realtime_buffer.h>
+#include <cyberglove/GloveFrame.h>
+
+#include <cyberglove/sequence_tracker.h>
+#include <sr_remappers/glove_to_hand_pipeline.h>
+#include "cyberglove_controller/frame_interpolator.h"
+
+namespace cyberglove_controller
+{
+  class CybergloveController : public controller_interface::Controller<hardware_interface::PositionJointInterface>
+  {
+  public:
+    CybergloveController();
+
+    /**
+     * Reads the parameters (in the controller's namespace):
+     *  - cyberglove_mapping_path: the mapping matrix
+     *  - calibrated_input: true if the glove frames are already calibrated
+     *    (false by default)
+     *  - cyberglove_calibration: the calibration of the raw frames
+     *  - glove_topic: the glove frames, with their frame number
+     *    (cyberglove/raw/frames, or cyberglove/calibrated/frames)
+     *  - joint_prefix: prepended to the hand joint names
+     *  - max_frame_period: the longest an interpolation segment lasts (0.1s)
+     */
+    bool init(hardware_interface::PositionJointInterface* hw, ros::NodeHandle& n);
+
+    /// Holds the current positions until the first frame.
+    void starting(const ros::Time& time);
+
+    /// Logs where the glove frames were lost.
+    void stopping(const ros::Time& time);
+
+    void update(const ros::Time& time, const ros::Duration& period);
+
+  private:
+    /// A glove frame, passed from the subscriber to the controller's loop.
+    struct GloveFrame
+    {
+      std::vector<float> raw;
+      std::vector<double> calibrated;
+      ///incremented for each frame: tells the loop a new frame arrived
+      unsigned int seq;
+
+      GloveFrame() : seq(0) {};
+    };
+
+    void glove_callback(const cyberglove::GloveFrameConstPtr& msg);
+
+    std::vector<hardware_interface::JointHandle> joints_;
+
+    boost::scoped_ptr<sr_remappers::GloveToHandPipeline> pipeline_;
+    bool calibrated_input_;
+
+    ros::Subscriber glove_sub_;
+    ///written by the subscriber, read by the controller's loop
+    realtime_tools::RealtimeBuffer<GloveFrame> frame_buffer_;
+    ///the subscriber's frame, copied to the buffer
+    GloveFrame next_frame_;
+    ///the seq of the last frame processed by the loop
+    unsigned int last_seq_;
+
+    boost::scoped_ptr<FrameInterpolator> interpolator_;
+    ///the positions of the joints when the controller started
+    std::vector<double> start_positions_;
+
+    ///the frames the pipeline couldn't process, or with a NaN
+    unsigned int nb_failed_frames_;
+    ///the frames replaced in the buffer before the loop read them
+    unsigned int nb_overwritten_frames_;
+    ///the header.seq of the messages received: the gaps are the messages lost on the topic
+    cyberglove::SequenceTracker received_messages_;
+    ///the frame numbers received: the gaps are the frames lost anywhere before the controller
+    cyberglove::SequenceTracker received_frames_;
+  };
+}
+
+#endif 	    /* !CYBERGLOVE_CONTROLLER_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,104 @@
+/**
+ * @file   frame_interpolator.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Upsamples the glove frames to the controller's rate.
+ *
+ * Each new frame starts a cubic (hermite) segment from the current position
+ * and velocity to the frame, reached one frame period later with the
+ * velocity of the last two frames: the positions and velocities are
+ * continuous, at the cost of one frame period of delay. If no new frame
+ * arrives, the last one is held. The first frame after a reset, when the
+ * frame period isn't known yet, is reached from the reset positions within
+ * max_frame_period.
+ *
+ * Nothing is allocated after the construction: it can be used from a
+ * realtime loop.
+ *
+ */
+
+#ifndef   	FRAME_INTERPOLATOR_H_
+# define   	FRAME_INTERPOLATOR_H_
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace cyberglove_controller
+{
+  class FrameInterpolator : boost::noncopyable
+  {
+  public:
+    /**
+     * @param size the number of joints
+     * @param max_frame_period the longest a segment can last (s): after a
+     *        gap in the frames (or a reset), the next one is reached within
+     *        this time.
+     */
+    FrameInterpolator(unsigned int size, double max_frame_period = 0.1);
+
+    /**
+     * Holds these positions, forgetting the previous frames.
+     */
+    void reset(double time, const std::vector<double>& positions);
+
+    /**
+     * Starts a segment to a new frame, from where the interpolation is at
+     * this time.
+     *
+     * @param time when the frame was received (s)
+     * @param positions the positions of the frame, must contain size values
+     */
+    void add_frame(double time, const std::vector<double>& positions);
+
+    /**
+     * Computes the positions and velocities at this time (clamped to the
+     * current segment).
+     */
+    void sample(double time);
+
+    const std::vector<double>& get_positions() const { return positions_; };
+    const std::vector<double>& get_velocities() const { return velocities_; };
+
+    /// the estimated time between two frames (s), 0 until two frames were received
+    double get_frame_period() const { return frame_period_; };
+
+  private:
+    double max_frame_period_;
+
+    ///the current segment: from (start, start_velocities) to (end, end_velocities)
+    std::vector<double> start_, start_velocities_, end_, end_velocities_;
+    double segment_start_, segment_duration_;
+
+    ///the last frame, and when it was received
+    std::vector<double> last_frame_;
+    double last_frame_time_;
+    unsigned int nb_frames_;
+    double frame_period_;
+
+    std::vector<double> positions_, velocities_;
+  };
+}
+
+#endif 	    /* !FRAME_INTERPOLATOR_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
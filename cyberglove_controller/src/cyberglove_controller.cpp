@@ -0,0 +1,176 @@
+/**
+ * @file   cyberglove_controller.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief A ros_control controller driving the hand joints from the glove.
+ *
+ */
+
+#include "cyberglove_controller/cyberglove_controller.h"
+
+#include <math.h>
+#include <pluginlib/class_list_macros.h>
+#include <cyberglove/glove_joints.h>
+
+namespace cyberglove_controller
+{
+  CybergloveController::CybergloveController()
+    : calibrated_input_(false), last_seq_(0), nb_failed_frames_(0), nb_overwritten_frames_(0)
+  {
+  }
+
+  bool CybergloveController::init(hardware_interface::PositionJointInterface* hw, ros::NodeHandle& n)
+  {
+    std::string path_to_mapping;
+    if( !n.getParam("cyberglove_mapping_path", path_to_mapping) )
+    {
+      ROS_ERROR("No cyberglove_mapping_path given (namespace: %s).", n.getNamespace().c_str());
+      return false;
+    }
+
+    //the pipeline reads the files and allocates its buffers now, not in the loop
+    n.param("calibrated_input", calibrated_input_, false);
+    if( calibrated_input_ )
+      pipeline_.reset(new sr_remappers::GloveToHandPipeline(path_to_mapping));
+    else
+    {
+      std::vector<xml_calibration_parser::XmlCalibrationParser::JointCalibration> calibration;
+      if( !sr_remappers::GloveToHandPipeline::read_calibration(n, "cyberglove_calibration", calibration) )
+        return false;
+
+      std::string calibration_cache;
+      n.param("calibration_cache", calibration_cache, std::string());
+      pipeline_.reset(new sr_remappers::GloveToHandPipeline(calibration, path_to_mapping, calibration_cache));
+    }
+    if( !pipeline_->is_valid() )
+    {
+      ROS_ERROR("Couldn't load the mapping %s (cyberglove_mapping_path).", path_to_mapping.c_str());
+      return false;
+    }
+
+    std::string joint_prefix;
+    n.param("joint_prefix", joint_prefix, std::string());
+    for (unsigned int i = 0; i < cyberglove::hand_joints::NB_JOINTS; ++i)
+    {
+      try
+      {
+        joints_.push_back(hw->getHandle(joint_prefix + cyberglove::hand_joints::names[i]));
+      }
+      catch (const hardware_interface::HardwareInterfaceException& e)
+      {
+        ROS_ERROR("Couldn't get the joint %s%s: %s", joint_prefix.c_str(), cyberglove::hand_joints::names[i], e.what());
+        return false;
+      }
+    }
+
+    double max_frame_period;
+    n.param("max_frame_period", max_frame_period, 0.1);
+    interpolator_.reset(new FrameInterpolator(cyberglove::hand_joints::NB_JOINTS, max_frame_period));
+    start_positions_.resize(cyberglove::hand_joints::NB_JOINTS);
+
+    //the frames of the buffer are allocated once: swapping them doesn't allocate
+    next_frame_.raw.resize(cyberglove::glove_sensors::NB_SENSORS);
+    next_frame_.calibrated.resize(cyberglove::glove_sensors::NB_SENSORS);
+    frame_buffer_.initRT(next_frame_);
+
+    std::string topic;
+    n.param("glove_topic", topic, std::string(calibrated_input_ ? "cyberglove/calibrated/frames" : "cyberglove/raw/frames"));
+    ros::NodeHandle node;
+    glove_sub_ = node.subscribe(topic, 1, &CybergloveController::glove_callback, this,
+                                ros::TransportHints().tcpNoDelay());
+    ROS_INFO("Driving the hand from the %s glove frames on %s", calibrated_input_ ? "calibrated" : "raw", glove_sub_.getTopic().c_str());
+
+    return true;
+  }
+
+  void CybergloveController::starting(const ros::Time& time)
+  {
+    for (unsigned int i = 0; i < joints_.size(); ++i)
+      start_positions_[i] = joints_[i].getPosition();
+    interpolator_->reset(time.toSec(), start_positions_);
+
+    //the frames received before the start are ignored
+    last_seq_ = frame_buffer_.readFromRT()->seq;
+  }
+
+  void CybergloveController::update(const ros::Time& time, const ros::Duration& period)
+  {
+    const GloveFrame* frame = frame_buffer_.readFromRT();
+    if( frame->seq != last_seq_ )
+    {
+      nb_overwritten_frames_ += frame->seq - last_seq_ - 1;
+      last_seq_ = frame->seq;
+
+      //calibrate, map and split the J0s, in the pipeline's buffers
+      bool processed = calibrated_input_ ? pipeline_->process_calibrated(frame->calibrated) : pipeline_->process(frame->raw);
+      const std::vector<double>& hand_positions = pipeline_->get_hand_positions();
+      for (unsigned int i = 0; processed && i < hand_positions.size(); ++i)
+      {
+        if( isnan(hand_positions[i]) )
+          processed = false;
+      }
+
+      if( processed )
+        interpolator_->add_frame(time.toSec(), hand_positions);
+      else
+        ++nb_failed_frames_;
+    }
+
+    interpolator_->sample(time.toSec());
+    const std::vector<double>& positions = interpolator_->get_positions();
+    for (unsigned int i = 0; i < joints_.size(); ++i)
+      joints_[i].setCommand(positions[i]);
+  }
+
+  void CybergloveController::stopping(const ros::Time& time)
+  {
+    ROS_INFO("Glove frames received: %lu, missing before the controller: %lu (lost on the topic: %lu), overwritten before the loop: %u, failed: %u",
+             received_frames_.get_nb_frames(), received_frames_.get_nb_missing(), received_messages_.get_nb_missing(),
+             nb_overwritten_frames_, nb_failed_frames_);
+  }
+
+  void CybergloveController::glove_callback(const cyberglove::GloveFrameConstPtr& msg)
+  {
+    received_messages_.add(msg->header.seq);
+    received_frames_.add(msg->frame_number);
+
+    if( msg->position.size() != cyberglove::glove_sensors::NB_SENSORS )
+    {
+      ROS_WARN_THROTTLE(1.0, "Received %u glove values, expected %d: ignoring them.",
+                        (unsigned int)msg->position.size(), cyberglove::glove_sensors::NB_SENSORS);
+      return;
+    }
+
+    for (unsigned int i = 0; i < msg->position.size(); ++i)
+    {
+      next_frame_.raw[i] = static_cast<float>(msg->position[i]);
+      next_frame_.calibrated[i] = msg->position[i];
+    }
+    ++next_frame_.seq;
+    frame_buffer_.writeFromNonRT(next_frame_);
+  }
+}
+
+PLUGINLIB_EXPORT_CLASS(cyberglove_controller::CybergloveController, controller_interface::ControllerBase)
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
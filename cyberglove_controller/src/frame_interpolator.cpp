@@ -0,0 +1,115 @@
+/**
+ * @file   frame_interpolator.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Upsamples the glove frames to the controller's rate.
+ *
+ */
+
+#include "cyberglove_controller/frame_interpolator.h"
+#include <algorithm>
+
+namespace cyberglove_controller
+{
+  FrameInterpolator::FrameInterpolator(unsigned int size, double max_frame_period)
+    : max_frame_period_(max_frame_period),
+      start_(size, 0.0), start_velocities_(size, 0.0), end_(size, 0.0), end_velocities_(size, 0.0),
+      segment_start_(0.0), segment_duration_(0.0),
+      last_frame_(size, 0.0), last_frame_time_(0.0), nb_frames_(0), frame_period_(0.0),
+      positions_(size, 0.0), velocities_(size, 0.0)
+  {
+  }
+
+  void FrameInterpolator::reset(double time, const std::vector<double>& positions)
+  {
+    std::copy(positions.begin(), positions.begin() + positions_.size(), positions_.begin());
+    std::copy(positions.begin(), positions.begin() + positions_.size(), end_.begin());
+    std::fill(velocities_.begin(), velocities_.end(), 0.0);
+    std::fill(end_velocities_.begin(), end_velocities_.end(), 0.0);
+
+    segment_start_ = time;
+    segment_duration_ = 0.0;
+    nb_frames_ = 0;
+    frame_period_ = 0.0;
+  }
+
+  void FrameInterpolator::add_frame(double time, const std::vector<double>& positions)
+  {
+    //the segment starts from where we are. If the frame is a bit late (the
+    // previous segment just ended), it continues at the previous frame's velocity
+    sample(time);
+    double elapsed = time - segment_start_;
+    bool just_ended = segment_duration_ > 0.0 && elapsed >= segment_duration_ && elapsed < 2.0 * segment_duration_;
+
+    double period = time - last_frame_time_;
+    if( nb_frames_ > 0 && period > 0.0 )
+    {
+      //smoothed over a few frames, the frames being received with some jitter
+      period = std::min(period, max_frame_period_);
+      frame_period_ = frame_period_ > 0.0 ? 0.8 * frame_period_ + 0.2 * period : period;
+    }
+
+    for (unsigned int i = 0; i < positions_.size(); ++i)
+    {
+      start_[i] = positions_[i];
+      start_velocities_[i] = just_ended ? end_velocities_[i] : velocities_[i];
+      end_[i] = positions[i];
+      //the velocity of the last two frames (none after a gap)
+      end_velocities_[i] = nb_frames_ > 0 && period > 0.0 && period < max_frame_period_ ? (positions[i] - last_frame_[i]) / period : 0.0;
+      last_frame_[i] = positions[i];
+    }
+
+    //the first frame (no period yet) is reached from the held positions
+    // within max_frame_period, rather than in a single step
+    segment_start_ = time;
+    segment_duration_ = frame_period_ > 0.0 ? frame_period_ : max_frame_period_;
+    last_frame_time_ = time;
+    ++nb_frames_;
+  }
+
+  void FrameInterpolator::sample(double time)
+  {
+    //the end of the segment is reached: hold it
+    double elapsed = time - segment_start_;
+    if( segment_duration_ <= 0.0 || elapsed >= segment_duration_ )
+    {
+      std::copy(end_.begin(), end_.end(), positions_.begin());
+      std::fill(velocities_.begin(), velocities_.end(), 0.0);
+      return;
+    }
+
+    double s = std::max(elapsed, 0.0) / segment_duration_;
+    double s2 = s * s, s3 = s2 * s;
+    double h00 = 2.0 * s3 - 3.0 * s2 + 1.0, h10 = s3 - 2.0 * s2 + s, h01 = -2.0 * s3 + 3.0 * s2, h11 = s3 - s2;
+    double d00 = 6.0 * s2 - 6.0 * s, d10 = 3.0 * s2 - 4.0 * s + 1.0, d01 = -6.0 * s2 + 6.0 * s, d11 = 3.0 * s2 - 2.0 * s;
+
+    for (unsigned int i = 0; i < positions_.size(); ++i)
+    {
+      double v0 = start_velocities_[i] * segment_duration_, v1 = end_velocities_[i] * segment_duration_;
+      positions_[i] = h00 * start_[i] + h10 * v0 + h01 * end_[i] + h11 * v1;
+      velocities_[i] = (d00 * start_[i] + d10 * v0 + d01 * end_[i] + d11 * v1) / segment_duration_;
+    }
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,178 @@
+/**
+ * @file   test_frame_interpolator.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Tests the upsampling of the glove frames.
+ *
+ */
+
+#include <math.h>
+#include <vector>
+#include <gtest/gtest.h>
+#include "cyberglove_controller/frame_interpolator.h"
+
+using cyberglove_controller::FrameInterpolator;
+
+namespace
+{
+  //the frames at 100Hz, the controller at 1kHz
+  const double frame_period = 0.01;
+  const unsigned int nb_ticks_per_frame = 10;
+  const double tick = frame_period / nb_ticks_per_frame;
+}
+
+TEST(FrameInterpolator, followsARampOneFrameLate)
+{
+  FrameInterpolator interpolator(2);
+  std::vector<double> frame(2, 0.0);
+  interpolator.reset(0.0, frame);
+
+  for (unsigned int i = 0; i < 50 * nb_ticks_per_frame; ++i)
+  {
+    double time = i * tick;
+    if( i % nb_ticks_per_frame == 0 )
+    {
+      frame[0] = 2.0 * time;
+      frame[1] = 1.0 - 0.5 * time;
+      interpolator.add_frame(time, frame);
+    }
+    interpolator.sample(time);
+
+    //once the frame period and the velocity are known, the ramp is exact
+    if( time > 5 * frame_period )
+    {
+      EXPECT_NEAR(2.0 * (time - frame_period), interpolator.get_positions()[0], 1e-9) << "at " << time;
+      EXPECT_NEAR(1.0 - 0.5 * (time - frame_period), interpolator.get_positions()[1], 1e-9) << "at " << time;
+      EXPECT_NEAR(2.0, interpolator.get_velocities()[0], 1e-6) << "at " << time;
+    }
+  }
+
+  EXPECT_NEAR(frame_period, interpolator.get_frame_period(), 1e-9);
+}
+
+TEST(FrameInterpolator, smoothOnASine)
+{
+  FrameInterpolator interpolator(1);
+  std::vector<double> frame(1, 0.0);
+  interpolator.reset(0.0, frame);
+
+  //the steps between two ticks are the size of a tick's worth of motion, not of a frame's
+  double previous = 0.0, max_step = 0.0;
+  for (unsigned int i = 0; i < 100 * nb_ticks_per_frame; ++i)
+  {
+    double time = i * tick;
+    if( i % nb_ticks_per_frame == 0 )
+    {
+      frame[0] = sin(2.0 * M_PI * time);
+      interpolator.add_frame(time, frame);
+    }
+    interpolator.sample(time);
+
+    if( time > 2 * frame_period )
+      max_step = std::max(max_step, fabs(interpolator.get_positions()[0] - previous));
+    previous = interpolator.get_positions()[0];
+  }
+
+  //the maximum velocity is 2*pi rad/s
+  EXPECT_LT(max_step, 1.2 * 2.0 * M_PI * tick);
+}
+
+TEST(FrameInterpolator, holdsTheLastFrame)
+{
+  FrameInterpolator interpolator(1);
+  std::vector<double> frame(1, 0.0);
+  interpolator.reset(0.0, frame);
+
+  for (unsigned int i = 0; i < 10; ++i)
+  {
+    frame[0] = 0.1 * i;
+    interpolator.add_frame(i * frame_period, frame);
+  }
+
+  //no frame for a while: the last one is reached, and held
+  interpolator.sample(1.0);
+  EXPECT_NEAR(0.9, interpolator.get_positions()[0], 1e-9);
+  EXPECT_EQ(0.0, interpolator.get_velocities()[0]);
+
+  //after the gap, the next frame is reached within a frame period, from rest
+  frame[0] = 1.0;
+  interpolator.add_frame(2.0, frame);
+  interpolator.sample(2.0);
+  EXPECT_NEAR(0.9, interpolator.get_positions()[0], 1e-9);
+  interpolator.sample(2.0 + 0.1);
+  EXPECT_NEAR(1.0, interpolator.get_positions()[0], 1e-9);
+}
+
+TEST(FrameInterpolator, rampsToTheFirstFrame)
+{
+  FrameInterpolator interpolator(1, 0.1);
+  std::vector<double> frame(1, 0.0);
+  interpolator.reset(0.0, frame);
+
+  //the glove is far from where the hand was when the controller started
+  frame[0] = 1.2;
+  interpolator.add_frame(0.0, frame);
+
+  //no step: each tick moves the hand by a fraction of the distance
+  double previous = 0.0, max_step = 0.0;
+  for (unsigned int i = 0; i <= 100; ++i)
+  {
+    interpolator.sample(i * tick);
+    max_step = std::max(max_step, fabs(interpolator.get_positions()[0] - previous));
+    previous = interpolator.get_positions()[0];
+  }
+  //the cubic from rest to rest peaks at 1.5 times the mean velocity
+  EXPECT_LT(max_step, 1.5 * 1.2 * tick / 0.1 + 1e-9);
+
+  //the frame is reached within max_frame_period
+  EXPECT_NEAR(1.2, interpolator.get_positions()[0], 1e-9);
+  interpolator.sample(0.2);
+  EXPECT_NEAR(1.2, interpolator.get_positions()[0], 1e-9);
+  EXPECT_EQ(0.0, interpolator.get_velocities()[0]);
+}
+
+TEST(FrameInterpolator, startsFromTheResetPositions)
+{
+  FrameInterpolator interpolator(1, 0.1);
+  std::vector<double> frame(1, 0.5);
+  interpolator.reset(0.0, frame);
+
+  frame[0] = -0.5;
+  interpolator.add_frame(0.0, frame);
+  interpolator.sample(tick);
+  EXPECT_NEAR(0.5, interpolator.get_positions()[0], 0.01);
+
+  //the frames keep coming: the ramp gives way to the normal segments
+  for (unsigned int i = 1; i <= 20; ++i)
+    interpolator.add_frame(i * frame_period, frame);
+  interpolator.sample(20 * frame_period + frame_period);
+  EXPECT_NEAR(-0.5, interpolator.get_positions()[0], 1e-9);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
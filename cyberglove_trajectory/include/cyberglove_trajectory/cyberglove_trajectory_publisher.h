@@ -32,25 +32,48 @@
 # define   	CYBERGLOVE_TRAJECTORY_PUBLISHER_H_
 
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 #include <vector>
 #include <boost/smart_ptr.hpp>
+#include <boost/atomic.hpp>
 #include <actionlib/client/simple_action_client.h>
 #include <trajectory_msgs/JointTrajectory.h>
 #include <trajectory_msgs/JointTrajectoryPoint.h>
 #include <control_msgs/FollowJointTrajectoryAction.h>
 #include <control_msgs/FollowJointTrajectoryGoal.h>
+#include <actionlib_msgs/GoalStatusArray.h>
 
 #include "cyberglove/serial_glove.hpp"
+#include "cyberglove/thread_config.h"
+#include "cyberglove/sample_accumulator.h"
+#include "cyberglove/sequence_tracker.h"
+#include "cyberglove/glove_clock.h"
+#include "cyberglove/publish_scheduler.h"
+#include "cyberglove/glove_joints.h"
+#include "cyberglove/message_pool.h"
+#include "cyberglove/joint_predictor.h"
+#include "cyberglove/delay_estimator.h"
 
 //messages
 #include <sensor_msgs/JointState.h>
-#include <sr_utilities/calibration.hpp>
-#include <sr_utilities/thread_safe_map.hpp>
-#include "sr_remappers/calibration_parser.h"
+#include "cyberglove/GloveFrame.h"
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include "cyberglove/xml_calibration_parser.h"
+#include "sr_remappers/profile_bank.h"
 
 using namespace ros;
 
 namespace cyberglove{
+  namespace command_modes
+  {
+    /// how the trajectories are sent to the trajectory controller
+    enum command_mode
+    {
+      ACTION,  ///< a FollowJointTrajectory goal per frame
+      TOPIC    ///< a JointTrajectory per frame, on the controller's command topic
+    };
+  }
+
   class CybergloveTrajectoryPublisher
   {
   public:
@@ -62,16 +85,15 @@ namespace cyberglove{
 
     Publisher cyberglove_pub;
 
-    typedef threadsafe::Map<boost::shared_ptr<shadow_robot::JointCalibration> > CalibrationMap;
-
-
     /**
      * Reads the calibration from the parameter server.
      *
+     * @param param the parameter containing the calibration (relative to the
+     *        node's namespace)
      *
-     * @return a calibration map
+     * @return the calibration points of each joint (calibrated values in radians)
      */
-    CalibrationMap read_joint_calibration();
+    std::vector<xml_calibration_parser::XmlCalibrationParser::JointCalibration> read_joint_calibration(const std::string& param = "cyberglove_calibration");
 
     bool isPublishing();
     void setPublishing(bool value);
@@ -80,9 +102,13 @@ namespace cyberglove{
     //  CALLBACKS  //
     /////////////////
 
+    /// The queue for the services and parameters, served by service_spinner.
+    CallbackQueue service_queue;
+    /// The spinner serving service_queue from its own thread.
+    boost::scoped_ptr<AsyncSpinner> service_spinner;
+
     //ros node handle
     NodeHandle node, n_tilde;
-    unsigned int publish_counter_max, publish_counter_index;
 
     ///the actual connection with the cyberglove is done here.
     boost::shared_ptr<CybergloveSerial> serial_glove;
@@ -94,46 +120,293 @@ namespace cyberglove{
      *
      * @param glove_pos A vector containing the current raw joints positions.
      * @param light_on true if the light is on, false otherwise.
+     * @param seq the sequence number of the frame
+     */
+    void glove_callback(std::vector<float> glove_pos, bool light_on, unsigned int seq);
+
+    /// Opens the glove on path_to_glove and configures it.
+    void init_glove(double sampling_freq);
+
+    ///the recorded frames replayed instead of the glove's (~replay_frames)
+    Subscriber replay_sub;
+    std::vector<float> replay_positions;
+
+    /**
+     * Feeds a recorded frame (as published on raw/frames) to glove_callback,
+     * as if the glove had sent it. Runs on the service thread.
+     */
+    void replay_frame_received(const cyberglove::GloveFrameConstPtr& frame);
+
+    /// Clocks the raw, trajectory and diagnostics outputs.
+    PublishScheduler scheduler;
+
+    ///the samples received since the last raw publication / trajectory goal
+    boost::scoped_ptr<SampleAccumulator> raw_samples, trajectory_samples;
+
+    /**
+     * Is the raw output subscribed? The raw samples are only accumulated and
+     * published while it is.
+     */
+    boost::atomic<bool> raw_subscribed;
+
+    /**
+     * Called each time a subscriber connects to or disconnects from the raw
+     * output (including intra-process subscribers, e.g. nodelets): updates
+     * raw_subscribed. The output is subscribed if its joint_states or its
+     * frames are.
+     */
+    void subscribers_changed();
+
+    /**
+     * Publishes the raw data. Called by the scheduler.
+     *
+     * @return true if a message was published, false if no sample was received
+     *         since the last call
+     */
+    bool publish_raw();
+
+    /**
+     * Calibrates and remaps the data, then sends the trajectory goal. Called by
+     * the scheduler.
+     *
+     * @return true if a goal was sent, false if no sample was received since
+     *         the last call or if the goal was invalid
+     */
+    bool publish_trajectory();
+
+    /**
+     * Publishes the diagnostics (achieved rates, number of messages received).
+     * Called by the scheduler.
+     *
+     * @return true
+     */
+    bool publish_diagnostics();
+
+    /**
+     * A hand driven by the glove: each frame is dispatched to all the targets.
+     */
+    struct Target : boost::noncopyable
+    {
+      Target() : command_mode(command_modes::ACTION), previous_pipeline(NULL), nb_late_goals(0),
+                 current_tx_delay(0.0), nb_suppressed(0), nb_rejected(0) {};
+
+      ///empty for the single target configured by the node's parameters
+      std::string name;
+      std::string joint_prefix;
+
+      command_modes::command_mode command_mode;
+      boost::scoped_ptr<actionlib::SimpleActionClient<control_msgs::FollowJointTrajectoryAction> > action_client;
+      control_msgs::FollowJointTrajectoryGoal trajectory_goal;
+      ///the trajectories streamed in TOPIC mode
+      Publisher command_pub;
+      boost::scoped_ptr<MessagePool<trajectory_msgs::JointTrajectory> > command_pool;
+
+      ///the target's own mapping, applied to the calibrated frames (if empty, the active profile's mapping is used)
+      boost::scoped_ptr<sr_remappers::GloveToHandPipeline> mapping;
+
+      ///predicts the hand positions, if ~predictor isn't none
+      boost::scoped_ptr<JointPredictor> predictor;
+      ///the pipeline of the previous frame: the predictor is reset when the profile changes
+      const sr_remappers::GloveToHandPipeline* previous_pipeline;
+
+      ///the measured delays from the goals being sent to the action server receiving them
+      boost::scoped_ptr<DelayEstimator> delay_estimator;
+      Subscriber goal_status_sub;
+      ///the stamp of the last goal measured (the goals are measured once)
+      ros::Time last_measured_goal;
+      ///the goals received after their trajectory started
+      boost::atomic<unsigned int> nb_late_goals;
+      ///the stamp offset of the trajectories, and its value in seconds read from the service thread
+      ros::Duration tx_delay;
+      boost::atomic<double> current_tx_delay;
+
+      ///the positions of the last trajectory sent, and when it was sent
+      std::vector<double> last_sent_positions;
+      ros::WallTime last_sent_time;
+      ///the frames without a trajectory since the last diagnostics
+      unsigned int nb_suppressed;
+      ///the frames mapped to a NaN, never sent
+      unsigned long nb_rejected;
+    };
+    typedef boost::shared_ptr<Target> TargetPtr;
+
+    /**
+     * Reads ~targets, the list of the targets' names. Each target has its own
+     * <name>/joint_prefix, <name>/command_mode (~command_mode by default) and
+     * optionally <name>/cyberglove_mapping_path. Without ~targets, there is a
+     * single target configured by ~joint_prefix and ~command_mode.
+     */
+    void init_targets();
+
+    /**
+     * Prepares the trajectory sent to a target at each frame: an action
+     * goal, or a JointTrajectory streamed to the command topic. The joint
+     * names and the points are only set once.
+     *
+     * @param mode "action" or "topic"
+     */
+    void init_command(Target& target, const std::string& mode);
+
+    /**
+     * Reads the ~predictor settings. When a predictor is used, the trajectory
+     * contains ~prediction_points points, ~prediction_step apart, predicted
+     * to compensate the delay to the hand.
      */
-    void glove_callback(std::vector<float> glove_pos, bool light_on);
+    void init_prediction();
+
+    /**
+     * Sends the trajectory of a frame to a target, unless its hand is still.
+     *
+     * @param pipeline the pipeline which processed the frame
+     * @param seq the sequence number of the frame, written in the goal's trajectory
+     *        header (roscpp renumbers the header of the topic mode's trajectories)
+     *
+     * @return true if a trajectory was sent
+     */
+    bool send_trajectory(Target& target, const sr_remappers::GloveToHandPipeline& pipeline, unsigned int seq);
+
+    /**
+     * Writes the positions of the trajectory points: the frame itself, or the
+     * positions predicted for the time each point will be reached (counted
+     * from when the frame was sampled, and capped at max_prediction_horizon_).
+     */
+    void fill_points(Target& target, std::vector<trajectory_msgs::JointTrajectoryPoint>& points,
+                     const std::vector<double>& positions);
+
+    /**
+     * Reads the tx delay settings (~adaptive_tx_delay...).
+     */
+    void init_tx_delay();
+
+    /**
+     * Measures the delay of the goals to the target's action server from
+     * its status and, if ~adaptive_tx_delay is true, adapts the target's tx
+     * delay to it.
+     *
+     * @param action_server_name the namespace of the action server
+     */
+    void init_delay_measurement(Target& target, const std::string& action_server_name);
+
+    /**
+     * Called for each status of a target's action server: the first status
+     * listing a goal gives its arrival time, the server publishing it as
+     * soon as the goal is received. Runs on the service thread.
+     */
+    void goal_status_received(const actionlib_msgs::GoalStatusArrayConstPtr& status, Target* target);
+
+    /**
+     * Sets the target's tx delay to the ~tx_delay_percentile of its measured
+     * delays, plus ~tx_delay_margin. Called with the diagnostics.
+     */
+    void adapt_tx_delay(Target& target);
+
+    /**
+     * Reads the deadband of each joint (~goal_deadband, overridden by
+     * ~goal_deadbands/<joint>) and the ~goal_keepalive.
+     */
+    void init_deadband();
+
+    /**
+     * Is a trajectory needed for this frame? It isn't if no joint moved
+     * beyond its deadband since the last trajectory sent to the target,
+     * unless the keepalive expired.
+     */
+    bool trajectory_needed(Target& target, const std::vector<double>& positions);
+
+    /// adds the diagnostics of a target, its name prefixing the keys
+    void add_target_diagnostics(Target& target, diagnostic_msgs::DiagnosticStatus& status);
+
+    /// the user + system cpu time used by the process (s)
+    static double process_cpu_time();
 
     std::string path_to_glove;
     bool publishing;
 
-    /// The map used to calibrate each joint.
-    boost::shared_ptr<CalibrationMap> calibration_map;
-    /// A temporary calibration for a given joint.
-    boost::shared_ptr<shadow_robot::JointCalibration> calibration_tmp;
-    ///the calibration parser containing the mapping matrix
-    boost::scoped_ptr<CalibrationParser> map_calibration_parser;
+    /// The calibration / mapping profiles, each calibrating the glove frames and mapping them to the hand.
+    sr_remappers::ProfileBank profiles;
+    /// Selects the active profile.
+    ServiceServer select_profile_server;
 
-    Publisher cyberglove_raw_pub;
-    sensor_msgs::JointState jointstate_msg;
+    /**
+     * Loads the calibration and mapping of a profile (see
+     * ProfileBank::PipelineFactory). A profile without its own calibration
+     * uses the default one.
+     *
+     * @param param_prefix "" for the default profile, "<name>/" for the others
+     *
+     * @return the pipeline of the profile, empty if it has no mapping
+     */
+    sr_remappers::ProfileBank::PipelinePtr load_profile(const std::string& param_prefix);
+
+    /**
+     * The timing hook of the pipeline: accumulates the time spent in each
+     * stage until the next diagnostics.
+     */
+    void stage_timed(sr_remappers::GloveToHandPipeline::stage finished_stage, double duration);
 
+    ///the time spent in each stage since the last diagnostics, and the number of frames it was spent on
+    double stage_times[sr_remappers::GloveToHandPipeline::NB_STAGES];
+    unsigned int nb_timed_frames;
 
-    std::vector<float> calibration_values;
+    ///when the node started, and whether a trajectory goal was sent since then
+    ros::WallTime startup_time;
+    bool first_frame_published;
 
-    std::vector<std::vector<float> > glove_positions;
+    Publisher cyberglove_raw_pub;
+    Publisher diagnostics_pub;
+    sensor_msgs::JointState jointstate_msg;
+    ///the same frames as raw/joint_states, with their frame number
+    Publisher cyberglove_raw_frames_pub;
+    cyberglove::GloveFrame raw_frame_msg;
 
+    ///the averaged (or latest) samples, filled at each tick
+    std::vector<float> raw_positions, trajectory_positions;
+    ///when the frame being sent was sampled (s): the predictions are counted from it
+    double trajectory_stamp_;
 
-    void applyJointMapping(const std::vector<double>& glove_postions, std::vector<double>& hand_positions );
-    void processJointZeros(const std::vector<double>& postions_with_J0, std::vector<double>& postions_without_J0 );
+    /**
+     * The frames published on the raw output and processed for the
+     * trajectories: the missing ones were merged by the averaging (or not
+     * subscribed, for the raw output).
+     */
+    SequenceTracker raw_frames_, trajectory_frames_;
 
     /**
-     * process the joint_states callback for the finger abductions: processes the message from the cyberglove node, remap it to the Dextrous hand J4s
-     * It overwrites whatever was written for the J4s by the calibration parser get_remapped_vector
-     *
-     * @param glove_postions The positions that come from the glove sensors (usually calibrated)
-     * @param hand_positions the vector where the result is written (only J4s are written)
+     * Timestamps the raw frames from the glove's sampling clock (if
+     * ~glove_clock is true), rather than when they're published.
      */
-    void getAbductionJoints( const std::vector<double>& glove_postions, std::vector<double>& hand_positions);
+    boost::scoped_ptr<GloveClock> glove_clock_;
+    ///the frames the pipeline couldn't process
+    unsigned long nb_rejected_frames_;
+
+
+    ///the hands driven by the glove
+    std::vector<TargetPtr> targets_;
+
+    ///the time spent sending the trajectories of a frame since the last diagnostics
+    double send_time_sum_, send_time_max_;
+    unsigned int nb_sent_;
+
+    ///the prediction settings, each target having its own predictor
+    predictor_types::predictor_type predictor_type_;
+    std::string predictor_name_;
+    unsigned int nb_prediction_points_;
+    ros::Duration prediction_step_;
+    double max_prediction_horizon_, prediction_smoothing_, kalman_process_noise_, kalman_measurement_noise_;
+
+    ///the tx delay settings
+    bool adaptive_tx_delay_;
+    int tx_delay_window_;
+    double tx_delay_percentile_, tx_delay_margin_, min_tx_delay_, max_tx_delay_;
 
-    static const std::vector<std::string> joint_name_vector_;
-    static const std::vector<std::string> joint_mapping_vector_;
-    static const std::vector<std::string> glove_sensors_vector_;
+    ///no trajectory is sent while no joint moves beyond its deadband (rad), except every keepalive
+    std::vector<double> goal_deadbands_;
+    bool deadband_enabled_;
+    ros::WallDuration goal_keepalive_;
 
-    boost::scoped_ptr<actionlib::SimpleActionClient<control_msgs::FollowJointTrajectoryAction> > action_client_;
-    control_msgs::FollowJointTrajectoryGoal trajectory_goal_;
+    ///the cpu time used by the process at the last diagnostics, and when they were published
+    double last_cpu_time_;
+    ros::WallTime last_diagnostics_time_;
 
     std::string cyberglove_version_;
     std::string streaming_protocol_;
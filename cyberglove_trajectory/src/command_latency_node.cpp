@@ -0,0 +1,166 @@
+/**
+ * @file   command_latency_node.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Stands in for the trajectory controller to measure the latency of
+ * the trajectories sent by the cyberglove trajectory node, in either
+ * command mode: it serves the follow_joint_trajectory action (each goal
+ * preempting the previous one, as the controller does) and subscribes to
+ * the command topic.
+ *
+ * The latency is measured from the trajectory being sent (its stamp minus
+ * ~trajectory_tx_delay, which must be the sender's) to it being received.
+ * The count, mean, median, 99th percentile and max are logged every
+ * ~report_period, and when the node stops.
+ *
+ */
+
+#include <ros/ros.h>
+#include <vector>
+#include <algorithm>
+#include <boost/scoped_ptr.hpp>
+#include <boost/bind.hpp>
+#include <actionlib/server/action_server.h>
+#include <control_msgs/FollowJointTrajectoryAction.h>
+#include <trajectory_msgs/JointTrajectory.h>
+
+namespace cyberglove
+{
+  class CommandLatency
+  {
+  public:
+    CommandLatency()
+      : n_tilde("~"), has_active_goal(false), nb_goals(0)
+    {
+      double delay, report_period;
+      n_tilde.param("trajectory_tx_delay", delay, 0.01);
+      n_tilde.param("report_period", report_period, 5.0);
+      tx_delay = ros::Duration(delay);
+
+      std::string controller;
+      n_tilde.param("controller", controller, std::string("trajectory_controller"));
+
+      //a few minutes of trajectories at 100Hz
+      latencies.reserve(100000);
+
+      command_sub = node.subscribe(controller + "/command", 100, &CommandLatency::command_received, this);
+      action_server.reset(new ActionServer(node, controller + "/follow_joint_trajectory",
+                                           boost::bind(&CommandLatency::goal_received, this, _1),
+                                           boost::bind(&CommandLatency::cancel_received, this, _1),
+                                           false));
+      action_server->start();
+
+      report_timer = node.createTimer(ros::Duration(report_period), &CommandLatency::report_timed, this);
+      ROS_INFO("Measuring the latency of %s/command and %s/follow_joint_trajectory (tx delay %.1fms)",
+               controller.c_str(), controller.c_str(), delay * 1000.0);
+    }
+
+    ~CommandLatency()
+    {
+      report();
+    }
+
+  private:
+    typedef actionlib::ActionServer<control_msgs::FollowJointTrajectoryAction> ActionServer;
+
+    ros::NodeHandle node, n_tilde;
+    ros::Subscriber command_sub;
+    boost::scoped_ptr<ActionServer> action_server;
+    ActionServer::GoalHandle active_goal;
+    bool has_active_goal;
+    ros::Timer report_timer;
+
+    ros::Duration tx_delay;
+    /// all the latencies measured (s), and the number of goals among them
+    std::vector<double> latencies;
+    unsigned long nb_goals;
+
+    void command_received(const trajectory_msgs::JointTrajectoryConstPtr& trajectory)
+    {
+      add(trajectory->header.stamp);
+    }
+
+    void goal_received(ActionServer::GoalHandle goal)
+    {
+      add(goal.getGoal()->trajectory.header.stamp);
+      ++nb_goals;
+
+      //the new trajectory replaces the one being followed
+      goal.setAccepted();
+      if( has_active_goal )
+        active_goal.setCanceled();
+      active_goal = goal;
+      has_active_goal = true;
+    }
+
+    void cancel_received(ActionServer::GoalHandle goal)
+    {
+      if( has_active_goal && goal == active_goal )
+        has_active_goal = false;
+      goal.setCanceled();
+    }
+
+    /// the trajectory was stamped tx_delay after it was sent
+    void add(const ros::Time& stamp)
+    {
+      latencies.push_back((ros::Time::now() - (stamp - tx_delay)).toSec());
+    }
+
+    void report_timed(const ros::TimerEvent&)
+    {
+      report();
+    }
+
+    void report()
+    {
+      if( latencies.empty() )
+      {
+        ROS_INFO("No trajectory received");
+        return;
+      }
+
+      std::vector<double> sorted(latencies);
+      std::sort(sorted.begin(), sorted.end());
+      double sum = 0.0;
+      for( size_t i = 0; i < sorted.size(); ++i )
+        sum += sorted[i];
+
+      ROS_INFO("%lu trajectories (%lu goals): latency mean %.3fms, median %.3fms, 99%% %.3fms, max %.3fms",
+               (unsigned long)sorted.size(), nb_goals, sum / sorted.size() * 1000.0,
+               sorted[sorted.size() / 2] * 1000.0, sorted[(sorted.size() * 99) / 100] * 1000.0,
+               sorted.back() * 1000.0);
+    }
+  };
+}
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "command_latency");
+
+  cyberglove::CommandLatency command_latency;
+  ros::spin();
+
+  return 0;
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
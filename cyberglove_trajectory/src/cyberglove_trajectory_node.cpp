@@ -51,7 +51,10 @@ int main(int argc, char** argv)
 
   boost::shared_ptr<CybergloveTrajectoryPublisher> cyberglove_pub(new CybergloveTrajectoryPublisher());
 
-  ros::spin();
+  //the services are served by the publisher's service thread, the action client
+  // spins its own thread and the data is processed on the serial thread:
+  // nothing to spin here.
+  ros::waitForShutdown();
 
   return 0;
 }
@@ -30,160 +30,84 @@
 //generic C/C++ include
 #include <string>
 #include <sstream>
+#include <algorithm>
 
 #include "cyberglove_trajectory/cyberglove_trajectory_publisher.h"
-#include <boost/assign.hpp>
 #include <math.h>
-#include <sr_utilities/sr_math_utils.hpp>
+#include <sys/resource.h>
 
 using namespace ros;
 
 namespace cyberglove{
 
-const std::vector<std::string> CybergloveTrajectoryPublisher::joint_name_vector_ = boost::assign::list_of
-                                                                                  ("THJ1")
-                                                                                  ("THJ2")
-                                                                                  ("THJ3")
-                                                                                  ("THJ4")
-                                                                                  ("THJ5")
-                                                                                  ("FFJ1")
-                                                                                  ("FFJ2")
-                                                                                  ("FFJ3")
-                                                                                  ("FFJ4")
-                                                                                  ("MFJ1")
-                                                                                  ("MFJ2")
-                                                                                  ("MFJ3")
-                                                                                  ("MFJ4")
-                                                                                  ("RFJ1")
-                                                                                  ("RFJ2")
-                                                                                  ("RFJ3")
-                                                                                  ("RFJ4")
-                                                                                  ("LFJ1")
-                                                                                  ("LFJ2")
-                                                                                  ("LFJ3")
-                                                                                  ("LFJ4")
-                                                                                  ("LFJ5")
-                                                                                  ("WRJ1")
-                                                                                  ("WRJ2");
-
-const std::vector<std::string> CybergloveTrajectoryPublisher::joint_mapping_vector_ = boost::assign::list_of
-                                                                                  ("THJ1")
-                                                                                  ("THJ2")
-                                                                                  ("THJ3")
-                                                                                  ("THJ4")
-                                                                                  ("THJ5")
-                                                                                  ("FFJ0")
-                                                                                  ("FFJ3")
-                                                                                  ("FFJ4")
-                                                                                  ("MFJ0")
-                                                                                  ("MFJ3")
-                                                                                  ("MFJ4")
-                                                                                  ("RFJ0")
-                                                                                  ("RFJ3")
-                                                                                  ("RFJ4")
-                                                                                  ("LFJ0")
-                                                                                  ("LFJ3")
-                                                                                  ("LFJ4")
-                                                                                  ("LFJ5")
-                                                                                  ("WRJ1")
-                                                                                  ("WRJ2");
-
-
-
-
-
-//initialises joint names (the order is important)
-const std::vector<std::string> CybergloveTrajectoryPublisher::glove_sensors_vector_ = boost::assign::list_of
-                                                                                    ("G_ThumbRotate")
-                                                                                    ("G_ThumbMPJ")
-                                                                                    ("G_ThumbIJ")
-                                                                                    ("G_ThumbAb")
-                                                                                    ("G_IndexMPJ")
-                                                                                    ("G_IndexPIJ")
-                                                                                    ("G_IndexDIJ")
-                                                                                    ("G_MiddleMPJ")
-                                                                                    ("G_MiddlePIJ")
-                                                                                    ("G_MiddleDIJ")
-                                                                                    ("G_MiddleIndexAb")
-                                                                                    ("G_RingMPJ")
-                                                                                    ("G_RingPIJ")
-                                                                                    ("G_RingDIJ")
-                                                                                    ("G_RingMiddleAb")
-                                                                                    ("G_PinkieMPJ")
-                                                                                    ("G_PinkiePIJ")
-                                                                                    ("G_PinkieDIJ")
-                                                                                    ("G_PinkieRingAb")
-                                                                                    ("G_PalmArch")
-                                                                                    ("G_WristPitch")
-                                                                                    ("G_WristYaw");
   /////////////////////////////////
   //    CONSTRUCTOR/DESTRUCTOR   //
   /////////////////////////////////
 
   CybergloveTrajectoryPublisher::CybergloveTrajectoryPublisher()
-    : n_tilde("~"), publish_counter_max(0), publish_counter_index(0),
-      path_to_glove("/dev/ttyS0"), publishing(true)
+    : n_tilde("~"), raw_subscribed(false), path_to_glove("/dev/ttyS0"), publishing(true),
+      startup_time(ros::WallTime::now()), first_frame_published(false),
+      trajectory_stamp_(0.0), nb_rejected_frames_(0), send_time_sum_(0.0), send_time_max_(0.0), nb_sent_(0),
+      predictor_type_(predictor_types::NONE), nb_prediction_points_(1), max_prediction_horizon_(0.0),
+      prediction_smoothing_(0.5), kalman_process_noise_(1000.0), kalman_measurement_noise_(1e-4),
+      adaptive_tx_delay_(false), tx_delay_window_(500), tx_delay_percentile_(0.99), tx_delay_margin_(0.002),
+      min_tx_delay_(0.005), max_tx_delay_(0.1), deadband_enabled_(false),
+      last_cpu_time_(process_cpu_time()), last_diagnostics_time_(ros::WallTime::now())
   {
-    std::string param;
-    std::string path;
-    n_tilde.searchParam("cyberglove_mapping_path", param);
-    n_tilde.param(param, path, std::string());
-    map_calibration_parser.reset(new CalibrationParser(path));
-    ROS_INFO("Mapping file loaded for the Cyberglove: %s", path.c_str());
+    //the services and parameters are served from their own thread
+    n_tilde.setCallbackQueue(&service_queue);
 
-    calibration_map.reset(new CalibrationMap(read_joint_calibration()));
+    //the time spent in each stage is reported in the diagnostics
+    std::fill(stage_times, stage_times + sr_remappers::GloveToHandPipeline::NB_STAGES, 0.0);
+    nb_timed_frames = 0;
 
-    std::string searched_param;
-    std::string joint_prefix;
-    searched_param = "joint_prefix";
-    n_tilde.param(searched_param, joint_prefix, std::string());
-    std::string action_server_name = "trajectory_controller/follow_joint_trajectory";
-    action_client_.reset(new actionlib::SimpleActionClient<control_msgs::FollowJointTrajectoryAction>(joint_prefix + action_server_name, true));
+    //all the mappings and calibrations are loaded now, switching between them is instantaneous
+    profiles.load(n_tilde, boost::bind(&CybergloveTrajectoryPublisher::load_profile, this, _1));
+    select_profile_server = n_tilde.advertiseService("select_profile", &sr_remappers::ProfileBank::select_profile, &profiles);
 
-    for (size_t i = 0; i < joint_name_vector_.size(); i++)
-    {
-      trajectory_goal_.trajectory.joint_names.push_back(joint_prefix + joint_name_vector_[i]);
-    }
-
-    cyberglove_raw_pub = n_tilde.advertise<sensor_msgs::JointState>("raw/joint_states", 2);
+    cyberglove_raw_pub = n_tilde.advertise<sensor_msgs::JointState>("raw/joint_states", 2,
+                                                                    boost::bind(&CybergloveTrajectoryPublisher::subscribers_changed, this),
+                                                                    boost::bind(&CybergloveTrajectoryPublisher::subscribers_changed, this));
+    //the same frames with their frame number (roscpp renumbers header.seq)
+    cyberglove_raw_frames_pub = n_tilde.advertise<cyberglove::GloveFrame>("raw/frames", 2,
+                                                                          boost::bind(&CybergloveTrajectoryPublisher::subscribers_changed, this),
+                                                                          boost::bind(&CybergloveTrajectoryPublisher::subscribers_changed, this));
 
     //initialises joint names (the order is important)
-    jointstate_msg.name.push_back("G_ThumbRotate");
-    jointstate_msg.name.push_back("G_ThumbMPJ");
-    jointstate_msg.name.push_back("G_ThumbIJ");
-    jointstate_msg.name.push_back("G_ThumbAb");
-    jointstate_msg.name.push_back("G_IndexMPJ");
-    jointstate_msg.name.push_back("G_IndexPIJ");
-    jointstate_msg.name.push_back("G_IndexDIJ");
-    jointstate_msg.name.push_back("G_MiddleMPJ");
-    jointstate_msg.name.push_back("G_MiddlePIJ");
-    jointstate_msg.name.push_back("G_MiddleDIJ");
-    jointstate_msg.name.push_back("G_MiddleIndexAb");
-    jointstate_msg.name.push_back("G_RingMPJ");
-    jointstate_msg.name.push_back("G_RingPIJ");
-    jointstate_msg.name.push_back("G_RingDIJ");
-    jointstate_msg.name.push_back("G_RingMiddleAb");
-    jointstate_msg.name.push_back("G_PinkieMPJ");
-    jointstate_msg.name.push_back("G_PinkiePIJ");
-    jointstate_msg.name.push_back("G_PinkieDIJ");
-    jointstate_msg.name.push_back("G_PinkieRingAb");
-    jointstate_msg.name.push_back("G_PalmArch");
-    jointstate_msg.name.push_back("G_WristPitch");
-    jointstate_msg.name.push_back("G_WristYaw");
+    jointstate_msg.name.assign(glove_sensors::names, glove_sensors::names + glove_sensors::NB_SENSORS);
+    raw_frame_msg.name = jointstate_msg.name;
 
 
     //set sampling frequency
     double sampling_freq;
     n_tilde.param("sampling_frequency", sampling_freq, 100.0);
 
-    // set publish_counter: the number of data we'll average
-    // before publishing.
-    double publish_freq;
+    // set the publishing frequencies: the raw data and the trajectory goals are
+    // clocked independently from the sampling. publish_frequency is the default for both.
+    double publish_freq, raw_publish_freq, trajectory_publish_freq;
     n_tilde.param("publish_frequency", publish_freq, 20.0);
-    publish_counter_max = (int)(sampling_freq / publish_freq);
-
-    ROS_INFO_STREAM("Sampling at " << sampling_freq << "Hz ; Publishing at "
-                    << publish_freq << "Hz ; Publish counter: "<< publish_counter_max);
+    n_tilde.param("raw_publish_frequency", raw_publish_freq, publish_freq);
+    n_tilde.param("trajectory_publish_frequency", trajectory_publish_freq, publish_freq);
+
+    // average the samples received between two publications (oversampling),
+    // or only use the latest one.
+    bool averaging;
+    n_tilde.param("averaging", averaging, true);
+    raw_samples.reset(new SampleAccumulator(CybergloveSerial::glove_size, averaging));
+    trajectory_samples.reset(new SampleAccumulator(CybergloveSerial::glove_size, averaging));
+
+    // timestamp the frames from a model of the glove's sampling clock (fitted
+    // on their arrival times), or when they're published
+    bool use_glove_clock;
+    int glove_clock_window;
+    n_tilde.param("glove_clock", use_glove_clock, true);
+    n_tilde.param("glove_clock_window", glove_clock_window, 500);
+    if( use_glove_clock )
+      glove_clock_.reset(new GloveClock(1.0 / sampling_freq, std::max(glove_clock_window, 2)));
+
+    ROS_INFO_STREAM("Sampling at " << sampling_freq << "Hz ; Publishing raw data at "
+                    << raw_publish_freq << "Hz, trajectory goals at " << trajectory_publish_freq
+                    << "Hz ; " << (averaging ? "averaging the samples" : "using the latest sample"));
 
     //Get the cyberglove version '2' or '3'
     n_tilde.param("cyberglove_version", cyberglove_version_, std::string("2"));
@@ -210,8 +134,57 @@ const std::vector<std::string> CybergloveTrajectoryPublisher::glove_sensors_vect
     n_tilde.param("trajectory_delay", delay, 0.002);
     trajectory_delay_ = ros::Duration(delay);
 
+    init_prediction();
+    init_deadband();
+    init_tx_delay();
+    init_targets();
+
+    //a recorded frame stream (raw/frames, e.g. played from a bag) can be
+    // replayed instead of reading the glove, to compare the command modes on
+    // the same frames
+    std::string replay_topic;
+    n_tilde.param("replay_frames", replay_topic, std::string());
+    if( replay_topic.empty() )
+      init_glove(sampling_freq);
+    else
+      ROS_INFO("Replaying the frames of %s instead of reading the glove", node.resolveName(replay_topic).c_str());
+
+    diagnostics_pub = node.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 2);
+
+    //start the publishing thread
+    scheduler.add_output("raw", raw_publish_freq, boost::bind(&CybergloveTrajectoryPublisher::publish_raw, this));
+    scheduler.add_output("trajectory", trajectory_publish_freq, boost::bind(&CybergloveTrajectoryPublisher::publish_trajectory, this));
+    scheduler.add_output("diagnostics", 1.0, boost::bind(&CybergloveTrajectoryPublisher::publish_diagnostics, this));
+    scheduler.start(ThreadConfig::from_parameters(n_tilde, "publish_thread"));
+
+    //start serving the services: the thread is configured by the first callback it runs
+    service_queue.addCallback(CallbackInterfacePtr(new ThreadConfigCallback(ThreadConfig::from_parameters(n_tilde, "service_thread"), "service")));
+    service_spinner.reset(new AsyncSpinner(1, &service_queue));
+    service_spinner->start();
+
+    //start reading the data.
+    if( serial_glove )
+      serial_glove->start_stream();
+    else
+    {
+      //subscribed through n_tilde: the frames are processed on the service thread
+      replay_positions.resize(CybergloveSerial::glove_size);
+      replay_sub = n_tilde.subscribe(node.resolveName(replay_topic), 100, &CybergloveTrajectoryPublisher::replay_frame_received, this);
+    }
+  }
+
+  void CybergloveTrajectoryPublisher::init_glove(double sampling_freq)
+  {
     //initialize the connection with the cyberglove and binds the callback function
-    serial_glove = boost::shared_ptr<CybergloveSerial>(new CybergloveSerial(path_to_glove, cyberglove_version_, streaming_protocol_, boost::bind(&CybergloveTrajectoryPublisher::glove_callback, this, _1, _2)));
+    serial_glove = boost::shared_ptr<CybergloveSerial>(new CybergloveSerial(path_to_glove, cyberglove_version_, streaming_protocol_, boost::bind(&CybergloveTrajectoryPublisher::glove_callback, this, _1, _2, _3)));
+    serial_glove->set_thread_config(ThreadConfig::from_parameters(n_tilde, "serial_thread"));
+
+    // the invalid sensor values are repaired from the last valid ones (median
+    // of sensor_repair_history values), unless too many sensors are invalid
+    int sensor_repair_history, max_repaired_sensors;
+    n_tilde.param("sensor_repair_history", sensor_repair_history, 5);
+    n_tilde.param("max_repaired_sensors", max_repaired_sensors, 4);
+    serial_glove->set_sensor_repair(std::max(sensor_repair_history, 0), std::max(max_repaired_sensors, 0));
 
     int res = -1;
     if(cyberglove_version_ == "2")
@@ -247,13 +220,17 @@ const std::vector<std::string> CybergloveTrajectoryPublisher::glove_sensors_vect
     std::string filt_msg(filtering?"ON":"OFF");
     ROS_INFO("Filtering: %s", filt_msg.c_str());
     res = serial_glove->set_filtering(filtering);
-
-    //start reading the data.
-    res = serial_glove->start_stream();
   }
 
   CybergloveTrajectoryPublisher::~CybergloveTrajectoryPublisher()
   {
+    //stop the publishing and serial threads before destroying what they use
+    scheduler.stop();
+    serial_glove.reset();
+
+    //stop serving the services before the publisher is destroyed
+    if( service_spinner )
+      service_spinner->stop();
   }
 
   bool CybergloveTrajectoryPublisher::isPublishing()
@@ -276,202 +253,674 @@ const std::vector<std::string> CybergloveTrajectoryPublisher::glove_sensors_vect
   /////////////////////////////////
   //       CALLBACK METHOD       //
   /////////////////////////////////
-  void CybergloveTrajectoryPublisher::glove_callback(std::vector<float> glove_pos, bool light_on)
+  void CybergloveTrajectoryPublisher::glove_callback(std::vector<float> glove_pos, bool light_on, unsigned int seq)
   {
+    //all the frames are sampled on the glove's clock, even with the light off
+    double stamp = ros::Time::now().toSec();
+    if( glove_clock_ )
+      stamp = glove_clock_->update(stamp, seq);
+
     //if the light is off, we don't publish any data.
     if( !light_on )
     {
       publishing = false;
       ROS_DEBUG("The glove button is off, no data will be read / sent");
-      ros::spinOnce();
       return;
     }
     publishing = true;
 
-    //appends the current position to the vector of position
-    glove_positions.push_back( glove_pos );
+    //the samples are averaged and published from the publishing thread,
+    // the raw ones only if they are subscribed
+    if( raw_subscribed )
+      raw_samples->add_sample(glove_pos, seq, stamp);
+    trajectory_samples->add_sample(glove_pos, seq, stamp);
+  }
+
+  void CybergloveTrajectoryPublisher::replay_frame_received(const cyberglove::GloveFrameConstPtr& frame)
+  {
+    if( frame->position.size() != replay_positions.size() )
+    {
+      ROS_WARN_THROTTLE(1.0, "Replayed frame %u has %u positions instead of %u: ignored", frame->frame_number,
+                        (unsigned int)frame->position.size(), (unsigned int)replay_positions.size());
+      return;
+    }
 
-    publish_counter_index += 1;
+    replay_positions.assign(frame->position.begin(), frame->position.end());
+    glove_callback(replay_positions, true, frame->frame_number);
+  }
 
-    //if we've enough samples, publish the data:
-    if( publish_counter_index == publish_counter_max )
+  void CybergloveTrajectoryPublisher::subscribers_changed()
+  {
+    bool raw = cyberglove_raw_pub.getNumSubscribers() + cyberglove_raw_frames_pub.getNumSubscribers() > 0;
+
+    //drop what was accumulated before the output was last unsubscribed
+    if( raw && !raw_subscribed )
+      raw_samples->reset();
+
+    if( raw != raw_subscribed )
+      ROS_INFO("Raw data %s", raw ? "subscribed: publishing" : "unsubscribed: stopped publishing");
+
+    raw_subscribed = raw;
+  }
+
+  bool CybergloveTrajectoryPublisher::publish_raw()
+  {
+    unsigned int seq;
+    double stamp;
+    if( !raw_subscribed || raw_samples->take(raw_positions, seq, stamp) == 0 )
+      return false;
+    raw_frames_.add(seq);
+
+    jointstate_msg.header.stamp = glove_clock_ ? ros::Time(stamp) : ros::Time::now();
+    jointstate_msg.position.assign(raw_positions.begin(), raw_positions.end());
+    if( cyberglove_raw_pub.getNumSubscribers() > 0 )
+      cyberglove_raw_pub.publish(jointstate_msg);
+
+    if( cyberglove_raw_frames_pub.getNumSubscribers() > 0 )
     {
-      std::vector<double> glove_calibrated_positions, hand_positions, hand_positions_no_J0;
+      raw_frame_msg.header.stamp = jointstate_msg.header.stamp;
+      raw_frame_msg.frame_number = seq;
+      raw_frame_msg.position = jointstate_msg.position;
+      cyberglove_raw_frames_pub.publish(raw_frame_msg);
+    }
+
+    return true;
+  }
 
-      jointstate_msg.position.clear();
-      jointstate_msg.header.stamp = ros::Time::now();
+  bool CybergloveTrajectoryPublisher::publish_trajectory()
+  {
+    unsigned int seq;
+    if( trajectory_samples->take(trajectory_positions, seq, trajectory_stamp_) == 0 )
+      return false;
+    trajectory_frames_.add(seq);
 
-      //fill the joint_state msg with the averaged glove data
-      for(unsigned int index_joint = 0; index_joint < CybergloveSerial::glove_size; ++index_joint)
+    //calibrate, remap and split the J0s of the whole frame at once: the
+    // calibration is shared by all the targets
+    sr_remappers::ProfileBank::PipelinePtr pipeline = profiles.active();
+    if( !pipeline->process(trajectory_positions) )
+    {
+      ++nb_rejected_frames_;
+      return false;
+    }
+
+    //the trajectories are only queued for sending: the targets don't wait for each other
+    ros::WallTime send_start = ros::WallTime::now();
+    bool sent = false;
+    for (unsigned int i = 0; i < targets_.size(); ++i)
+    {
+      Target& target = *targets_[i];
+
+      //a target with its own mapping maps the calibrated frame itself
+      const sr_remappers::GloveToHandPipeline* target_pipeline = pipeline.get();
+      if( target.mapping )
       {
-        //compute the average over the samples for the current joint
-        float averaged_value = 0.0f;
-        for (unsigned int index_sample = 0; index_sample < publish_counter_max; ++index_sample)
+        if( !target.mapping->process_calibrated(pipeline->get_glove_positions()) )
         {
-          averaged_value += glove_positions[index_sample][index_joint];
+          ++target.nb_rejected;
+          continue;
         }
-        averaged_value /= publish_counter_max;
-
-	calibration_tmp = calibration_map->find(glove_sensors_vector_[index_joint]);
-	double calibration_value = calibration_tmp->compute(static_cast<double> (averaged_value));
-
-	jointstate_msg.position.push_back(averaged_value);
-        glove_calibrated_positions.push_back(calibration_value);
+        target_pipeline = target.mapping.get();
       }
-      cyberglove_raw_pub.publish(jointstate_msg);
 
-      publish_counter_index = 0;
-      glove_positions.clear();
+      //the velocities can't be estimated across a change of calibration / mapping
+      if( target.predictor && target_pipeline != target.previous_pipeline )
+        target.predictor->reset();
+      target.previous_pipeline = target_pipeline;
 
+      if( send_trajectory(target, *target_pipeline, seq) )
+        sent = true;
+    }
 
-      applyJointMapping(glove_calibrated_positions, hand_positions);
-      processJointZeros(hand_positions, hand_positions_no_J0);
+    if( !sent )
+      return false;
 
-      //Build and send the goal
+    double send_time = (ros::WallTime::now() - send_start).toSec();
+    send_time_sum_ += send_time;
+    send_time_max_ = std::max(send_time_max_, send_time);
+    ++nb_sent_;
 
-      trajectory_goal_.trajectory.points.clear();
-      //WARNING if this node runs on a different machine from the trajectory controller, both machines will need to be synchronized
-      // chrony (sudo apt-get install crony) has been used successfully to achieve that
-      // The extra 10ms will allow time for the trajectory to get to the trajectory controller
-      trajectory_goal_.trajectory.header.stamp = ros::Time::now() + trajectory_tx_delay_;
+    if( !first_frame_published )
+    {
+      ROS_INFO("First trajectory goal sent %.3fs after startup",
+               (ros::WallTime::now() - startup_time).toSec());
+      first_frame_published = true;
+    }
 
-      trajectory_msgs::JointTrajectoryPoint trajectory_point = trajectory_msgs::JointTrajectoryPoint();
-      trajectory_point.positions = hand_positions_no_J0;
-      // We set the time from start to 10 ms, to allow some time for the hand to get there
-      trajectory_point.time_from_start = trajectory_delay_;
+    return true;
+  }
 
-      for (size_t i=0; i < trajectory_point.positions.size(); i++)
+  bool CybergloveTrajectoryPublisher::send_trajectory(Target& target, const sr_remappers::GloveToHandPipeline& pipeline, unsigned int seq)
+  {
+    const std::vector<double>& positions = pipeline.get_hand_positions();
+    for (size_t i=0; i < positions.size(); i++)
+    {
+      if(isnan(positions[i]))
       {
-        if(isnan(trajectory_point.positions[i]))
-          return;
+        ++target.nb_rejected;
+        return false;
       }
+    }
 
-      trajectory_goal_.trajectory.points.push_back(trajectory_point);
+    if( target.predictor )
+      target.predictor->update(trajectory_stamp_, positions);
 
-      action_client_->sendGoal(trajectory_goal_);
+    //the hand is still: the controller keeps following the last trajectory
+    if( !trajectory_needed(target, positions) )
+    {
+      ++target.nb_suppressed;
+      return false;
     }
 
-    ros::spinOnce();
-  }
+    //WARNING if this node runs on a different machine from the trajectory controller, both machines will need to be synchronized
+    // chrony (sudo apt-get install crony) has been used successfully to achieve that
+    // The trajectory starts tx_delay from now, the time it takes to get to the controller: the target's
+    // trajectory_tx_delay, or its measured percentile with adaptive_tx_delay (see adapt_tx_delay)
+    ros::Time stamp = ros::Time::now() + target.tx_delay;
+
+    //only the stamp and the positions change, the points were set up by init_command
+    if( target.command_mode == command_modes::TOPIC )
+    {
+      MessagePool<trajectory_msgs::JointTrajectory>::MessagePtr command = target.command_pool->get();
+      command->header.stamp = stamp;
+      fill_points(target, command->points, positions);
+      target.command_pub.publish(command);
+    }
+    else
+    {
+      //the goal's trajectory header is nested, roscpp sends it as is: the
+      // controller sees the frame number
+      target.trajectory_goal.trajectory.header.seq = seq;
+      target.trajectory_goal.trajectory.header.stamp = stamp;
+      fill_points(target, target.trajectory_goal.trajectory.points, positions);
+      target.action_client->sendGoal(target.trajectory_goal);
+    }
 
+    return true;
+  }
 
-  void CybergloveTrajectoryPublisher::applyJointMapping(const std::vector<double>& glove_postions, std::vector<double>& hand_positions )
+  bool CybergloveTrajectoryPublisher::publish_diagnostics()
   {
-      //Do conversion
-      std::vector<double> vect = map_calibration_parser->get_remapped_vector(glove_postions);
+    diagnostic_msgs::DiagnosticArray diagnostics;
+    diagnostics.header.stamp = ros::Time::now();
 
-      //Process J4's
-      getAbductionJoints(glove_postions, vect);
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = ros::this_node::getName() + ": publishing";
+    status.hardware_id = path_to_glove;
+    if( publishing )
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::OK;
+      status.message = "Publishing";
+    }
+    else
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+      status.message = "The glove button is off";
+    }
+    scheduler.add_diagnostics(status);
+    if( glove_clock_ )
+      glove_clock_->add_diagnostics(status);
+
+    diagnostic_msgs::KeyValue key_value;
+    std::stringstream ss;
+    if( serial_glove )
+    {
+      ss << serial_glove->get_nb_msgs_received();
+      key_value.key = "messages received";
+      key_value.value = ss.str();
+      status.values.push_back(key_value);
+    }
+    else
+    {
+      key_value.key = "replaying";
+      key_value.value = replay_sub.getTopic();
+      status.values.push_back(key_value);
+    }
+
+    key_value.key = "raw subscribed";
+    key_value.value = raw_subscribed ? "True" : "False";
+    status.values.push_back(key_value);
+
+    key_value.key = "active profile";
+    key_value.value = profiles.active_name();
+    status.values.push_back(key_value);
 
-      hand_positions = vect;
+    //where the frames were lost: in the parser, before being published, or in the pipeline
+    if( serial_glove )
+    {
+      ss.str("");
+      ss << serial_glove->get_nb_frames_rejected();
+      key_value.key = "frames rejected by the parser";
+      key_value.value = ss.str();
+      status.values.push_back(key_value);
+      serial_glove->get_sensor_repair().add_diagnostics(status);
+    }
+
+    raw_frames_.add_diagnostics("raw", status);
+    trajectory_frames_.add_diagnostics("trajectory", status);
+
+    ss.str("");
+    ss << nb_rejected_frames_;
+    key_value.key = "frames rejected by the pipeline";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    //the mean time spent in each stage since the last diagnostics (the
+    // trajectory goals and the diagnostics are both sent from the publishing thread)
+    for (unsigned int i = 0; i < sr_remappers::GloveToHandPipeline::NB_STAGES; ++i)
+    {
+      ss.str("");
+      ss << (nb_timed_frames > 0 ? stage_times[i] / nb_timed_frames * 1e6 : 0.0);
+      key_value.key = std::string(sr_remappers::GloveToHandPipeline::stage_names[i]) + " time (us)";
+      key_value.value = ss.str();
+      status.values.push_back(key_value);
+      stage_times[i] = 0.0;
+    }
+    nb_timed_frames = 0;
+
+    key_value.key = "predictor";
+    key_value.value = predictor_name_;
+    status.values.push_back(key_value);
+
+    //the cost of sending the trajectories of a frame (to all the targets)
+    ss.str("");
+    ss << (nb_sent_ > 0 ? send_time_sum_ / nb_sent_ * 1e6 : 0.0);
+    key_value.key = "send time (us)";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << send_time_max_ * 1e6;
+    key_value.key = "max send time (us)";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    send_time_sum_ = send_time_max_ = 0.0;
+    nb_sent_ = 0;
+
+    for (unsigned int i = 0; i < targets_.size(); ++i)
+      add_target_diagnostics(*targets_[i], status);
+
+    //the cpu used by the whole node (all its threads) since the last diagnostics
+    double cpu_time = process_cpu_time();
+    ros::WallTime now = ros::WallTime::now();
+    double elapsed = (now - last_diagnostics_time_).toSec();
+    ss.str("");
+    ss << (elapsed > 0.0 ? (cpu_time - last_cpu_time_) / elapsed * 100.0 : 0.0);
+    key_value.key = "cpu use (%)";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+    last_cpu_time_ = cpu_time;
+    last_diagnostics_time_ = now;
+
+    diagnostics.status.push_back(status);
+    diagnostics_pub.publish(diagnostics);
+
+    return true;
   }
 
-  void CybergloveTrajectoryPublisher::processJointZeros(const std::vector<double>& postions_with_J0, std::vector<double>& postions_without_J0 )
+  void CybergloveTrajectoryPublisher::add_target_diagnostics(Target& target, diagnostic_msgs::DiagnosticStatus& status)
   {
-    for(unsigned int i = 0; i < postions_with_J0.size(); ++i )
+    std::string prefix = target.name.empty() ? std::string() : target.name + " ";
+    diagnostic_msgs::KeyValue key_value;
+    std::stringstream ss;
+
+    key_value.key = prefix + "command mode";
+    key_value.value = target.command_mode == command_modes::TOPIC ? "topic" : "action";
+    status.values.push_back(key_value);
+
+    //the frames the target's mapping failed on, or mapped to a NaN
+    ss << target.nb_rejected;
+    key_value.key = prefix + "rejected frames";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    //the delays measured from the action server's status
+    if( target.delay_estimator )
     {
-      if (joint_mapping_vector_[i][joint_mapping_vector_[i].size()-1] == '0')
+      adapt_tx_delay(target);
+
+      ss.str("");
+      ss << target.tx_delay.toSec() * 1000.0;
+      key_value.key = prefix + (adaptive_tx_delay_ ? "tx delay (ms, adaptive)" : "tx delay (ms)");
+      key_value.value = ss.str();
+      status.values.push_back(key_value);
+
+      double delay;
+      if( target.delay_estimator->percentile(0.5, delay) )
       {
-        postions_without_J0.push_back(postions_with_J0[i] / 2);
-        postions_without_J0.push_back(postions_with_J0[i] / 2);
+        ss.str("");
+        ss << delay * 1000.0;
+        key_value.key = prefix + "measured delay median (ms)";
+        key_value.value = ss.str();
+        status.values.push_back(key_value);
       }
+      if( target.delay_estimator->percentile(tx_delay_percentile_, delay) )
+      {
+        ss.str("");
+        ss << delay * 1000.0;
+        key_value.key = prefix + "measured delay percentile (ms)";
+        key_value.value = ss.str();
+        status.values.push_back(key_value);
+      }
+
+      ss.str("");
+      ss << target.nb_late_goals;
+      key_value.key = prefix + "late goals";
+      key_value.value = ss.str();
+      status.values.push_back(key_value);
+    }
+
+    if( deadband_enabled_ )
+    {
+      ss.str("");
+      ss << target.nb_suppressed;
+      key_value.key = prefix + "suppressed trajectories";
+      key_value.value = ss.str();
+      status.values.push_back(key_value);
+      target.nb_suppressed = 0;
+    }
+  }
+
+  void CybergloveTrajectoryPublisher::init_targets()
+  {
+    std::string default_mode;
+    n_tilde.param("command_mode", default_mode, std::string("action"));
+
+    std::vector<std::string> names;
+    XmlRpc::XmlRpcValue target_names;
+    if( n_tilde.getParam("targets", target_names) )
+    {
+      if( target_names.getType() != XmlRpc::XmlRpcValue::TypeArray )
+        ROS_ERROR("The targets parameter should be a list of target names.");
       else
       {
-        postions_without_J0.push_back(postions_with_J0[i]);
+        for (int32_t i = 0; i < target_names.size(); ++i)
+        {
+          if( target_names[i].getType() != XmlRpc::XmlRpcValue::TypeString )
+            ROS_ERROR("The targets parameter should be a list of target names.");
+          else
+            names.push_back(static_cast<std::string>(target_names[i]));
+        }
       }
     }
+
+    //no targets: a single one, configured as before
+    if( names.empty() )
+      names.push_back(std::string());
+
+    for (unsigned int i = 0; i < names.size(); ++i)
+    {
+      TargetPtr target(new Target());
+      target->name = names[i];
+      std::string param_prefix = names[i].empty() ? std::string() : names[i] + "/";
+
+      n_tilde.param(param_prefix + "joint_prefix", target->joint_prefix, std::string());
+      std::string mode;
+      n_tilde.param(param_prefix + "command_mode", mode, default_mode);
+
+      //the target's own mapping, the calibration being shared
+      std::string path_to_mapping;
+      if( !param_prefix.empty() && n_tilde.getParam(param_prefix + "cyberglove_mapping_path", path_to_mapping) )
+      {
+        target->mapping.reset(new sr_remappers::GloveToHandPipeline(path_to_mapping));
+        ROS_INFO("Mapping file loaded for the target %s: %s", names[i].c_str(), path_to_mapping.c_str());
+      }
+
+      if( predictor_type_ != predictor_types::NONE )
+        target->predictor.reset(new JointPredictor(hand_joints::NB_JOINTS, predictor_type_, prediction_smoothing_,
+                                                   kalman_process_noise_, kalman_measurement_noise_));
+
+      target->tx_delay = trajectory_tx_delay_;
+      target->current_tx_delay = trajectory_tx_delay_.toSec();
+
+      init_command(*target, mode);
+      targets_.push_back(target);
+    }
   }
 
-  void CybergloveTrajectoryPublisher::getAbductionJoints(const std::vector<double>& glove_postions, std::vector<double>& hand_positions)
+  void CybergloveTrajectoryPublisher::init_command(Target& target, const std::string& mode)
   {
-    double middleIndexAb = glove_postions[10];
-    double ringMiddleAb = glove_postions[14];
-    double pinkieRingAb = glove_postions[18];
-
-    // if the abduction sensors are less than 0, it is an artifact of the calibration (we don't want to consider anything smaller than 0 for these sensors)
-    if (middleIndexAb < 0.0)
-      middleIndexAb = 0.0;
-    if (ringMiddleAb < 0.0)
-      ringMiddleAb = 0.0;
-    if (pinkieRingAb < 0.0)
-      pinkieRingAb = 0.0;
-    //Add the 3 abduction angles to have an idea of where the centre lies
-    double ab_total = middleIndexAb + ringMiddleAb +  pinkieRingAb;
-
-    //When trying to understand this code bear in mind that the abduction sign convention
-    // in the shadow hand is the opposite for ff and mf than for rf and lf.
-    if (ab_total/2 < middleIndexAb) // If the centre lies between ff and mf
-    {
-      //FFJ4
-      hand_positions[7] = -ab_total/2;
-      //MFJ4
-      hand_positions[10] = middleIndexAb - ab_total/2;
-      //RFJ4
-      hand_positions[13] = -(ringMiddleAb + hand_positions[10]);
-      //LFJ4
-      hand_positions[16] = -pinkieRingAb + hand_positions[13];
-    }
-    else if (ab_total/2 < middleIndexAb + ringMiddleAb) // If the centre lies between mf and rf
-    {
-      //MFJ4
-      hand_positions[10] = -(ab_total/2 - middleIndexAb);
-      //FFJ4
-      hand_positions[7] = -middleIndexAb + hand_positions[10];
-      //RFJ4
-      hand_positions[13] = -(ringMiddleAb + hand_positions[10]);
-      //LFJ4
-      hand_positions[16] = -pinkieRingAb + hand_positions[13];
-    }
-    else // If the centre lies between rf and lf
-    {
-      //LFJ4
-      hand_positions[16] = -ab_total/2;
-      //RFJ4
-      hand_positions[13] = pinkieRingAb + hand_positions[16];
-      //MFJ4
-      hand_positions[10] = -(ringMiddleAb + hand_positions[13]);
-      //FFJ4
-      hand_positions[7] = -middleIndexAb + hand_positions[10];
+    //the first point is reached trajectory_delay after the stamp, the
+    // predicted ones (if any) prediction_step apart
+    trajectory_msgs::JointTrajectory trajectory;
+    for (unsigned int i = 0; i < hand_joints::NB_JOINTS; i++)
+    {
+      trajectory.joint_names.push_back(target.joint_prefix + hand_joints::names[i]);
+    }
+    trajectory.points.resize(nb_prediction_points_);
+    for (unsigned int i = 0; i < nb_prediction_points_; ++i)
+    {
+      trajectory.points[i].positions.resize(hand_joints::NB_JOINTS);
+      trajectory.points[i].time_from_start = trajectory_delay_ + ros::Duration(prediction_step_.toSec() * i);
     }
+
+    if( mode == "topic" )
+    {
+      //each trajectory replaces the one the controller follows, without the
+      // goal ids, status and feedback of the action
+      target.command_mode = command_modes::TOPIC;
+      target.command_pool.reset(new MessagePool<trajectory_msgs::JointTrajectory>(trajectory));
+      target.command_pub = node.advertise<trajectory_msgs::JointTrajectory>(target.joint_prefix + "trajectory_controller/command", 1);
+      ROS_INFO("Streaming the trajectories to %s", target.command_pub.getTopic().c_str());
+
+      if( adaptive_tx_delay_ )
+        ROS_WARN("The tx delay can only be measured (and adapted) with the action command mode: using trajectory_tx_delay for %s",
+                 target.command_pub.getTopic().c_str());
+      return;
+    }
+
+    if( mode != "action" )
+      ROS_WARN("Unknown command_mode %s, sending action goals", mode.c_str());
+
+    target.command_mode = command_modes::ACTION;
+    target.trajectory_goal.trajectory = trajectory;
+    std::string action_server_name = target.joint_prefix + "trajectory_controller/follow_joint_trajectory";
+    target.action_client.reset(new actionlib::SimpleActionClient<control_msgs::FollowJointTrajectoryAction>(action_server_name, true));
+    init_delay_measurement(target, action_server_name);
   }
 
-CybergloveTrajectoryPublisher::CalibrationMap CybergloveTrajectoryPublisher::read_joint_calibration()
-{
-  CalibrationMap joint_calibration;
+  void CybergloveTrajectoryPublisher::init_tx_delay()
+  {
+    n_tilde.param("tx_delay_window", tx_delay_window_, 500);
+    n_tilde.param("adaptive_tx_delay", adaptive_tx_delay_, false);
+    n_tilde.param("tx_delay_percentile", tx_delay_percentile_, 0.99);
+    n_tilde.param("tx_delay_margin", tx_delay_margin_, 0.002);
+    n_tilde.param("min_tx_delay", min_tx_delay_, 0.005);
+    n_tilde.param("max_tx_delay", max_tx_delay_, 0.1);
+    if( adaptive_tx_delay_ )
+      ROS_INFO("Adapting the trajectory tx delay to the %.0fth percentile of the measured delays + %.0fms (%.0fms to %.0fms)",
+               tx_delay_percentile_ * 100.0, tx_delay_margin_ * 1000.0, min_tx_delay_ * 1000.0, max_tx_delay_ * 1000.0);
+  }
 
-  XmlRpc::XmlRpcValue calib;
-  n_tilde.getParam("cyberglove_calibration", calib);
-  ROS_ASSERT(calib.getType() == XmlRpc::XmlRpcValue::TypeArray);
-  //iterate on all the joints
-  for (int32_t index_cal = 0; index_cal < calib.size(); ++index_cal)
+  void CybergloveTrajectoryPublisher::init_delay_measurement(Target& target, const std::string& action_server_name)
   {
-    //check the calibration is well formatted:
-    // first joint name, then calibration table
-    ROS_ASSERT(calib[index_cal][0].getType() == XmlRpc::XmlRpcValue::TypeString);
-    ROS_ASSERT(calib[index_cal][1].getType() == XmlRpc::XmlRpcValue::TypeArray);
+    target.delay_estimator.reset(new DelayEstimator(std::max(tx_delay_window_, 1)));
 
-    string joint_name = static_cast<string> (calib[index_cal][0]);
-    vector<joint_calibration::Point> calib_table_tmp;
+    //subscribed through n_tilde: the status is processed on the service thread
+    target.goal_status_sub = n_tilde.subscribe<actionlib_msgs::GoalStatusArray>(node.resolveName(action_server_name + "/status"), 10,
+                                                                                boost::bind(&CybergloveTrajectoryPublisher::goal_status_received, this, _1, &target));
+  }
 
-    //now iterates on the calibration table for the current joint
-    for (int32_t index_table = 0; index_table < calib[index_cal][1].size(); ++index_table)
+  void CybergloveTrajectoryPublisher::goal_status_received(const actionlib_msgs::GoalStatusArrayConstPtr& status, Target* target)
+  {
+    //WARNING the delays are only meaningful if the clocks of both machines are synchronized
+    ros::Time newest = target->last_measured_goal;
+    for (size_t i = 0; i < status->status_list.size(); ++i)
     {
-      ROS_ASSERT(calib[index_cal][1][index_table].getType() == XmlRpc::XmlRpcValue::TypeArray);
-      //only 2 values per calibration point: raw and calibrated (doubles)
-      ROS_ASSERT(calib[index_cal][1][index_table].size() == 2);
-      ROS_ASSERT(calib[index_cal][1][index_table][0].getType() == XmlRpc::XmlRpcValue::TypeDouble);
-      ROS_ASSERT(calib[index_cal][1][index_table][1].getType() == XmlRpc::XmlRpcValue::TypeDouble);
+      const actionlib_msgs::GoalID& goal_id = status->status_list[i].goal_id;
+      //the goals listed in the previous status were already measured
+      if( goal_id.stamp <= target->last_measured_goal )
+        continue;
 
+      double delay = (status->header.stamp - goal_id.stamp).toSec();
+      target->delay_estimator->add(delay);
+      if( delay > target->current_tx_delay )
+        ++target->nb_late_goals;
 
-      joint_calibration::Point point_tmp;
-      point_tmp.raw_value = static_cast<double> (calib[index_cal][1][index_table][0]);
-      point_tmp.calibrated_value = sr_math_utils::to_rad(static_cast<double> (calib[index_cal][1][index_table][1]));
-      calib_table_tmp.push_back(point_tmp);
+      newest = std::max(newest, goal_id.stamp);
+    }
+    target->last_measured_goal = newest;
+  }
+
+  void CybergloveTrajectoryPublisher::adapt_tx_delay(Target& target)
+  {
+    //a few goals must have been measured for the percentile to mean something
+    if( !adaptive_tx_delay_ || target.delay_estimator->get_nb_delays() < 20 )
+      return;
+
+    double delay;
+    if( !target.delay_estimator->percentile(tx_delay_percentile_, delay) )
+      return;
+
+    delay = std::min(std::max(delay + tx_delay_margin_, min_tx_delay_), max_tx_delay_);
+    target.tx_delay = ros::Duration(delay);
+    target.current_tx_delay = delay;
+  }
+
+  void CybergloveTrajectoryPublisher::init_prediction()
+  {
+    n_tilde.param("predictor", predictor_name_, std::string("none"));
+    if( !JointPredictor::parse_type(predictor_name_, predictor_type_) )
+      ROS_WARN("Unknown predictor %s, the frames are sent as they are", predictor_name_.c_str());
+    if( predictor_type_ == predictor_types::NONE )
+    {
+      predictor_name_ = "none";
+      return;
     }
 
-    joint_calibration.insert(joint_name, boost::shared_ptr<shadow_robot::JointCalibration>(new shadow_robot::JointCalibration(calib_table_tmp)));
+    //the points cover the delay to the hand, and the frames sent meanwhile
+    int nb_points;
+    double step;
+    n_tilde.param("prediction_points", nb_points, 3);
+    n_tilde.param("prediction_step", step, 0.01);
+    n_tilde.param("max_prediction_horizon", max_prediction_horizon_, 0.1);
+    nb_prediction_points_ = std::max(nb_points, 1);
+    prediction_step_ = ros::Duration(step);
+
+    n_tilde.param("prediction_smoothing", prediction_smoothing_, 0.5);
+    n_tilde.param("kalman_process_noise", kalman_process_noise_, 1000.0);
+    n_tilde.param("kalman_measurement_noise", kalman_measurement_noise_, 1e-4);
+
+    ROS_INFO("Predicting the hand positions (%s): %u points, %.0fms apart, up to %.0fms ahead",
+             predictor_name_.c_str(), nb_prediction_points_, step * 1000.0, max_prediction_horizon_ * 1000.0);
   }
 
+  void CybergloveTrajectoryPublisher::fill_points(Target& target, std::vector<trajectory_msgs::JointTrajectoryPoint>& points,
+                                                  const std::vector<double>& positions)
+  {
+    if( !target.predictor )
+    {
+      points[0].positions.assign(positions.begin(), positions.end());
+      return;
+    }
+
+    //each point is reached tx_delay + time_from_start after now, the frame
+    // was sampled age before
+    double age = ros::Time::now().toSec() - trajectory_stamp_;
+    for (unsigned int i = 0; i < points.size(); ++i)
+    {
+      double horizon = std::min(age + (target.tx_delay + points[i].time_from_start).toSec(), max_prediction_horizon_);
+      target.predictor->predict(horizon, points[i].positions);
+    }
+  }
+
+  void CybergloveTrajectoryPublisher::init_deadband()
+  {
+    double deadband, keepalive;
+    n_tilde.param("goal_deadband", deadband, 0.0);
+    n_tilde.param("goal_keepalive", keepalive, 0.5);
+    goal_keepalive_ = ros::WallDuration(keepalive);
+
+    goal_deadbands_.assign(hand_joints::NB_JOINTS, deadband);
+    for (unsigned int i = 0; i < hand_joints::NB_JOINTS; ++i)
+    {
+      n_tilde.param(std::string("goal_deadbands/") + hand_joints::names[i], goal_deadbands_[i], deadband);
+      if( goal_deadbands_[i] > 0.0 )
+        deadband_enabled_ = true;
+    }
+
+    if( deadband_enabled_ )
+      ROS_INFO("Only sending the trajectories when a joint moves by more than its deadband (%.3frad by default), or every %.2fs",
+               deadband, keepalive);
+  }
+
+  bool CybergloveTrajectoryPublisher::trajectory_needed(Target& target, const std::vector<double>& positions)
+  {
+    if( !deadband_enabled_ )
+      return true;
+
+    ros::WallTime now = ros::WallTime::now();
+    bool needed = target.last_sent_positions.size() != positions.size() || now - target.last_sent_time > goal_keepalive_;
+    for (unsigned int i = 0; !needed && i < positions.size(); ++i)
+    {
+      if( fabs(positions[i] - target.last_sent_positions[i]) > goal_deadbands_[i] )
+        needed = true;
+    }
+
+    if( needed )
+    {
+      target.last_sent_positions.assign(positions.begin(), positions.end());
+      target.last_sent_time = now;
+    }
+    return needed;
+  }
+
+  double CybergloveTrajectoryPublisher::process_cpu_time()
+  {
+    struct rusage usage;
+    if( getrusage(RUSAGE_SELF, &usage) != 0 )
+      return 0.0;
+
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6
+      + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+  }
+
+  sr_remappers::ProfileBank::PipelinePtr CybergloveTrajectoryPublisher::load_profile(const std::string& param_prefix)
+  {
+    std::string param;
+    std::string path;
+    if( param_prefix.empty() )
+    {
+      n_tilde.searchParam("cyberglove_mapping_path", param);
+      n_tilde.param(param, path, std::string());
+    }
+    else if( !n_tilde.getParam(param_prefix + "cyberglove_mapping_path", path) )
+    {
+      ROS_ERROR("No %scyberglove_mapping_path parameter.", param_prefix.c_str());
+      return sr_remappers::ProfileBank::PipelinePtr();
+    }
+
+    //a profile without its own calibration uses the default one
+    std::string calibration = param_prefix + "cyberglove_calibration";
+    if( !n_tilde.hasParam(calibration) )
+      calibration = "cyberglove_calibration";
+
+    //the lookup tables are only rebuilt when the calibration changes if they are
+    // cached (e.g. next to the calibration yaml)
+    std::string calibration_cache;
+    n_tilde.param(param_prefix + "calibration_cache", calibration_cache, std::string());
+
+    sr_remappers::ProfileBank::PipelinePtr pipeline(new sr_remappers::GloveToHandPipeline(read_joint_calibration(calibration), path, calibration_cache));
+    pipeline->set_timing_hook(boost::bind(&CybergloveTrajectoryPublisher::stage_timed, this, _1, _2));
+    ROS_INFO("Mapping file loaded for the Cyberglove: %s", path.c_str());
+    return pipeline;
+  }
+
+  void CybergloveTrajectoryPublisher::stage_timed(sr_remappers::GloveToHandPipeline::stage finished_stage, double duration)
+  {
+    stage_times[finished_stage] += duration;
+    if( finished_stage == sr_remappers::GloveToHandPipeline::J0_SPLIT )
+      ++nb_timed_frames;
+  }
+
+std::vector<xml_calibration_parser::XmlCalibrationParser::JointCalibration> CybergloveTrajectoryPublisher::read_joint_calibration(const std::string& param)
+{
+  std::vector<xml_calibration_parser::XmlCalibrationParser::JointCalibration> joint_calibration;
+
+  //the node can't run without its calibration
+  if( !sr_remappers::GloveToHandPipeline::read_calibration(n_tilde, param, joint_calibration) )
+    ROS_BREAK();
+
   return joint_calibration;
 } //end read_joint_calibration
 
@@ -36,6 +36,12 @@ using namespace std;
 
 /**
 * This is where the calibration matrix is read from a file, stored and where the actual mapping take place.
+*
+* The matrix is stored contiguously, input-major: the contributions of an input
+* to all the outputs are next to each other, so the product is a sequence of
+* vectorizable "outputs += input * row". If the matrix is mostly zeros (as the
+* glove to hand mappings are), only its non zero values are kept (compressed
+* rows) and the product skips the zeros.
 */
 class CalibrationParser {
 public:
@@ -63,7 +69,42 @@ public:
   *
   * @return mapped vector
   */
-  std::vector<double> get_remapped_vector(std::vector<double>);
+  std::vector<double> get_remapped_vector(const std::vector<double>& input_vector) const;
+
+  /**
+  * multiplies the vector by the mapping matrix, without allocating
+  * anything once output is big enough.
+  *
+  * @param input_vector vector to be mapped (get_nb_inputs() values)
+  * @param output_vector where the mapped vector is written (resized to
+  *        get_nb_outputs() values)
+  */
+  void get_remapped_vector(const std::vector<double>& input_vector, std::vector<double>& output_vector) const;
+
+  /**
+  * maps several frames at once.
+  *
+  * @param input_vectors the frames to be mapped, one after the other
+  *        (nb_frames * get_nb_inputs() values)
+  * @param nb_frames the number of frames
+  * @param output_vectors where the mapped frames are written, one after the
+  *        other (resized to nb_frames * get_nb_outputs() values)
+  */
+  void get_remapped_vectors(const std::vector<double>& input_vectors, unsigned int nb_frames,
+                            std::vector<double>& output_vectors) const;
+
+  /// the size of the vectors to be mapped (the number of lines of the file)
+  unsigned int get_nb_inputs() const { return nb_inputs; };
+  /// the size of the mapped vectors (the number of columns of the file)
+  unsigned int get_nb_outputs() const { return nb_outputs; };
+  /// is the matrix stored as a sparse matrix?
+  bool is_sparse() const { return sparse; };
+
+  /**
+  * Below this ratio of non zero values, the matrix is stored as a sparse
+  * matrix.
+  */
+  static const double sparse_density;
 
 private:
   static const std::string default_path;
@@ -77,12 +118,38 @@ private:
   */
   int init(std::string path);
 
-  std::vector< std::vector<double> > calibration_matrix;
+  /**
+  * Stores the matrix read from the file, densely or sparsely.
+  *
+  * @param matrix the matrix, one vector per input
+  */
+  void set_matrix(const std::vector< std::vector<double> >& matrix);
+
+  /**
+  * multiplies one frame by the mapping matrix.
+  *
+  * @param input get_nb_inputs() values
+  * @param output where the get_nb_outputs() mapped values are written
+  */
+  void remap(const double* input, double* output) const;
+
+  unsigned int nb_inputs, nb_outputs;
+  bool sparse;
+
+  /// the dense matrix: the nb_outputs coefficients of each input, one input after the other
+  std::vector<double> dense_matrix;
+
+  /// the sparse matrix: the non zero coefficients, one input after the other...
+  std::vector<double> sparse_values;
+  /// ... the output each of them contributes to...
+  std::vector<unsigned int> sparse_outputs;
+  /// ... and where the coefficients of each input start (nb_inputs + 1 values)
+  std::vector<unsigned int> sparse_input_start;
 
   inline double convertToDouble(std::string const& s)
   {
     std::istringstream i(s);
-    double x;
+    double x = 0.0;
     if (!(i >> x))
       ROS_ERROR("Bad calibration file: %s", s.c_str());
     return x;
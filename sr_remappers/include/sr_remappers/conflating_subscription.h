@@ -0,0 +1,98 @@
+/**
+ * @file   conflating_subscription.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief The subscription settings of the remappers.
+ *
+ * When ~conflate is true, only the newest message is kept (queue of 1) and
+ * TCP_NODELAY is requested: if a callback stalls, the messages received
+ * meanwhile are dropped instead of being processed late, so the output
+ * lags by at most one frame. Otherwise the messages are queued as before.
+ *
+ * The messages skipped (conflated, or dropped from a full queue) are
+ * counted from the gaps in header.seq. This assumes a single publisher on
+ * the topic.
+ *
+ */
+
+#ifndef   	CONFLATING_SUBSCRIPTION_H_
+# define   	CONFLATING_SUBSCRIPTION_H_
+
+#include <ros/ros.h>
+#include <string>
+#include <boost/cstdint.hpp>
+
+namespace sr_remappers
+{
+  class ConflatingSubscription
+  {
+  public:
+    /**
+     * Reads ~conflate (false by default).
+     *
+     * @param n_tilde the private node handle of the node
+     * @param queue_size the queue size when not conflating
+     */
+    ConflatingSubscription(const ros::NodeHandle& n_tilde, uint32_t queue_size);
+
+    /**
+     * Subscribes to the topic with the queue size and transport hints of the mode.
+     */
+    template <class M, class T>
+    ros::Subscriber subscribe(ros::NodeHandle& node, const std::string& topic,
+                              void (T::*callback)(const boost::shared_ptr<M const>&), T* object)
+    {
+      ros::TransportHints hints;
+      if( conflate )
+        hints.tcpNoDelay();
+      return node.subscribe(topic, conflate ? 1 : queue_size, callback, object, hints);
+    }
+
+    /**
+     * Call it for each message processed: counts the messages skipped since
+     * the previous one.
+     *
+     * @param seq the header.seq of the message
+     *
+     * @return the number of messages skipped just before this one
+     */
+    uint32_t received(uint32_t seq);
+
+    /// the number of messages skipped since the subscription
+    boost::uint64_t get_nb_skipped() const { return nb_skipped; };
+
+    bool is_conflating() const { return conflate; };
+
+  private:
+    bool conflate;
+    uint32_t queue_size;
+
+    bool first_message;
+    uint32_t last_seq;
+    boost::uint64_t nb_skipped;
+  };
+}
+
+#endif 	    /* !CONFLATING_SUBSCRIPTION_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
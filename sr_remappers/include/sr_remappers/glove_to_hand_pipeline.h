@@ -0,0 +1,171 @@
+/**
+ * @file   glove_to_hand_pipeline.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Converts the glove frames to hand joint positions.
+ *
+ * The stages, run one after the other on buffers allocated once:
+ *   - calibration: the raw glove values are calibrated (optional, the
+ *     input can already be calibrated).
+ *   - mapping: the calibrated values are multiplied by the mapping matrix,
+ *     giving the mapped joints (see cyberglove::mapped_joints).
+ *   - abduction: the J4s are computed from the 3 abduction sensors,
+ *     overwriting the mapped ones.
+ *   - J0 split: the J0s are split in J1 and J2, giving the hand joints (see
+ *     cyberglove::hand_joints).
+ *
+ */
+
+#ifndef   	GLOVE_TO_HAND_PIPELINE_H_
+# define   	GLOVE_TO_HAND_PIPELINE_H_
+
+#include <ros/ros.h>
+#include <vector>
+#include <string>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <cyberglove/xml_calibration_parser.h>
+#include <cyberglove/glove_joints.h>
+#include "sr_remappers/calibration_parser.h"
+
+namespace sr_remappers
+{
+  class GloveToHandPipeline : boost::noncopyable
+  {
+  public:
+    enum stage
+    {
+      CALIBRATION,
+      MAPPING,
+      ABDUCTION,
+      J0_SPLIT,
+      NB_STAGES
+    };
+
+    static const char* const stage_names[NB_STAGES];
+
+    /**
+     * Called after each stage with its duration (in seconds), if set.
+     */
+    typedef boost::function<void (stage, double)> TimingHook;
+
+    /**
+     * A pipeline for already calibrated glove values (e.g. the calibrated
+     * joint_states of the cyberglove node).
+     *
+     * @param path_to_mapping the path to the mapping matrix
+     */
+    GloveToHandPipeline(const std::string& path_to_mapping);
+
+    /**
+     * A pipeline calibrating the raw glove values.
+     *
+     * @param calibration the calibration of each glove sensor
+     * @param path_to_mapping the path to the mapping matrix
+     * @param path_to_calibration_cache the cache of the calibration lookup
+     *        tables (see XmlCalibrationParser), empty for no cache
+     */
+    GloveToHandPipeline(const std::vector<xml_calibration_parser::XmlCalibrationParser::JointCalibration>& calibration,
+                        const std::string& path_to_mapping,
+                        const std::string& path_to_calibration_cache = "");
+
+    /**
+     * Runs all the stages on a raw glove frame. Only possible if the
+     * pipeline was built with a calibration.
+     *
+     * @param raw_positions the raw glove values (cyberglove::glove_sensors order)
+     *
+     * @return true if success
+     */
+    bool process(const std::vector<float>& raw_positions);
+
+    /**
+     * Runs all the stages but the calibration on a calibrated glove frame.
+     *
+     * @param calibrated_positions the calibrated glove values (cyberglove::glove_sensors order)
+     *
+     * @return true if success
+     */
+    bool process_calibrated(const std::vector<double>& calibrated_positions);
+
+    /// The calibrated glove values of the last raw frame processed (cyberglove::glove_sensors order).
+    const std::vector<double>& get_glove_positions() const { return glove_positions; };
+
+    /// The mapped joints computed by the last frame, J0s included (cyberglove::mapped_joints order).
+    const std::vector<double>& get_mapped_positions() const { return mapped_positions; };
+
+    /// The hand joints computed by the last frame, J0s split (cyberglove::hand_joints order).
+    const std::vector<double>& get_hand_positions() const { return hand_positions; };
+
+    void set_timing_hook(const TimingHook& hook);
+
+    /// false if the mapping couldn't be read, or isn't glove sensors x mapped joints.
+    bool is_valid() const;
+
+    /**
+     * Reads a calibration from the parameter server: a list of
+     * [sensor name, [[raw, calibrated (degrees)], ...]], as in the
+     * sr_cyberglove_config calibration files.
+     *
+     * @param nh the node handle the parameter is relative to
+     * @param param the parameter containing the calibration
+     * @param calibration where the calibration is written (calibrated values in radians)
+     *
+     * @return false if the parameter is missing or malformed
+     */
+    static bool read_calibration(const ros::NodeHandle& nh, const std::string& param,
+                                 std::vector<xml_calibration_parser::XmlCalibrationParser::JointCalibration>& calibration);
+
+  private:
+    void init(const std::string& path_to_mapping);
+
+    /**
+     * Computes the J4s from the abduction sensors. They're written on top of
+     * what the mapping matrix computed for them.
+     *
+     * @param glove the calibrated glove values
+     * @param mapped the mapped joints, only the J4s are written
+     */
+    static void compute_abductions(const std::vector<double>& glove, std::vector<double>& mapped);
+
+    /// calls the timing hook (if any) with the time elapsed since start, and restarts it.
+    void stage_done(stage finished_stage, ros::WallTime& start) const;
+
+    boost::scoped_ptr<xml_calibration_parser::XmlCalibrationParser> calibration_parser;
+    CalibrationParser mapping;
+
+    TimingHook timing_hook;
+
+    ///the buffers of the stages, allocated once
+    std::vector<float> calibrated_values;
+    std::vector<double> glove_positions;
+    std::vector<double> mapped_positions;
+    std::vector<double> hand_positions;
+  };
+}
+
+#endif 	    /* !GLOVE_TO_HAND_PIPELINE_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
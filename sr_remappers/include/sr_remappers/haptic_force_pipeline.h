@@ -0,0 +1,194 @@
+/**
+ * @file   haptic_force_pipeline.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Computes the cybergrasp forces from the hand data, at the fixed
+ * rate of the haptic loop.
+ *
+ * The hand data (efforts or tactile pressures) are added as they arrive.
+ * At each tick of the loop:
+ *   - coalescing: the inputs received since the previous tick are averaged
+ *     (or only the latest is used).
+ *   - mapping: the input is multiplied by the calibration matrix, giving
+ *     the force of each finger (its absolute value).
+ *   - ramp: if the inputs are slower than the loop, the forces ramp
+ *     linearly to the new input over one input period, otherwise they jump
+ *     to it.
+ *   - timeout: the forces are released if no input arrived for too long
+ *     (input_timeout, or a few input periods for the slow inputs).
+ *   - deadband, low-pass and saturation: the small forces are ignored (the
+ *     deadband is subtracted from the others), the forces are smoothed by a
+ *     first order filter at the loop's rate, and saturated.
+ *
+ * The times are passed by the caller (s, on any monotonic clock): the
+ * pipeline doesn't depend on the ROS clock, nor on the cybergrasp messages.
+ *
+ */
+
+#ifndef   	HAPTIC_FORCE_PIPELINE_H_
+# define   	HAPTIC_FORCE_PIPELINE_H_
+
+#include <ros/ros.h>
+#include <vector>
+#include <string>
+#include <boost/thread/mutex.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "sr_remappers/calibration_parser.h"
+
+namespace sr_remappers
+{
+  class HapticForcePipeline : boost::noncopyable
+  {
+  public:
+    /// The number of fingers of the cybergrasp.
+    static const unsigned int nb_fingers = 5;
+
+    /// How the forces are processed (the defaults of the remapper's parameters).
+    struct Settings
+    {
+      /// the frequency of the haptic loop (Hz)
+      double rate;
+      /// forces below this are ignored (the deadband is subtracted from the ones above)
+      double deadband;
+      /// the time constant of the smoothing (s), 0 for no smoothing
+      double time_constant;
+      /// the forces are saturated to this
+      double max_force;
+      /// the forces are released if no input was received for this long (s)...
+      double input_timeout;
+      /// ...or for this many input periods, if that's longer (the inputs slower than the timeout)
+      double timeout_periods;
+      /// average the inputs received between two ticks (or only use the latest)
+      bool averaging;
+      /// ramp between the inputs if they're slower than the loop
+      bool interpolating;
+
+      Settings();
+    };
+
+    /**
+     * @param path_to_calibration the mapping from the hand data to the finger
+     *        forces (get_nb_outputs() should be nb_fingers)
+     * @param settings how the forces are processed
+     */
+    HapticForcePipeline(const std::string& path_to_calibration, const Settings& settings);
+
+    /**
+     * Adds an input for the next tick. Called from the subscriber's thread.
+     *
+     * @param values the hand data (efforts, pressures...)
+     * @param time when it was received (s)
+     *
+     * @return false if the input doesn't have the size the calibration
+     *         expects (it's then ignored)
+     */
+    template <class T>
+    bool add_input(const std::vector<T>& values, double time)
+    {
+      if( values.size() != calibration.get_nb_inputs() )
+        return false;
+
+      boost::mutex::scoped_lock lock(input_mutex);
+      if( input_received )
+      {
+        //the input period, smoothed over ~10 inputs
+        double period = time - latest_input_time;
+        input_period = input_period > 0.0 ? 0.9 * input_period + 0.1 * period : period;
+      }
+
+      for( unsigned int i = 0; i < values.size(); ++i )
+      {
+        latest_input[i] = values[i];
+        input_sum[i] += values[i];
+      }
+      ++nb_pending;
+
+      latest_input_time = time;
+      input_received = true;
+      return true;
+    }
+
+    /**
+     * One tick of the haptic loop: computes the forces from the inputs
+     * received since the previous tick.
+     *
+     * @param time the time of the tick (s)
+     *
+     * @return false if no input was received yet (there are no forces)
+     */
+    bool tick(double time);
+
+    /// the forces of the last tick (nb_fingers values)
+    const double* get_forces() const { return forces; };
+
+    /// the number of inputs coalesced at the last tick
+    unsigned int get_depth() const { return depth; };
+
+    /// the time from the latest input to the last tick (s)
+    double get_input_age() const { return input_age; };
+
+    /// were the forces released at the last tick, for lack of input?
+    bool timed_out() const { return timeout; };
+
+    /// the time between two inputs (s), smoothed
+    double get_input_period();
+
+    const CalibrationParser& get_calibration() const { return calibration; };
+
+  private:
+    CalibrationParser calibration;
+    Settings settings;
+    /// the smoothing factor of the low-pass filter, at the loop's rate
+    double alpha;
+
+    /// protects the inputs, added by the subscriber and read by the haptic loop
+    boost::mutex input_mutex;
+    /// the latest input, and the sum of the inputs received since the last tick
+    std::vector<double> latest_input, input_sum;
+    double latest_input_time;
+    bool input_received;
+    /// the number of inputs received since the last tick
+    unsigned int nb_pending;
+    double input_period;
+
+    /// the coalesced input and its mapping
+    std::vector<double> input, mapped_forces;
+    /// the force each finger is ramping to, from ramp_start, since ramp_start_time
+    double ramp_start[nb_fingers], ramp_end[nb_fingers];
+    double ramp_start_time;
+    /// the ramped forces, before the deadband and smoothing
+    double targets[nb_fingers];
+    /// the smoothed forces
+    double forces[nb_fingers];
+
+    /// what the last tick did
+    unsigned int depth;
+    double input_age;
+    bool timeout;
+  };
+}
+
+#endif 	    /* !HAPTIC_FORCE_PIPELINE_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
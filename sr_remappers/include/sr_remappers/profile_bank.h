@@ -0,0 +1,136 @@
+/**
+ * @file   profile_bank.h
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief The mapping / calibration profiles, all loaded at startup, one of
+ * them being active.
+ *
+ * Each profile is a GloveToHandPipeline. The default profile is built from
+ * the node's parameters (e.g. ~cyberglove_mapping_path), the others from
+ * the parameters in their namespace, the profiles being listed in
+ * ~profiles:
+ *
+ *   <rosparam param="profiles">[operator_a, transposed]</rosparam>
+ *   <param name="operator_a/cyberglove_mapping_path" value="..."/>
+ *   <param name="transposed/cyberglove_mapping_path" value="..."/>
+ *
+ * The active profile is selected with the ~select_profile service: the
+ * frame being processed finishes with the previous profile, the next one
+ * uses the new one. Nothing is parsed when switching.
+ *
+ */
+
+#ifndef   	PROFILE_BANK_H_
+# define   	PROFILE_BANK_H_
+
+#include <ros/ros.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <cyberglove/SelectProfile.h>
+#include "sr_remappers/glove_to_hand_pipeline.h"
+
+namespace sr_remappers
+{
+  class ProfileBank : boost::noncopyable
+  {
+  public:
+    typedef boost::shared_ptr<GloveToHandPipeline> PipelinePtr;
+
+    /**
+     * Builds the pipeline of a profile.
+     *
+     * @param param_prefix the prefix of the profile's parameters ("" for the
+     *        default profile, "<name>/" for the others)
+     *
+     * @return the pipeline, empty if the profile can't be loaded
+     */
+    typedef boost::function<PipelinePtr (const std::string&)> PipelineFactory;
+
+    static const std::string default_profile;
+
+    ProfileBank() {};
+
+    /**
+     * Loads the default profile and the ones listed in ~profiles. The active
+     * profile is ~active_profile if set, the default one otherwise.
+     *
+     * @param n_tilde the private node handle of the node
+     * @param factory builds the pipeline of each profile
+     *
+     * @return the number of profiles which couldn't be loaded
+     */
+    int load(const ros::NodeHandle& n_tilde, const PipelineFactory& factory);
+
+    /**
+     * Adds a profile. The first profile added becomes the active one.
+     *
+     * @return false if a profile with this name already exists
+     */
+    bool add(const std::string& name, const PipelinePtr& pipeline);
+
+    /**
+     * Selects the active profile.
+     *
+     * @return false if there is no such profile (the active one is kept)
+     */
+    bool select(const std::string& name);
+
+    /**
+     * The pipeline of the active profile. Called for each frame: keep the
+     * returned pointer for the whole frame, the profile may be switched
+     * meanwhile.
+     */
+    PipelinePtr active() const;
+
+    std::string active_name() const;
+
+    /// the names of all the profiles
+    std::vector<std::string> names() const;
+
+    /**
+     * Serves the SelectProfile service.
+     */
+    bool select_profile(cyberglove::SelectProfile::Request &req, cyberglove::SelectProfile::Response &res);
+
+  private:
+    typedef std::map<std::string, PipelinePtr> ProfileMap;
+
+    /// all the profiles, only modified at startup
+    ProfileMap profiles;
+
+    /// protects the active profile, swapped between frames
+    mutable boost::mutex active_mutex;
+    PipelinePtr active_pipeline;
+    std::string active_profile;
+  };
+}
+
+#endif 	    /* !PROFILE_BANK_H_ */
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
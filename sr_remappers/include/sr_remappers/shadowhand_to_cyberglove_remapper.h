@@ -31,12 +31,35 @@
 
 //messages
 #include <sensor_msgs/JointState.h>
-#include "sr_remappers/calibration_parser.h"
+#include <cyberglove/GloveFrame.h>
+#include <cyberglove/sequence_tracker.h>
+#include "sr_remappers/profile_bank.h"
+#include "sr_remappers/conflating_subscription.h"
+#include <cyberglove/glove_joints.h>
+#include <cyberglove/message_pool.h>
+#include <sr_robot_msgs/sendupdate.h>
+#include <std_msgs/Float64MultiArray.h>
+#include <trajectory_msgs/JointTrajectory.h>
+#include <boost/scoped_ptr.hpp>
 
 using namespace ros;
 
 namespace shadowhand_to_cyberglove_remapper{
 
+namespace output_modes
+{
+  /// What the remapper publishes (~output_mode).
+  enum output_mode
+  {
+    /// sr_robot_msgs/sendupdate: the J0s with their names (default)
+    SENDUPDATE,
+    /// std_msgs/Float64MultiArray: the hand joints, in the order published once on ~joint_names
+    ARRAY,
+    /// trajectory_msgs/JointTrajectory: the hand joints, in a single point
+    TRAJECTORY
+  };
+}
+
 /**
  * This program remaps the force information contained in
  * /joint_states coming from the hand to the /cybergraspforces topic
@@ -49,7 +72,40 @@ class ShadowhandToCybergloveRemapper
    * Init the publisher / subscriber, the joint names, read the calibratin matrix
    */
   ShadowhandToCybergloveRemapper();
-  ~ShadowhandToCybergloveRemapper(){};
+  ~ShadowhandToCybergloveRemapper();
+
+  /**
+   * The processing of a frame: maps the calibrated glove positions and
+   * fills a message of the pool with the result. Once the pool is full,
+   * nothing is allocated.
+   *
+   * @param pipeline the mapping of the active profile
+   * @param pool the messages of the output mode
+   * @param glove_positions the calibrated glove values
+   *
+   * @return the message to publish, empty if the mapping rejected the frame
+   */
+  template <class M>
+  static typename cyberglove::MessagePool<M>::MessagePtr remap_frame(sr_remappers::GloveToHandPipeline& pipeline,
+                                                                     cyberglove::MessagePool<M>& pool,
+                                                                     const std::vector<double>& glove_positions)
+  {
+    if( !pipeline.process_calibrated(glove_positions) )
+      return typename cyberglove::MessagePool<M>::MessagePtr();
+
+    //only the positions change in the preallocated message
+    typename cyberglove::MessagePool<M>::MessagePtr msg = pool.get();
+    fill(pipeline, *msg);
+    return msg;
+  }
+
+  /// Writes the mapped joints (J0s included) in the targets of a sendupdate prototype.
+  static void fill(const sr_remappers::GloveToHandPipeline& pipeline, sr_robot_msgs::sendupdate& msg);
+  /// Writes the hand joints (J0s split) in the data of an array prototype.
+  static void fill(const sr_remappers::GloveToHandPipeline& pipeline, std_msgs::Float64MultiArray& msg);
+  /// Writes the hand joints (J0s split) in the single point of a trajectory prototype.
+  static void fill(const sr_remappers::GloveToHandPipeline& pipeline, trajectory_msgs::JointTrajectory& msg);
+
  private:
   /**
    * Number of joints in the hand
@@ -65,12 +121,46 @@ class ShadowhandToCybergloveRemapper
   NodeHandle node, n_tilde;
   /// Vector containing all the joints names for the shadowhand.
   std::vector<std::string> joints_names;
-  /// subscriber to the jointstates topic from the cyberglove
+  /// the queue settings of the subscription (~conflate), and the messages skipped
+  sr_remappers::ConflatingSubscription cyberglove_input;
+  /// subscribe to the calibrated frames of the cyberglove, with their frame number (~use_frames), or to its joint_states
+  bool use_frames;
+  /// subscriber to the calibrated joint_states (or frames) of the cyberglove
   Subscriber cyberglove_jointstates_sub;
-  ///publish to the shadowhand sendupdate topic
+  /// the frame numbers received (with ~use_frames): the gaps are the frames lost before the remapper
+  cyberglove::SequenceTracker input_frames;
+  /// the frames the mapping couldn't process
+  unsigned long nb_rejected_frames;
+  ///publish to the shadowhand sendupdate topic (or the command topic, see output_mode)
   Publisher shadowhand_pub;
-  ///the calibration parser containing the mapping matrix
-  CalibrationParser* calibration_parser;
+  ///the order of the joints in the array output (latched)
+  Publisher joint_names_pub;
+  ///the positions published, with the number of the glove frame they were mapped from (~frames)
+  Publisher frames_pub;
+  cyberglove::GloveFrame output_frame;
+  output_modes::output_mode output_mode;
+  ///the messages, allocated with their joint names once and for all (only the pool of output_mode is used)
+  boost::scoped_ptr<cyberglove::MessagePool<sr_robot_msgs::sendupdate> > sendupdate_pool;
+  boost::scoped_ptr<cyberglove::MessagePool<std_msgs::Float64MultiArray> > array_pool;
+  boost::scoped_ptr<cyberglove::MessagePool<trajectory_msgs::JointTrajectory> > trajectory_pool;
+
+  /**
+   * Reads ~output_mode and advertises the output topic accordingly.
+   */
+  void init_output();
+  ///the mapping profiles, each mapping the glove to the hand (mapping matrix and J4s)
+  sr_remappers::ProfileBank profiles;
+  ///selects the active mapping profile
+  ServiceServer select_profile_server;
+
+  /**
+   * Loads the mapping of a profile (see ProfileBank::PipelineFactory).
+   *
+   * @param param_prefix "" for the default profile, "<name>/" for the others
+   *
+   * @return the pipeline of the profile, empty if it has no mapping
+   */
+  sr_remappers::ProfileBank::PipelinePtr load_profile(const std::string& param_prefix);
 
   /////////////////
   //  CALLBACKS  //
@@ -80,18 +170,32 @@ class ShadowhandToCybergloveRemapper
    * process the joint_states callback: receives the message from the cyberglove node, remap it to the Dextrous hand and
    * publish this message on a given topic
    *
-   * @param msg the joint_states message
+   * @param msg the calibrated joint_states of the glove
    */
   void jointstatesCallback(const sensor_msgs::JointStateConstPtr& msg);
 
   /**
-   * process the joint_states callback for the finger abductions: processes the message from the cyberglove node, remap it to the Dextrous hand J4s
-   * It overwrites whatever was written for the J4s by the calibration parser get_remapped_vector
+   * process the frames callback (~use_frames): as jointstatesCallback, also
+   * tracking the frame numbers.
+   *
+   * @param msg the calibrated glove frame
+   */
+  void framesCallback(const cyberglove::GloveFrameConstPtr& msg);
+
+  /**
+   * Remaps the calibrated glove positions to the hand and publishes them.
    *
-   * @param msg the joint_states message
-   * @param vect the vector where the result is written (only J4s are written)
+   * @param glove_positions the calibrated glove values
+   * @param stamp the stamp of the glove message
+   * @param frame_number the number of the glove frame (0 if unknown)
+   */
+  void remap(const std::vector<double>& glove_positions, const ros::Time& stamp, uint32_t frame_number);
+
+  /**
+   * Publishes the positions sent to the hand on ~frames, with the glove's
+   * frame number, if it's subscribed (only with ~use_frames).
    */
-  void getAbductionJoints( const sensor_msgs::JointStateConstPtr& msg, std::vector<double>& vect);
+  void publish_frame(const ros::Time& stamp, uint32_t frame_number, const std::vector<double>& positions);
 
 }; // end class
 
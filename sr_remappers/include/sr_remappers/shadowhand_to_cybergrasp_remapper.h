@@ -23,17 +23,29 @@
  * /joint_states coming from the hand to the /cybergraspforces topic
  * used to control the cybergrasp.
  *
+ * The forces are computed in a haptic loop running at a fixed rate
+ * (~haptic_rate): the effort (or tactile) data received between two ticks
+ * are coalesced, mapped to the 5 fingers, interpolated if the data are
+ * slower than the loop, then go through a deadband, smoothing and
+ * saturation.
  *
  */
 
 #ifndef   	SHADOWHAND_TO_CYBERGRASP_REMAPPER_H_
 # define   	SHADOWHAND_TO_CYBERGRASP_REMAPPER_H_
 
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+
 //messages
 #include <sensor_msgs/JointState.h>
+#include <sr_robot_msgs/ShadowPST.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <cybergrasp/cybergraspforces.h>
 
-#include "sr_remappers/calibration_parser.h"
+#include <cyberglove/publish_scheduler.h>
+#include "sr_remappers/haptic_force_pipeline.h"
+#include "sr_remappers/conflating_subscription.h"
 
 using namespace ros;
 
@@ -49,7 +61,8 @@ class ShadowhandToCybergraspRemapper
 {
  public:
   /**
-   * Init the publisher / subscriber, the joint names, read the calibratin matrix
+   * Init the publisher / subscriber, read the calibration matrix and start
+   * the haptic loop.
    */
   ShadowhandToCybergraspRemapper();
   ~ShadowhandToCybergraspRemapper();
@@ -58,25 +71,69 @@ class ShadowhandToCybergraspRemapper
   /// ROS node handles
   NodeHandle node, n_tilde;
 
-  ///subscribe to the shadowhand sendupdate topic
+  /// the queue settings of the subscription (~conflate), and the messages skipped
+  sr_remappers::ConflatingSubscription jointstates_input;
+  ///subscribe to the shadowhand joint_states (or tactile) topic
   Subscriber shadowhand_jointstates_sub;
   ///publish to the cybergrasp /cybergraspforces topic
   Publisher shadowhand_cybergrasp_pub;
-  ///the calibration parser containing the mapping matrix
-  CalibrationParser* calibration_parser;
+  Publisher diagnostics_pub;
+  ///the processing of the forces: coalescing, mapping, ramp, deadband, smoothing...
+  boost::scoped_ptr<sr_remappers::HapticForcePipeline> pipeline;
+
+  /// the frequency of the haptic loop (Hz)
+  double publish_rate;
+
+  /// Clocks the haptic loop and the diagnostics.
+  cyberglove::PublishScheduler scheduler;
+
+  /// was an input of the wrong size reported already?
+  bool input_size_error;
+
+  /// the latency metrics since the last diagnostics: from the reception of
+  /// the data to the forces being sent, and the time spent computing them
+  double latency_sum, latency_max, compute_sum, compute_max;
+  unsigned int nb_latencies, nb_ticks, nb_timeouts;
+  /// the number of inputs coalesced at each tick
+  unsigned int depth_sum, depth_max;
 
   /////////////////
   //  CALLBACKS  //
   /////////////////
 
   /**
-   * process the joint_states callback: receives the message from the shadowhand node, remap it to the Cybergrasp and
-   * publish this message on a given topic
+   * process the joint_states callback: stores the efforts for the haptic loop.
    *
    * @param msg the joint_states message
    */
   void jointstatesCallback(const sensor_msgs::JointStateConstPtr& msg);
 
+  /**
+   * process the tactile callback: stores the pressures for the haptic loop.
+   *
+   * @param msg the tactile message
+   */
+  void tactileCallback(const sr_robot_msgs::ShadowPSTConstPtr& msg);
+
+  /// adds the input values to the pipeline
+  template <class T>
+  void store_input(const std::vector<T>& values);
+
+  /**
+   * One iteration of the haptic loop: computes the forces from the latest
+   * input and sends them to the cybergrasp. Called by the scheduler.
+   *
+   * @return true if the forces were sent, false if nothing was received yet
+   */
+  bool haptic_loop();
+
+  /**
+   * Publishes the loop rates and latencies. Called by the scheduler.
+   *
+   * @return true
+   */
+  bool publish_diagnostics();
+
 }; // end class
 
 } //end namespace
@@ -31,27 +31,31 @@
 #include <boost/algorithm/string/find_iterator.hpp>
 #include "sr_remappers/calibration_parser.h"
 #include <sstream>
+#include <algorithm>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
 const std::string CalibrationParser::default_path = "/etc/robot/mappings/default_mapping";
+const double CalibrationParser::sparse_density = 0.25;
 
 CalibrationParser::CalibrationParser()
+  : nb_inputs(0), nb_outputs(0), sparse(false)
 {
     ROS_WARN("No calibration path was specified, using default path");
     init(default_path);
 }
 
 CalibrationParser::CalibrationParser( std::string path )
+  : nb_inputs(0), nb_outputs(0), sparse(false)
 {
     init(path);
 }
 
 int CalibrationParser::init( std::string path )
 {
-    //reserve enough lines
-    calibration_matrix.reserve(25);
-
     ifstream calibration_file;
     calibration_file.open(path.c_str());
 
@@ -63,7 +67,9 @@ int CalibrationParser::init( std::string path )
     }
 
     //we read the file and put all the data in this matrix
-    std::vector<std::vector<double> > tmp_matrix;
+    std::vector<std::vector<double> > calibration_matrix;
+    //reserve enough lines
+    calibration_matrix.reserve(25);
 
     string line;
     while( !calibration_file.eof() )
@@ -82,7 +88,7 @@ int CalibrationParser::init( std::string path )
             continue;
 
         std::vector<std::string> splitted_string;
-        boost::split(splitted_string, line, boost::is_any_of("\t "));
+        boost::split(splitted_string, line, boost::is_any_of("\t "), boost::token_compress_on);
 
         std::vector<double> double_line(splitted_string.size());
         for( unsigned int index_col = 0; index_col < splitted_string.size(); ++index_col )
@@ -104,33 +110,136 @@ int CalibrationParser::init( std::string path )
     }
 
     ROS_DEBUG("%s",ss.str().c_str());
+
+    set_matrix(calibration_matrix);
     return 0;
 }
 
-std::vector<double> CalibrationParser::get_remapped_vector( std::vector<double> input_vector )
+void CalibrationParser::set_matrix(const std::vector< std::vector<double> >& matrix)
+{
+    nb_inputs = matrix.size();
+    nb_outputs = matrix.empty() ? 0 : matrix[0].size();
+
+    unsigned int nb_non_zeros = 0;
+    for( unsigned int input = 0; input < nb_inputs; ++input )
+    {
+        if( matrix[input].size() != nb_outputs )
+            ROS_ERROR("Bad calibration file: line %u has %u values instead of %u",
+                      input, (unsigned int)matrix[input].size(), nb_outputs);
+        for( unsigned int output = 0; output < nb_outputs && output < matrix[input].size(); ++output )
+            if( matrix[input][output] != 0.0 )
+                ++nb_non_zeros;
+    }
+
+    sparse = nb_non_zeros < sparse_density * nb_inputs * nb_outputs;
+
+    dense_matrix.clear();
+    sparse_values.clear();
+    sparse_outputs.clear();
+    sparse_input_start.clear();
+
+    for( unsigned int input = 0; input < nb_inputs; ++input )
+    {
+        if( sparse )
+            sparse_input_start.push_back(sparse_values.size());
+
+        for( unsigned int output = 0; output < nb_outputs; ++output )
+        {
+            double value = output < matrix[input].size() ? matrix[input][output] : 0.0;
+            if( !sparse )
+                dense_matrix.push_back(value);
+            else if( value != 0.0 )
+            {
+                sparse_values.push_back(value);
+                sparse_outputs.push_back(output);
+            }
+        }
+    }
+    if( sparse )
+        sparse_input_start.push_back(sparse_values.size());
+
+    ROS_DEBUG("Mapping matrix %ux%u with %u non zero values: stored as a %s matrix",
+              nb_inputs, nb_outputs, nb_non_zeros, sparse ? "sparse" : "dense");
+}
+
+void CalibrationParser::remap(const double* input, double* output) const
+{
+    for( unsigned int index = 0; index < nb_outputs; ++index )
+        output[index] = 0.0;
+
+    if( sparse )
+    {
+        for( unsigned int index_vec = 0; index_vec < nb_inputs; ++index_vec )
+        {
+            double value = input[index_vec];
+            for( unsigned int k = sparse_input_start[index_vec]; k < sparse_input_start[index_vec + 1]; ++k )
+                output[sparse_outputs[k]] += value * sparse_values[k];
+        }
+        return;
+    }
+
+    //outputs += input * row, one input after the other (same order of the
+    // sums as the column by column product)
+    const double* row = nb_outputs ? &dense_matrix[0] : NULL;
+    for( unsigned int index_vec = 0; index_vec < nb_inputs; ++index_vec, row += nb_outputs )
+    {
+        double value = input[index_vec];
+        unsigned int col = 0;
+#ifdef __AVX__
+        __m256d broadcast = _mm256_set1_pd(value);
+        for( ; col + 4 <= nb_outputs; col += 4 )
+            _mm256_storeu_pd(output + col, _mm256_add_pd(_mm256_loadu_pd(output + col),
+                                                         _mm256_mul_pd(broadcast, _mm256_loadu_pd(row + col))));
+#endif
+        for( ; col < nb_outputs; ++col )
+            output[col] += value * row[col];
+    }
+}
+
+
+std::vector<double> CalibrationParser::get_remapped_vector( const std::vector<double>& input_vector ) const
 {
+    std::vector<double> result;
+    get_remapped_vector(input_vector, result);
+    return result;
+}
+
+void CalibrationParser::get_remapped_vector( const std::vector<double>& input_vector,
+                                             std::vector<double>& output_vector ) const
+{
+    output_vector.resize(nb_outputs);
+
     //check the size of the matrix
-    if( input_vector.size() != calibration_matrix.size() )
+    if( input_vector.size() != nb_inputs )
     {
       ROS_ERROR_STREAM("The size of the given vector doesn't correspond to the mapping: received "
                        << input_vector.size()
                        << ", wanted "
-                       << calibration_matrix.size());
-        return std::vector<double>(calibration_matrix[0].size());
+                       << nb_inputs);
+      std::fill(output_vector.begin(), output_vector.end(), 0.0);
+      return;
     }
 
-    std::vector<double> result(calibration_matrix[0].size());
-    double tmp_value;
+    if( nb_outputs )
+      remap(&input_vector[0], &output_vector[0]);
+}
+
+void CalibrationParser::get_remapped_vectors( const std::vector<double>& input_vectors, unsigned int nb_frames,
+                                              std::vector<double>& output_vectors ) const
+{
+    output_vectors.resize(nb_frames * nb_outputs);
 
-    for( unsigned int col = 0; col < calibration_matrix[0].size(); ++col )
+    //check the size of the matrix
+    if( input_vectors.size() != nb_frames * nb_inputs )
     {
-        tmp_value = 0.0;
-        for( unsigned int index_vec = 0; index_vec < calibration_matrix.size(); ++index_vec )
-        {
-            tmp_value += (input_vector[index_vec] * calibration_matrix[index_vec][col]);
-        }
-        result[col] = tmp_value;
+      ROS_ERROR_STREAM("The size of the given vectors doesn't correspond to the mapping: received "
+                       << input_vectors.size()
+                       << ", wanted "
+                       << nb_frames * nb_inputs);
+      std::fill(output_vectors.begin(), output_vectors.end(), 0.0);
+      return;
     }
 
-    return result;
+    for( unsigned int frame = 0; frame < nb_frames && nb_outputs; ++frame )
+      remap(&input_vectors[frame * nb_inputs], &output_vectors[frame * nb_outputs]);
 }
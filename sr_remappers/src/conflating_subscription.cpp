@@ -0,0 +1,61 @@
+/**
+ * @file   conflating_subscription.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief The subscription settings of the remappers.
+ *
+ */
+
+#include "sr_remappers/conflating_subscription.h"
+
+namespace sr_remappers
+{
+  ConflatingSubscription::ConflatingSubscription(const ros::NodeHandle& n_tilde, uint32_t queue_size)
+    : conflate(false), queue_size(queue_size), first_message(true), last_seq(0), nb_skipped(0)
+  {
+    n_tilde.param("conflate", conflate, false);
+    if( conflate )
+      ROS_INFO("Conflating the input: only the newest message is processed");
+  }
+
+  uint32_t ConflatingSubscription::received(uint32_t seq)
+  {
+    uint32_t skipped = 0;
+
+    //the first message, or the publisher restarted: nothing to compare to
+    if( !first_message && seq > last_seq )
+      skipped = seq - last_seq - 1;
+
+    first_message = false;
+    last_seq = seq;
+
+    if( skipped > 0 )
+    {
+      nb_skipped += skipped;
+      ROS_DEBUG("%u messages skipped (%lu in total)", skipped, (unsigned long)nb_skipped);
+    }
+    return skipped;
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
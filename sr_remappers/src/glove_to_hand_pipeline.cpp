@@ -0,0 +1,263 @@
+/**
+ * @file   glove_to_hand_pipeline.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Converts the glove frames to hand joint positions.
+ *
+ */
+
+#include "sr_remappers/glove_to_hand_pipeline.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace sr_remappers
+{
+  const char* const GloveToHandPipeline::stage_names[NB_STAGES] = {
+    "calibration",
+    "mapping",
+    "abduction",
+    "J0 split"
+  };
+
+  GloveToHandPipeline::GloveToHandPipeline(const std::string& path_to_mapping)
+    : mapping(path_to_mapping)
+  {
+    init(path_to_mapping);
+  }
+
+  GloveToHandPipeline::GloveToHandPipeline(const std::vector<xml_calibration_parser::XmlCalibrationParser::JointCalibration>& calibration,
+                                           const std::string& path_to_mapping,
+                                           const std::string& path_to_calibration_cache)
+    : calibration_parser(new xml_calibration_parser::XmlCalibrationParser(calibration, path_to_calibration_cache)),
+      mapping(path_to_mapping)
+  {
+    int missing = calibration_parser->set_channels(std::vector<std::string>(cyberglove::glove_sensors::names,
+                                                                             cyberglove::glove_sensors::names + cyberglove::glove_sensors::NB_SENSORS));
+    if( missing > 0 )
+      ROS_WARN("%d glove sensors aren't calibrated.", missing);
+
+    init(path_to_mapping);
+  }
+
+  void GloveToHandPipeline::init(const std::string& path_to_mapping)
+  {
+    if( !is_valid() )
+      ROS_ERROR("The mapping %s is %ux%u, it should be %dx%d (glove sensors x mapped joints).", path_to_mapping.c_str(),
+                mapping.get_nb_inputs(), mapping.get_nb_outputs(),
+                cyberglove::glove_sensors::NB_SENSORS, cyberglove::mapped_joints::NB_JOINTS);
+
+    //all the buffers are allocated once and for all
+    calibrated_values.resize(cyberglove::glove_sensors::NB_SENSORS);
+    glove_positions.resize(cyberglove::glove_sensors::NB_SENSORS);
+    mapped_positions.resize(cyberglove::mapped_joints::NB_JOINTS);
+    hand_positions.resize(cyberglove::hand_joints::NB_JOINTS);
+  }
+
+  void GloveToHandPipeline::set_timing_hook(const TimingHook& hook)
+  {
+    timing_hook = hook;
+  }
+
+  bool GloveToHandPipeline::is_valid() const
+  {
+    return mapping.get_nb_inputs() == cyberglove::glove_sensors::NB_SENSORS &&
+      mapping.get_nb_outputs() == cyberglove::mapped_joints::NB_JOINTS;
+  }
+
+  bool GloveToHandPipeline::read_calibration(const ros::NodeHandle& nh, const std::string& param,
+                                             std::vector<xml_calibration_parser::XmlCalibrationParser::JointCalibration>& calibration)
+  {
+    calibration.clear();
+
+    XmlRpc::XmlRpcValue calib;
+    if( !nh.getParam(param, calib) || calib.getType() != XmlRpc::XmlRpcValue::TypeArray )
+    {
+      ROS_ERROR("No calibration in %s.", param.c_str());
+      return false;
+    }
+
+    //iterate on all the joints
+    for (int32_t index_cal = 0; index_cal < calib.size(); ++index_cal)
+    {
+      //check the calibration is well formatted:
+      // first joint name, then calibration table
+      if( calib[index_cal].getType() != XmlRpc::XmlRpcValue::TypeArray || calib[index_cal].size() != 2 ||
+          calib[index_cal][0].getType() != XmlRpc::XmlRpcValue::TypeString ||
+          calib[index_cal][1].getType() != XmlRpc::XmlRpcValue::TypeArray )
+      {
+        ROS_ERROR("The calibration %s should be a list of [sensor name, calibration table].", param.c_str());
+        return false;
+      }
+
+      xml_calibration_parser::XmlCalibrationParser::JointCalibration joint_calibration;
+      joint_calibration.name = static_cast<std::string>(calib[index_cal][0]);
+
+      //now iterates on the calibration table for the current joint
+      XmlRpc::XmlRpcValue& table = calib[index_cal][1];
+      for (int32_t index_table = 0; index_table < table.size(); ++index_table)
+      {
+        //only 2 values per calibration point: raw and calibrated (doubles)
+        if( table[index_table].getType() != XmlRpc::XmlRpcValue::TypeArray || table[index_table].size() != 2 ||
+            table[index_table][0].getType() != XmlRpc::XmlRpcValue::TypeDouble ||
+            table[index_table][1].getType() != XmlRpc::XmlRpcValue::TypeDouble )
+        {
+          ROS_ERROR("The calibration of %s in %s should be a list of [raw, calibrated] doubles.",
+                    joint_calibration.name.c_str(), param.c_str());
+          return false;
+        }
+
+        xml_calibration_parser::XmlCalibrationParser::Calibration point;
+        point.raw_value = static_cast<double>(table[index_table][0]);
+        point.calibrated_value = static_cast<double>(table[index_table][1]) * M_PI / 180.0;
+        joint_calibration.calibrations.push_back(point);
+      }
+
+      calibration.push_back(joint_calibration);
+    }
+
+    return true;
+  }
+
+  bool GloveToHandPipeline::process(const std::vector<float>& raw_positions)
+  {
+    if( !calibration_parser )
+    {
+      ROS_ERROR("This pipeline has no calibration: it can only process calibrated frames.");
+      return false;
+    }
+    if( raw_positions.size() < cyberglove::glove_sensors::NB_SENSORS )
+    {
+      ROS_ERROR("Received %u glove values, expected %d.", (unsigned int)raw_positions.size(),
+                cyberglove::glove_sensors::NB_SENSORS);
+      return false;
+    }
+
+    ros::WallTime start;
+    if( timing_hook )
+      start = ros::WallTime::now();
+
+    calibration_parser->calibrate(raw_positions, calibrated_values);
+    std::copy(calibrated_values.begin(), calibrated_values.end(), glove_positions.begin());
+    stage_done(CALIBRATION, start);
+
+    return process_calibrated(glove_positions);
+  }
+
+  bool GloveToHandPipeline::process_calibrated(const std::vector<double>& calibrated_positions)
+  {
+    if( calibrated_positions.size() < cyberglove::glove_sensors::NB_SENSORS )
+    {
+      ROS_ERROR("Received %u glove values, expected %d.", (unsigned int)calibrated_positions.size(),
+                cyberglove::glove_sensors::NB_SENSORS);
+      return false;
+    }
+
+    ros::WallTime start;
+    if( timing_hook )
+      start = ros::WallTime::now();
+
+    mapping.get_remapped_vector(calibrated_positions, mapped_positions);
+    if( mapped_positions.size() < cyberglove::mapped_joints::NB_JOINTS )
+      return false;
+    stage_done(MAPPING, start);
+
+    compute_abductions(calibrated_positions, mapped_positions);
+    stage_done(ABDUCTION, start);
+
+    for(unsigned int i = 0; i < cyberglove::mapped_joints::NB_JOINTS; ++i )
+    {
+      int joint = cyberglove::mapped_joints::to_hand_joint[i];
+      if( cyberglove::mapped_joints::is_j0[i] )
+      {
+        //J0 = J1 + J2, split evenly
+        hand_positions[joint] = mapped_positions[i] / 2;
+        hand_positions[joint + 1] = mapped_positions[i] / 2;
+      }
+      else
+        hand_positions[joint] = mapped_positions[i];
+    }
+    stage_done(J0_SPLIT, start);
+
+    return true;
+  }
+
+  void GloveToHandPipeline::stage_done(stage finished_stage, ros::WallTime& start) const
+  {
+    if( !timing_hook )
+      return;
+
+    ros::WallTime now = ros::WallTime::now();
+    timing_hook(finished_stage, (now - start).toSec());
+    start = now;
+  }
+
+  void GloveToHandPipeline::compute_abductions(const std::vector<double>& glove, std::vector<double>& mapped)
+  {
+    double middleIndexAb = glove[cyberglove::glove_sensors::MIDDLE_INDEX_AB];
+    double ringMiddleAb = glove[cyberglove::glove_sensors::RING_MIDDLE_AB];
+    double pinkieRingAb = glove[cyberglove::glove_sensors::PINKIE_RING_AB];
+
+    // if the abduction sensors are less than 0, it is an artifact of the calibration (we don't want to consider anything smaller than 0 for these sensors)
+    if (middleIndexAb < 0.0)
+      middleIndexAb = 0.0;
+    if (ringMiddleAb < 0.0)
+      ringMiddleAb = 0.0;
+    if (pinkieRingAb < 0.0)
+      pinkieRingAb = 0.0;
+
+    //Add the 3 abduction angles to have an idea of where the centre lies
+    double ab_total = middleIndexAb + ringMiddleAb +  pinkieRingAb;
+
+    double& ffj4 = mapped[cyberglove::mapped_joints::FFJ4];
+    double& mfj4 = mapped[cyberglove::mapped_joints::MFJ4];
+    double& rfj4 = mapped[cyberglove::mapped_joints::RFJ4];
+    double& lfj4 = mapped[cyberglove::mapped_joints::LFJ4];
+
+    //When trying to understand this code bear in mind that the abduction sign convention
+    // in the shadow hand is the opposite for ff and mf than for rf and lf.
+    if (ab_total/2 < middleIndexAb) // If the centre lies between ff and mf
+    {
+      ffj4 = -ab_total/2;
+      mfj4 = middleIndexAb - ab_total/2;
+      rfj4 = -(ringMiddleAb + mfj4);
+      lfj4 = -pinkieRingAb + rfj4;
+    }
+    else if (ab_total/2 < middleIndexAb + ringMiddleAb) // If the centre lies between mf and rf
+    {
+      mfj4 = -(ab_total/2 - middleIndexAb);
+      ffj4 = -middleIndexAb + mfj4;
+      rfj4 = -(ringMiddleAb + mfj4);
+      lfj4 = -pinkieRingAb + rfj4;
+    }
+    else // If the centre lies between rf and lf
+    {
+      lfj4 = -ab_total/2;
+      rfj4 = pinkieRingAb + lfj4;
+      mfj4 = -(ringMiddleAb + rfj4);
+      ffj4 = -middleIndexAb + mfj4;
+    }
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,147 @@
+/**
+ * @file   haptic_force_pipeline.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Computes the cybergrasp forces from the hand data, at the fixed
+ * rate of the haptic loop.
+ *
+ */
+
+#include "sr_remappers/haptic_force_pipeline.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace sr_remappers
+{
+  const unsigned int HapticForcePipeline::nb_fingers;
+
+  HapticForcePipeline::Settings::Settings()
+    : rate(100.0), deadband(0.01), time_constant(0.02), max_force(1.0), input_timeout(0.1),
+      timeout_periods(3.0), averaging(true), interpolating(true)
+  {
+  }
+
+  HapticForcePipeline::HapticForcePipeline(const std::string& path_to_calibration, const Settings& settings)
+    : calibration(path_to_calibration), settings(settings), alpha(1.0), latest_input_time(0.0),
+      input_received(false), nb_pending(0), input_period(0.0), ramp_start_time(0.0),
+      depth(0), input_age(0.0), timeout(false)
+  {
+    //first order low pass filter, at the loop's fixed rate
+    if( settings.time_constant > 0.0 && settings.rate > 0.0 )
+      alpha = 1.0 - exp(-1.0 / (settings.rate * settings.time_constant));
+
+    //the buffers are allocated once and for all
+    latest_input.assign(calibration.get_nb_inputs(), 0.0);
+    input_sum.assign(calibration.get_nb_inputs(), 0.0);
+    input.assign(calibration.get_nb_inputs(), 0.0);
+    mapped_forces.assign(calibration.get_nb_outputs(), 0.0);
+
+    std::fill(ramp_start, ramp_start + nb_fingers, 0.0);
+    std::fill(ramp_end, ramp_end + nb_fingers, 0.0);
+    std::fill(targets, targets + nb_fingers, 0.0);
+    std::fill(forces, forces + nb_fingers, 0.0);
+  }
+
+  bool HapticForcePipeline::tick(double time)
+  {
+    double period;
+    {
+      boost::mutex::scoped_lock lock(input_mutex);
+      if( !input_received )
+        return false;
+
+      //coalesce the inputs received since the last tick
+      depth = nb_pending;
+      if( nb_pending > 0 )
+      {
+        if( settings.averaging )
+        {
+          for( unsigned int i = 0; i < input_sum.size(); ++i )
+            input[i] = input_sum[i] / nb_pending;
+        }
+        else
+          std::copy(latest_input.begin(), latest_input.end(), input.begin());
+
+        std::fill(input_sum.begin(), input_sum.end(), 0.0);
+        nb_pending = 0;
+      }
+
+      input_age = time - latest_input_time;
+      period = input_period;
+    }
+
+    //the forces are released if the hand stopped sending data: a slow input
+    // (e.g. 5Hz) isn't a stopped one, the timeout is then a few of its periods
+    timeout = input_age > std::max(settings.input_timeout, settings.timeout_periods * period);
+    if( timeout )
+    {
+      std::fill(targets, targets + nb_fingers, 0.0);
+      std::fill(ramp_start, ramp_start + nb_fingers, 0.0);
+      std::fill(ramp_end, ramp_end + nb_fingers, 0.0);
+    }
+    else
+    {
+      if( depth > 0 )
+      {
+        calibration.get_remapped_vector(input, mapped_forces);
+
+        //ramp from where we are to the new input
+        for( unsigned int i = 0; i < nb_fingers; ++i )
+        {
+          ramp_start[i] = targets[i];
+          ramp_end[i] = i < mapped_forces.size() ? fabs(mapped_forces[i]) : 0.0;
+        }
+        ramp_start_time = time;
+      }
+
+      //if the inputs are slower than the loop, the ramp lasts one input period
+      // (linear interpolation between the inputs), otherwise the new input is used at once
+      double fraction = 1.0;
+      if( settings.interpolating && period * settings.rate > 1.0 )
+        fraction = std::min(1.0, (time - ramp_start_time) / period);
+
+      for( unsigned int i = 0; i < nb_fingers; ++i )
+        targets[i] = ramp_start[i] + fraction * (ramp_end[i] - ramp_start[i]);
+    }
+
+    for( unsigned int i = 0; i < nb_fingers; ++i )
+    {
+      //deadband: the small forces (noise) are ignored, without a step at its border
+      double force = targets[i] > settings.deadband ? targets[i] - settings.deadband : 0.0;
+
+      forces[i] += alpha * (force - forces[i]);
+      forces[i] = std::min(forces[i], settings.max_force);
+    }
+
+    return true;
+  }
+
+  double HapticForcePipeline::get_input_period()
+  {
+    boost::mutex::scoped_lock lock(input_mutex);
+    return input_period;
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -0,0 +1,146 @@
+/**
+ * @file   profile_bank.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief The mapping / calibration profiles, all loaded at startup, one of
+ * them being active.
+ *
+ */
+
+#include "sr_remappers/profile_bank.h"
+
+namespace sr_remappers
+{
+  const std::string ProfileBank::default_profile = "default";
+
+  int ProfileBank::load(const ros::NodeHandle& n_tilde, const PipelineFactory& factory)
+  {
+    int failed = 0;
+
+    std::vector<std::string> names;
+    names.push_back(default_profile);
+
+    XmlRpc::XmlRpcValue profile_names;
+    if( n_tilde.getParam("profiles", profile_names) )
+    {
+      if( profile_names.getType() != XmlRpc::XmlRpcValue::TypeArray )
+        ROS_ERROR("The profiles parameter should be a list of profile names.");
+      else
+      {
+        for (int32_t i = 0; i < profile_names.size(); ++i)
+        {
+          if( profile_names[i].getType() != XmlRpc::XmlRpcValue::TypeString )
+          {
+            ROS_ERROR("The profiles parameter should be a list of profile names.");
+            ++failed;
+            continue;
+          }
+          names.push_back(static_cast<std::string>(profile_names[i]));
+        }
+      }
+    }
+
+    for (unsigned int i = 0; i < names.size(); ++i)
+    {
+      ros::WallTime start = ros::WallTime::now();
+      PipelinePtr pipeline = factory(i == 0 ? std::string() : names[i] + "/");
+      if( !pipeline || !add(names[i], pipeline) )
+      {
+        ROS_ERROR("Couldn't load the profile %s.", names[i].c_str());
+        ++failed;
+        continue;
+      }
+      ROS_INFO("Profile %s loaded in %.1fms", names[i].c_str(), (ros::WallTime::now() - start).toSec() * 1000.0);
+    }
+
+    std::string initial_profile;
+    if( n_tilde.getParam("active_profile", initial_profile) && !select(initial_profile) )
+      ROS_ERROR("Unknown active_profile %s, using %s.", initial_profile.c_str(), active_name().c_str());
+
+    return failed;
+  }
+
+  bool ProfileBank::add(const std::string& name, const PipelinePtr& pipeline)
+  {
+    if( !profiles.insert(std::make_pair(name, pipeline)).second )
+    {
+      ROS_ERROR("There is already a profile named %s.", name.c_str());
+      return false;
+    }
+
+    boost::mutex::scoped_lock lock(active_mutex);
+    if( !active_pipeline )
+    {
+      active_pipeline = pipeline;
+      active_profile = name;
+    }
+    return true;
+  }
+
+  bool ProfileBank::select(const std::string& name)
+  {
+    ProfileMap::const_iterator profile = profiles.find(name);
+    if( profile == profiles.end() )
+      return false;
+
+    boost::mutex::scoped_lock lock(active_mutex);
+    active_pipeline = profile->second;
+    active_profile = name;
+    return true;
+  }
+
+  ProfileBank::PipelinePtr ProfileBank::active() const
+  {
+    boost::mutex::scoped_lock lock(active_mutex);
+    return active_pipeline;
+  }
+
+  std::string ProfileBank::active_name() const
+  {
+    boost::mutex::scoped_lock lock(active_mutex);
+    return active_profile;
+  }
+
+  std::vector<std::string> ProfileBank::names() const
+  {
+    std::vector<std::string> names;
+    for (ProfileMap::const_iterator it = profiles.begin(); it != profiles.end(); ++it)
+      names.push_back(it->first);
+    return names;
+  }
+
+  bool ProfileBank::select_profile(cyberglove::SelectProfile::Request &req, cyberglove::SelectProfile::Response &res)
+  {
+    res.success = select(req.name);
+    if( res.success )
+      ROS_INFO("Profile %s selected", req.name.c_str());
+    else
+      ROS_WARN("Unknown profile %s, keeping %s", req.name.c_str(), active_name().c_str());
+
+    res.active_profile = active_name();
+    res.profiles = names();
+    return true;
+  }
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
@@ -31,6 +31,8 @@
 
 //generic include
 #include <string>
+#include <algorithm>
+#include <boost/bind.hpp>
 
 //own .h
 #include "sr_remappers/shadowhand_to_cyberglove_remapper.h"
@@ -41,138 +43,240 @@ using namespace ros;
 namespace shadowhand_to_cyberglove_remapper
 {
 
-const unsigned int ShadowhandToCybergloveRemapper::number_hand_joints = 20;
+const unsigned int ShadowhandToCybergloveRemapper::number_hand_joints = cyberglove::mapped_joints::NB_JOINTS;
 
 ShadowhandToCybergloveRemapper::ShadowhandToCybergloveRemapper() :
-    n_tilde("~")
+    n_tilde("~"), cyberglove_input(n_tilde, 10), use_frames(false), nb_rejected_frames(0)
 {
     joints_names.resize(number_hand_joints);
     ShadowhandToCybergloveRemapper::init_names();
 
-    std::string param;
-    std::string path;
-    n_tilde.searchParam("cyberglove_mapping_path", param);
-    n_tilde.param(param, path, std::string());
-    calibration_parser = new CalibrationParser(path);
-    ROS_INFO("Mapping file loaded for the Cyberglove: %s", path.c_str());
+    //all the mappings are loaded now, switching between them is instantaneous
+    profiles.load(n_tilde, boost::bind(&ShadowhandToCybergloveRemapper::load_profile, this, _1));
+    select_profile_server = n_tilde.advertiseService("select_profile", &sr_remappers::ProfileBank::select_profile, &profiles);
 
     std::string prefix;
     std::string searched_param;
     n_tilde.searchParam("cyberglove_prefix", searched_param);
     n_tilde.param(searched_param, prefix, std::string());
 
-    std::string full_topic = prefix + "/calibrated/joint_states";
+    init_output();
+
+    //the frames carry their number: the frames lost upstream can be told from the ones lost here.
+    // Only the cyberglove nodes of this stack publish them, the joint_states are the default.
+    n_tilde.param("use_frames", use_frames, false);
+    if( use_frames )
+    {
+        frames_pub = n_tilde.advertise<cyberglove::GloveFrame>("frames", 5);
+        cyberglove_jointstates_sub = cyberglove_input.subscribe(node, prefix + "/calibrated/frames", &ShadowhandToCybergloveRemapper::framesCallback, this);
+    }
+    else
+        cyberglove_jointstates_sub = cyberglove_input.subscribe(node, prefix + "/calibrated/joint_states", &ShadowhandToCybergloveRemapper::jointstatesCallback, this);
+}
+
+void ShadowhandToCybergloveRemapper::init_output()
+{
+    std::string mode;
+    n_tilde.param("output_mode", mode, std::string("sendupdate"));
+
+    //the names never change: they're only set in the prototype of the published messages
+    if( mode == "array" || mode == "trajectory" )
+    {
+        //the J0s are split, as for the hand controllers
+        std::string joint_prefix;
+        n_tilde.param("joint_prefix", joint_prefix, std::string());
+        std::vector<std::string> hand_joint_names;
+        for(unsigned int i = 0; i < cyberglove::hand_joints::NB_JOINTS; ++i )
+            hand_joint_names.push_back(joint_prefix + cyberglove::hand_joints::names[i]);
+        output_frame.name = hand_joint_names;
+
+        if( mode == "array" )
+        {
+            output_mode = output_modes::ARRAY;
+
+            //the order of the array is published once, on a latched topic
+            sensor_msgs::JointState joint_names;
+            joint_names.name = hand_joint_names;
+            joint_names_pub = n_tilde.advertise<sensor_msgs::JointState>("joint_names", 1, true);
+            joint_names_pub.publish(joint_names);
+
+            std_msgs::Float64MultiArray prototype;
+            prototype.layout.dim.resize(1);
+            prototype.layout.dim[0].label = "joints";
+            prototype.layout.dim[0].size = cyberglove::hand_joints::NB_JOINTS;
+            prototype.layout.dim[0].stride = cyberglove::hand_joints::NB_JOINTS;
+            prototype.layout.data_offset = 0;
+            prototype.data.resize(cyberglove::hand_joints::NB_JOINTS);
+            array_pool.reset(new cyberglove::MessagePool<std_msgs::Float64MultiArray>(prototype));
+        }
+        else
+        {
+            output_mode = output_modes::TRAJECTORY;
+
+            //a single point, reached after trajectory_delay. The stamp is left
+            // to 0: the trajectory starts when the controller receives it
+            double delay;
+            n_tilde.param("trajectory_delay", delay, 0.002);
 
-    cyberglove_jointstates_sub = node.subscribe(full_topic, 10, &ShadowhandToCybergloveRemapper::jointstatesCallback, this);
+            trajectory_msgs::JointTrajectory prototype;
+            prototype.joint_names = hand_joint_names;
+            prototype.points.resize(1);
+            prototype.points[0].positions.resize(cyberglove::hand_joints::NB_JOINTS);
+            prototype.points[0].time_from_start = ros::Duration(delay);
+            trajectory_pool.reset(new cyberglove::MessagePool<trajectory_msgs::JointTrajectory>(prototype));
+        }
 
+        std::string topic;
+        n_tilde.param("command_topic", topic, std::string(mode == "array" ? "position_controller/command" : "trajectory_controller/command"));
+        if( mode == "array" )
+            shadowhand_pub = node.advertise<std_msgs::Float64MultiArray>(topic, 5);
+        else
+            shadowhand_pub = node.advertise<trajectory_msgs::JointTrajectory>(topic, 5);
+        ROS_INFO("Publishing the hand positions as %s on %s", mode.c_str(), topic.c_str());
+        return;
+    }
+
+    if( mode != "sendupdate" )
+        ROS_ERROR("Unknown output_mode %s, publishing sendupdate messages.", mode.c_str());
+    output_mode = output_modes::SENDUPDATE;
+
+    sr_robot_msgs::sendupdate prototype;
+    prototype.sendupdate_length = number_hand_joints;
+    prototype.sendupdate_list.resize(number_hand_joints);
+    for(unsigned int i = 0; i < number_hand_joints; ++i )
+        prototype.sendupdate_list[i].joint_name = joints_names[i];
+    output_frame.name = joints_names;
+    sendupdate_pool.reset(new cyberglove::MessagePool<sr_robot_msgs::sendupdate>(prototype));
+
+    std::string prefix;
+    std::string searched_param;
     n_tilde.searchParam("sendupdate_prefix", searched_param);
     n_tilde.param(searched_param, prefix, std::string());
-    full_topic = prefix + "sendupdate";
+    std::string full_topic = prefix + "sendupdate";
 
     shadowhand_pub = node.advertise<sr_robot_msgs::sendupdate> (full_topic, 5);
 }
 
+ShadowhandToCybergloveRemapper::~ShadowhandToCybergloveRemapper()
+{
+    if( cyberglove_input.get_nb_skipped() > 0 )
+        ROS_INFO("%lu glove messages were skipped", (unsigned long)cyberglove_input.get_nb_skipped());
+    //where the frames were lost: before the remapper (including on the topic), or by the mapping
+    if( use_frames )
+        ROS_INFO("Glove frames received: %lu, missing before the remapper: %lu, rejected by the mapping: %lu",
+                 input_frames.get_nb_frames(), input_frames.get_nb_missing(), nb_rejected_frames);
+    else if( nb_rejected_frames > 0 )
+        ROS_INFO("%lu glove frames were rejected by the mapping", nb_rejected_frames);
+}
+
+sr_remappers::ProfileBank::PipelinePtr ShadowhandToCybergloveRemapper::load_profile(const std::string& param_prefix)
+{
+    std::string param;
+    std::string path;
+    if( param_prefix.empty() )
+    {
+        n_tilde.searchParam("cyberglove_mapping_path", param);
+        n_tilde.param(param, path, std::string());
+    }
+    else if( !n_tilde.getParam(param_prefix + "cyberglove_mapping_path", path) )
+    {
+        ROS_ERROR("No %scyberglove_mapping_path parameter.", param_prefix.c_str());
+        return sr_remappers::ProfileBank::PipelinePtr();
+    }
+
+    sr_remappers::ProfileBank::PipelinePtr pipeline(new sr_remappers::GloveToHandPipeline(path));
+    ROS_INFO("Mapping file loaded for the Cyberglove: %s", path.c_str());
+    return pipeline;
+}
+
 void ShadowhandToCybergloveRemapper::init_names()
 {
-    joints_names[0] = "THJ1";
-    joints_names[1] = "THJ2";
-    joints_names[2] = "THJ3";
-    joints_names[3] = "THJ4";
-    joints_names[4] = "THJ5";
-    joints_names[5] = "FFJ0";
-    joints_names[6] = "FFJ3";
-    joints_names[7] = "FFJ4";
-    joints_names[8] = "MFJ0";
-    joints_names[9] = "MFJ3";
-    joints_names[10] = "MFJ4";
-    joints_names[11] = "RFJ0";
-    joints_names[12] = "RFJ3";
-    joints_names[13] = "RFJ4";
-    joints_names[14] = "LFJ0";
-    joints_names[15] = "LFJ3";
-    joints_names[16] = "LFJ4";
-    joints_names[17] = "LFJ5";
-    joints_names[18] = "WRJ1";
-    joints_names[19] = "WRJ2";
+    joints_names.assign(cyberglove::mapped_joints::names, cyberglove::mapped_joints::names + cyberglove::mapped_joints::NB_JOINTS);
 }
 
 void ShadowhandToCybergloveRemapper::jointstatesCallback( const sensor_msgs::JointStateConstPtr& msg )
 {
-    sr_robot_msgs::joint joint;
-    sr_robot_msgs::sendupdate pub;
-
-    //Do conversion
-    std::vector<double> vect = calibration_parser->get_remapped_vector(msg->position);
+    cyberglove_input.received(msg->header.seq);
+    remap(msg->position, msg->header.stamp, 0);
+}
 
-    //Process J4's
-    getAbductionJoints(msg, vect);
+void ShadowhandToCybergloveRemapper::framesCallback( const cyberglove::GloveFrameConstPtr& msg )
+{
+    cyberglove_input.received(msg->header.seq);
+    input_frames.add(msg->frame_number);
+    remap(msg->position, msg->header.stamp, msg->frame_number);
+}
 
-    //Generate sendupdate message
-    pub.sendupdate_length = number_hand_joints;
+void ShadowhandToCybergloveRemapper::remap( const std::vector<double>& glove_positions, const ros::Time& stamp, uint32_t frame_number )
+{
+    //Do conversion (the J4s are computed from the abduction sensors)
+    sr_remappers::ProfileBank::PipelinePtr pipeline = profiles.active();
 
-    std::vector<sr_robot_msgs::joint> table(number_hand_joints);
-    for(unsigned int i = 0; i < number_hand_joints; ++i )
+    //Fill a preallocated message: only the positions change. It is published
+    // as a shared pointer: not serialized for the intra-process subscribers
+    switch( output_mode )
+    {
+    case output_modes::ARRAY:
+    {
+        cyberglove::MessagePool<std_msgs::Float64MultiArray>::MessagePtr pub = remap_frame(*pipeline, *array_pool, glove_positions);
+        if( !pub )
+            break;
+        shadowhand_pub.publish(pub);
+        publish_frame(stamp, frame_number, pipeline->get_hand_positions());
+        return;
+    }
+    case output_modes::TRAJECTORY:
     {
-        joint.joint_name = joints_names[i];
-        joint.joint_target = vect[i];
-        table[i] = joint;
+        cyberglove::MessagePool<trajectory_msgs::JointTrajectory>::MessagePtr pub = remap_frame(*pipeline, *trajectory_pool, glove_positions);
+        if( !pub )
+            break;
+        shadowhand_pub.publish(pub);
+        publish_frame(stamp, frame_number, pipeline->get_hand_positions());
+        return;
     }
-    pub.sendupdate_length = number_hand_joints;
-    pub.sendupdate_list = table;
-    shadowhand_pub.publish(pub);
+    default:
+    {
+        cyberglove::MessagePool<sr_robot_msgs::sendupdate>::MessagePtr pub = remap_frame(*pipeline, *sendupdate_pool, glove_positions);
+        if( !pub )
+            break;
+        shadowhand_pub.publish(pub);
+        publish_frame(stamp, frame_number, pipeline->get_mapped_positions());
+        return;
+    }
+    }
+
+    //the mapping rejected the frame
+    ++nb_rejected_frames;
+}
+
+void ShadowhandToCybergloveRemapper::fill(const sr_remappers::GloveToHandPipeline& pipeline, sr_robot_msgs::sendupdate& msg)
+{
+    const std::vector<double>& vect = pipeline.get_mapped_positions();
+    for(unsigned int i = 0; i < number_hand_joints; ++i )
+        msg.sendupdate_list[i].joint_target = vect[i];
 }
 
-void ShadowhandToCybergloveRemapper::getAbductionJoints( const sensor_msgs::JointStateConstPtr& msg, std::vector<double>& vect)
+void ShadowhandToCybergloveRemapper::fill(const sr_remappers::GloveToHandPipeline& pipeline, std_msgs::Float64MultiArray& msg)
 {
-  double middleIndexAb = msg->position[10];
-  double ringMiddleAb = msg->position[14];
-  double pinkieRingAb = msg->position[18];
-
-  // if the abduction sensors are less than 0, it is an artifact of the calibration (we don't want to consider anything smaller than 0 for these sensors)
-  if (middleIndexAb < 0.0)
-    middleIndexAb = 0.0;
-  if (ringMiddleAb < 0.0)
-    ringMiddleAb = 0.0;
-  if (pinkieRingAb < 0.0)
-    pinkieRingAb = 0.0;
-
-  //Add the 3 abduction angles to have an idea of where the centre lies
-  double ab_total = middleIndexAb + ringMiddleAb +  pinkieRingAb;
-
-  //When trying to understand this code bear in mind that the abduction sign convention
-  // in the shadow hand is the opposite for ff and mf than for rf and lf.
-  if (ab_total/2 < middleIndexAb) // If the centre lies between ff and mf
-  {
-    //FFJ4
-    vect[7] = -ab_total/2;
-    //MFJ4
-    vect[10] = middleIndexAb - ab_total/2;
-    //RFJ4
-    vect[13] = -(ringMiddleAb + vect[10]);
-    //LFJ4
-    vect[16] = -pinkieRingAb + vect[13];
-  }
-  else if (ab_total/2 < middleIndexAb + ringMiddleAb) // If the centre lies between mf and rf
-  {
-    //MFJ4
-    vect[10] = -(ab_total/2 - middleIndexAb);
-    //FFJ4
-    vect[7] = -middleIndexAb + vect[10];
-    //RFJ4
-    vect[13] = -(ringMiddleAb + vect[10]);
-    //LFJ4
-    vect[16] = -pinkieRingAb + vect[13];
-  }
-  else // If the centre lies between rf and lf
-  {
-    //LFJ4
-    vect[16] = -ab_total/2;
-    //RFJ4
-    vect[13] = pinkieRingAb + vect[16];
-    //MFJ4
-    vect[10] = -(ringMiddleAb + vect[13]);
-    //FFJ4
-    vect[7] = -middleIndexAb + vect[10];
-  }
+    const std::vector<double>& hand_positions = pipeline.get_hand_positions();
+    std::copy(hand_positions.begin(), hand_positions.end(), msg.data.begin());
+}
+
+void ShadowhandToCybergloveRemapper::fill(const sr_remappers::GloveToHandPipeline& pipeline, trajectory_msgs::JointTrajectory& msg)
+{
+    const std::vector<double>& hand_positions = pipeline.get_hand_positions();
+    std::copy(hand_positions.begin(), hand_positions.end(), msg.points[0].positions.begin());
+}
+
+void ShadowhandToCybergloveRemapper::publish_frame(const ros::Time& stamp, uint32_t frame_number, const std::vector<double>& positions)
+{
+    if( !use_frames || frames_pub.getNumSubscribers() == 0 )
+        return;
+
+    //the hand commands have no field for it: the frame number goes with a copy of the positions
+    output_frame.header.stamp = stamp;
+    output_frame.frame_number = frame_number;
+    output_frame.position.assign(positions.begin(), positions.end());
+    frames_pub.publish(output_frame);
 }
 }//end namespace
@@ -23,6 +23,10 @@
  * /joint_states coming from the hand to the /cybergraspforces topic
  * used to control the cybergrasp.
  *
+ * The forces are computed in a haptic loop running at a fixed rate
+ * (~haptic_rate), from the effort (or tactile) data received since the
+ * previous tick (averaged), or interpolated between the last inputs if they
+ * are slower than the loop.
  *
  */
 
@@ -31,9 +35,9 @@
 
 //generic include
 #include <string>
-
-#include <unistd.h>
-#include <math.h>
+#include <sstream>
+#include <algorithm>
+#include <boost/bind.hpp>
 
 //own .h
 #include "sr_remappers/shadowhand_to_cybergrasp_remapper.h"
@@ -43,7 +47,9 @@ using namespace ros;
 namespace shadowhand_to_cybergrasp_remapper{
 
   ShadowhandToCybergraspRemapper::ShadowhandToCybergraspRemapper()
-    : n_tilde("~"), publish_rate(0.0)
+    : n_tilde("~"), jointstates_input(n_tilde, 10), publish_rate(0.0), input_size_error(false),
+      latency_sum(0.0), latency_max(0.0), compute_sum(0.0), compute_max(0.0),
+      nb_latencies(0), nb_ticks(0), nb_timeouts(0), depth_sum(0), depth_max(0)
   {
     std::string searched_param;
 
@@ -52,7 +58,26 @@ namespace shadowhand_to_cybergrasp_remapper{
     n_tilde.searchParam("cybergrasp_calibration_path", searched_param);
     n_tilde.param(searched_param, path, std::string());
 
-    calibration_parser = new CalibrationParser(path);
+    //the processing of the forces
+    sr_remappers::HapticForcePipeline::Settings settings;
+    n_tilde.param("haptic_rate", settings.rate, settings.rate);
+    n_tilde.param("force_deadband", settings.deadband, settings.deadband);
+    n_tilde.param("force_time_constant", settings.time_constant, settings.time_constant);
+    n_tilde.param("max_force", settings.max_force, settings.max_force);
+    n_tilde.param("input_timeout", settings.input_timeout, settings.input_timeout);
+    n_tilde.param("input_timeout_periods", settings.timeout_periods, settings.timeout_periods);
+
+    //the inputs received between two ticks are averaged (or only the latest
+    // is used); if they're slower than the loop, the forces are interpolated
+    n_tilde.param("averaging", settings.averaging, settings.averaging);
+    n_tilde.param("interpolate", settings.interpolating, settings.interpolating);
+    publish_rate = settings.rate;
+
+    pipeline.reset(new sr_remappers::HapticForcePipeline(path, settings));
+    if( pipeline->get_calibration().get_nb_outputs() != sr_remappers::HapticForcePipeline::nb_fingers )
+      ROS_ERROR("The cybergrasp calibration %s maps to %u values instead of %u fingers.",
+                path.c_str(), pipeline->get_calibration().get_nb_outputs(),
+                sr_remappers::HapticForcePipeline::nb_fingers);
 
    //publish to cybergraspforces topic
     std::string prefix;
@@ -60,84 +85,198 @@ namespace shadowhand_to_cybergrasp_remapper{
     n_tilde.param(searched_param, prefix, std::string());
     std::string full_topic = prefix + "cybergraspforces";
 
-    shadowhand_cybergrasp_pub = node.advertise<cybergrasp::cybergraspforces>(full_topic, 20);
+    //only the freshest command is useful to the device: no backlog
+    shadowhand_cybergrasp_pub = node.advertise<cybergrasp::cybergraspforces>(full_topic, 1);
+    diagnostics_pub = node.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 2);
 
-    //subscribe to joint_states topic
-    n_tilde.searchParam("joint_states_prefix", searched_param);
-    n_tilde.param(searched_param, prefix, std::string());
+    //start the haptic loop before receiving anything: it only sends forces
+    // once some data was received
+    scheduler.add_output("haptic", publish_rate, boost::bind(&ShadowhandToCybergraspRemapper::haptic_loop, this));
+    scheduler.add_output("diagnostics", 1.0, boost::bind(&ShadowhandToCybergraspRemapper::publish_diagnostics, this));
+    scheduler.start(cyberglove::ThreadConfig::from_parameters(n_tilde, "haptic_thread"));
 
-    full_topic = prefix + "joint_states";
+    //the forces are computed from the joint efforts, or from the tactile sensors
+    std::string force_source;
+    n_tilde.param("force_source", force_source, std::string("effort"));
+    if( force_source == "tactile" )
+    {
+      n_tilde.param("tactile_topic", full_topic, std::string("tactile"));
+      shadowhand_jointstates_sub = jointstates_input.subscribe(node, full_topic, &ShadowhandToCybergraspRemapper::tactileCallback, this);
+    }
+    else
+    {
+      if( force_source != "effort" )
+        ROS_ERROR("Unknown force_source %s, using the joint efforts.", force_source.c_str());
 
-    shadowhand_jointstates_sub = node.subscribe(full_topic, 10, &ShadowhandToCybergraspRemapper::jointstatesCallback, this);
+      //subscribe to joint_states topic
+      n_tilde.searchParam("joint_states_prefix", searched_param);
+      n_tilde.param(searched_param, prefix, std::string());
 
-   }
+      full_topic = prefix + "joint_states";
+
+      shadowhand_jointstates_sub = jointstates_input.subscribe(node, full_topic, &ShadowhandToCybergraspRemapper::jointstatesCallback, this);
+    }
+    ROS_INFO("Computing the cybergrasp forces at %.0fHz from %s", publish_rate, full_topic.c_str());
+  }
 
   ShadowhandToCybergraspRemapper::~ShadowhandToCybergraspRemapper()
   {
-    if( calibration_parser )
-      delete calibration_parser;
+    //stop the haptic loop before destroying what it uses
+    scheduler.stop();
+
+    if( jointstates_input.get_nb_skipped() > 0 )
+      ROS_INFO("%lu input messages were skipped", (unsigned long)jointstates_input.get_nb_skipped());
   }
 
-  /**
-   * process the joint_states callback: get the force data from the
-   * finger tips and stream it to the cybergrasp
-   *
-   * @param msg the joint_states message
-   */
   void ShadowhandToCybergraspRemapper::jointstatesCallback(const sensor_msgs::JointStateConstPtr& msg)
   {
-    //read msg and remap the vector to the cybergrasp
+    jointstates_input.received(msg->header.seq);
+    store_input(msg->effort);
+  }
+
+  void ShadowhandToCybergraspRemapper::tactileCallback(const sr_robot_msgs::ShadowPSTConstPtr& msg)
+  {
+    jointstates_input.received(msg->header.seq);
+    store_input(msg->pressure);
+  }
+
+  template <class T>
+  void ShadowhandToCybergraspRemapper::store_input(const std::vector<T>& values)
+  {
+    if( !pipeline->add_input(values, ros::WallTime::now().toSec()) )
+    {
+      if( !input_size_error )
+        ROS_ERROR("Received %u values, the cybergrasp calibration expects %u: ignoring them.",
+                  (unsigned int)values.size(), pipeline->get_calibration().get_nb_inputs());
+      input_size_error = true;
+    }
+  }
+
+  bool ShadowhandToCybergraspRemapper::haptic_loop()
+  {
+    ros::WallTime start = ros::WallTime::now();
+    if( !pipeline->tick(start.toSec()) )
+      return false;
+
+    //the latency is measured when new data is first used
+    unsigned int depth = pipeline->get_depth();
+    if( depth > 0 )
+    {
+      latency_sum += pipeline->get_input_age();
+      latency_max = std::max(latency_max, pipeline->get_input_age());
+      ++nb_latencies;
+    }
+    depth_sum += depth;
+    depth_max = std::max(depth_max, depth);
+    if( pipeline->timed_out() )
+      ++nb_timeouts;
+
     cybergrasp::cybergraspforces cybergrasp_msg;
+    const double* forces = pipeline->get_forces();
+    for( unsigned int i = 0; i < sr_remappers::HapticForcePipeline::nb_fingers; ++i )
+      cybergrasp_msg.forces[i] = forces[i];
 
-    //std::vector<double> pos(5);
-    /*std::vector<double> difference_target_position(24);
-    for(unsigned int i = 0 ; i < difference_target_position.size() ; ++i)
-      {
-	//velocity contains the targets... not the proper way of doing that
-	difference_target_position[i] = fabs(msg->position[i] - msg->velocity[i]);
-      }
-    */
-    //    pos = calibration_parser->get_remapped_vector(difference_target_position);
-    /*    pos = calibration_parser->get_remapped_vector(msg->effort);
-
-    for( unsigned int i=0; i < pos.size(); ++i)
-      {
-	double tmp = fabs(pos[i]);
-
-	ROS_ERROR("%f", tmp);
-	if(tmp > 0.015)
-	  {
-	    ROS_ERROR("%d >0.015", i);
-	    cybergrasp_msg.forces[i] = (tmp-0.01)*7.0;
-	  }
-	else
-	  cybergrasp_msg.forces[i] = 0.0;
-      }
-    */
-
-    double average = 0.0;
-
-    for( unsigned int i=0; i < msg->effort.size(); ++i)
-      {
-	average = msg->effort[i]*10.0;
-      }
-
-    average /= msg->effort.size();
-
-    average /= msg->effort.size();
-    average *= 1000.0;
-
-    for( unsigned int i=0; i < 5; ++i)
-      {
-	cybergrasp_msg.forces[i] = 0.01;
-      }
-
-    //return the max of the read values on the sensor
-    cybergrasp_msg.forces[1] = (average - 0.016)*2.0;
     //send vector to cybergrasp
     shadowhand_cybergrasp_pub.publish(cybergrasp_msg);
 
-    //    sleep(2);
+    double compute_time = (ros::WallTime::now() - start).toSec();
+    compute_sum += compute_time;
+    compute_max = std::max(compute_max, compute_time);
+    ++nb_ticks;
+
+    return true;
+  }
+
+  bool ShadowhandToCybergraspRemapper::publish_diagnostics()
+  {
+    diagnostic_msgs::DiagnosticArray diagnostics;
+    diagnostics.header.stamp = ros::Time::now();
+
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = ros::this_node::getName() + ": haptic loop";
+    if( nb_ticks == 0 )
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+      status.message = "No data received";
+    }
+    else if( nb_timeouts > 0 )
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+      status.message = "Input timeout: forces released";
+    }
+    else
+    {
+      status.level = diagnostic_msgs::DiagnosticStatus::OK;
+      status.message = "Sending forces";
+    }
+    scheduler.add_diagnostics(status);
+
+    diagnostic_msgs::KeyValue key_value;
+    std::stringstream ss;
+
+    ss << (nb_latencies > 0 ? latency_sum / nb_latencies * 1000.0 : 0.0);
+    key_value.key = "mean input latency (ms)";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << latency_max * 1000.0;
+    key_value.key = "max input latency (ms)";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << (nb_ticks > 0 ? compute_sum / nb_ticks * 1e6 : 0.0);
+    key_value.key = "mean compute time (us)";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << compute_max * 1e6;
+    key_value.key = "max compute time (us)";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << (nb_ticks > 0 ? (double)depth_sum / nb_ticks : 0.0);
+    key_value.key = "mean coalesced inputs";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << depth_max;
+    key_value.key = "max coalesced inputs";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << pipeline->get_input_period() * 1000.0;
+    key_value.key = "input period (ms)";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << nb_timeouts;
+    key_value.key = "input timeouts";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    ss.str("");
+    ss << jointstates_input.get_nb_skipped();
+    key_value.key = "skipped input messages";
+    key_value.value = ss.str();
+    status.values.push_back(key_value);
+
+    diagnostics.status.push_back(status);
+    diagnostics_pub.publish(diagnostics);
+
+    //the metrics are measured between two diagnostics
+    latency_sum = latency_max = 0.0;
+    nb_latencies = 0;
+    compute_sum = compute_max = 0.0;
+    nb_ticks = nb_timeouts = 0;
+    depth_sum = depth_max = 0;
 
+    return true;
   }
 }//end namespace
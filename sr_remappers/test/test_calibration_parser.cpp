@@ -0,0 +1,260 @@
+/**
+ * @file   test_calibration_parser.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Checks the mapping of the CalibrationParser (sparse, dense and batch)
+ * against the original column by column product, and compares their speed.
+ *
+ */
+
+#include <ros/ros.h>
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "sr_remappers/calibration_parser.h"
+
+std::string path_to_mapping = "param/cyberglovetoshadowhand_transposed.map";
+std::string path_to_dense_mapping = "/tmp/test_sr_remappers_dense.map";
+
+double epsilon = 1e-9;
+
+/**
+ * Reads a mapping file into a matrix (one vector per line), the way the
+ * original CalibrationParser stored it.
+ */
+std::vector<std::vector<double> > read_matrix(const std::string& path)
+{
+  std::vector<std::vector<double> > matrix;
+  std::ifstream file(path.c_str());
+  std::string line;
+  while( std::getline(file, line) )
+  {
+    if( line.empty() || line[0] == '#' )
+      continue;
+    std::istringstream values(line);
+    std::vector<double> matrix_line;
+    double value;
+    while( values >> value )
+      matrix_line.push_back(value);
+    if( !matrix_line.empty() )
+      matrix.push_back(matrix_line);
+  }
+  return matrix;
+}
+
+/**
+ * The original mapping: input taken by value, result allocated at each call,
+ * matrix walked column by column.
+ */
+std::vector<double> reference_remap(const std::vector<std::vector<double> >& matrix, std::vector<double> input_vector)
+{
+  std::vector<double> result(matrix[0].size());
+  for( unsigned int col = 0; col < matrix[0].size(); ++col )
+  {
+    double tmp_value = 0.0;
+    for( unsigned int index_vec = 0; index_vec < matrix.size(); ++index_vec )
+      tmp_value += (input_vector[index_vec] * matrix[index_vec][col]);
+    result[col] = tmp_value;
+  }
+  return result;
+}
+
+std::vector<double> random_frame(unsigned int size)
+{
+  std::vector<double> frame(size);
+  for( unsigned int i = 0; i < size; ++i )
+    frame[i] = (double)rand() / RAND_MAX * 2.0 - 0.5;
+  return frame;
+}
+
+double now()
+{
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/// Writes a 22x20 mapping without any zero.
+void write_dense_mapping()
+{
+  std::ofstream file(path_to_dense_mapping.c_str());
+  file << "# dense mapping" << std::endl;
+  for( unsigned int line = 0; line < 22; ++line )
+  {
+    for( unsigned int col = 0; col < 20; ++col )
+      file << (double)rand() / RAND_MAX + 0.01 << " ";
+    file << std::endl;
+  }
+}
+
+TEST(CalibrationParser, shippedMappingIsSparse)
+{
+  CalibrationParser parser(path_to_mapping);
+  std::vector<std::vector<double> > matrix = read_matrix(path_to_mapping);
+
+  EXPECT_TRUE(parser.is_sparse());
+  EXPECT_EQ(22u, parser.get_nb_inputs());
+  EXPECT_EQ(20u, parser.get_nb_outputs());
+
+  std::vector<double> output;
+  for( unsigned int i = 0; i < 100; ++i )
+  {
+    std::vector<double> input = random_frame(22);
+    std::vector<double> expected = reference_remap(matrix, input);
+
+    parser.get_remapped_vector(input, output);
+    ASSERT_EQ(expected.size(), output.size());
+    for( unsigned int j = 0; j < expected.size(); ++j )
+      EXPECT_NEAR(expected[j], output[j], epsilon);
+
+    std::vector<double> returned = parser.get_remapped_vector(input);
+    for( unsigned int j = 0; j < expected.size(); ++j )
+      EXPECT_NEAR(expected[j], returned[j], epsilon);
+  }
+}
+
+TEST(CalibrationParser, denseMapping)
+{
+  write_dense_mapping();
+  CalibrationParser parser(path_to_dense_mapping);
+  std::vector<std::vector<double> > matrix = read_matrix(path_to_dense_mapping);
+
+  EXPECT_FALSE(parser.is_sparse());
+
+  std::vector<double> output;
+  for( unsigned int i = 0; i < 100; ++i )
+  {
+    std::vector<double> input = random_frame(22);
+    std::vector<double> expected = reference_remap(matrix, input);
+
+    parser.get_remapped_vector(input, output);
+    ASSERT_EQ(expected.size(), output.size());
+    for( unsigned int j = 0; j < expected.size(); ++j )
+      EXPECT_NEAR(expected[j], output[j], epsilon);
+  }
+}
+
+TEST(CalibrationParser, batch)
+{
+  CalibrationParser parser(path_to_mapping);
+  unsigned int nb_frames = 50;
+
+  std::vector<double> inputs, outputs, output;
+  for( unsigned int frame = 0; frame < nb_frames; ++frame )
+  {
+    std::vector<double> input = random_frame(22);
+    inputs.insert(inputs.end(), input.begin(), input.end());
+  }
+
+  parser.get_remapped_vectors(inputs, nb_frames, outputs);
+  ASSERT_EQ(nb_frames * 20, outputs.size());
+
+  for( unsigned int frame = 0; frame < nb_frames; ++frame )
+  {
+    std::vector<double> input(inputs.begin() + frame * 22, inputs.begin() + (frame + 1) * 22);
+    parser.get_remapped_vector(input, output);
+    for( unsigned int j = 0; j < 20; ++j )
+      EXPECT_EQ(output[j], outputs[frame * 20 + j]);
+  }
+}
+
+TEST(CalibrationParser, wrongSize)
+{
+  CalibrationParser parser(path_to_mapping);
+  std::vector<double> output(3, 1.0);
+
+  parser.get_remapped_vector(std::vector<double>(21, 1.0), output);
+  ASSERT_EQ(20u, output.size());
+  for( unsigned int j = 0; j < output.size(); ++j )
+    EXPECT_EQ(0.0, output[j]);
+}
+
+/// Compares the speed of the original mapping and of the new one (results printed).
+TEST(CalibrationParser, benchmark)
+{
+  write_dense_mapping();
+  const char* paths[] = {path_to_mapping.c_str(), path_to_dense_mapping.c_str()};
+  unsigned int nb_frames = 1000, nb_repeats = 100;
+
+  for( unsigned int index_path = 0; index_path < 2; ++index_path )
+  {
+    CalibrationParser parser(paths[index_path]);
+    std::vector<std::vector<double> > matrix = read_matrix(paths[index_path]);
+
+    std::vector<double> inputs;
+    for( unsigned int frame = 0; frame < nb_frames; ++frame )
+    {
+      std::vector<double> input = random_frame(22);
+      inputs.insert(inputs.end(), input.begin(), input.end());
+    }
+    std::vector<double> input(22), output, outputs;
+    double checksum = 0.0;
+
+    double start = now();
+    for( unsigned int repeat = 0; repeat < nb_repeats; ++repeat )
+      for( unsigned int frame = 0; frame < nb_frames; ++frame )
+      {
+        input.assign(inputs.begin() + frame * 22, inputs.begin() + (frame + 1) * 22);
+        checksum += reference_remap(matrix, input)[repeat % 20];
+      }
+    double reference_time = now() - start;
+
+    start = now();
+    for( unsigned int repeat = 0; repeat < nb_repeats; ++repeat )
+      for( unsigned int frame = 0; frame < nb_frames; ++frame )
+      {
+        input.assign(inputs.begin() + frame * 22, inputs.begin() + (frame + 1) * 22);
+        parser.get_remapped_vector(input, output);
+        checksum += output[repeat % 20];
+      }
+    double single_time = now() - start;
+
+    start = now();
+    for( unsigned int repeat = 0; repeat < nb_repeats; ++repeat )
+    {
+      parser.get_remapped_vectors(inputs, nb_frames, outputs);
+      checksum += outputs[repeat % 20];
+    }
+    double batch_time = now() - start;
+
+    double per_frame = 1e9 / (nb_frames * nb_repeats);
+    printf("%s mapping (%s): original %.1fns/frame, output parameter %.1fns/frame, batch %.1fns/frame (%g)\n",
+           parser.is_sparse() ? "sparse" : "dense", paths[index_path],
+           reference_time * per_frame, single_time * per_frame, batch_time * per_frame, checksum);
+  }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  int result = RUN_ALL_TESTS();
+  remove(path_to_dense_mapping.c_str());
+  return result;
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
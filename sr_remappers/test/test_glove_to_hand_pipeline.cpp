@@ -0,0 +1,429 @@
+/**
+ * @file   test_glove_to_hand_pipeline.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Checks the GloveToHandPipeline against the stages run one after
+ * the other, the way the remapper and the trajectory node used to, the
+ * switching between the profiles of a ProfileBank, and the remapper's
+ * processing of a frame: the messages it fills, without allocating anything
+ * once started.
+ *
+ */
+
+#include <ros/ros.h>
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <algorithm>
+#include <boost/bind.hpp>
+
+#include "sr_remappers/glove_to_hand_pipeline.h"
+#include "sr_remappers/profile_bank.h"
+#include "sr_remappers/shadowhand_to_cyberglove_remapper.h"
+#include <cyberglove/message_pool.h>
+#include <sr_robot_msgs/sendupdate.h>
+
+using namespace cyberglove;
+
+std::string path_to_mapping = "param/cyberglovetoshadowhand_transposed.map";
+
+double epsilon = 1e-9;
+
+/// counts all the allocations of the test
+unsigned long nb_allocations = 0;
+
+void* operator new(std::size_t size)
+{
+  ++nb_allocations;
+  void* memory = malloc(size);
+  if( memory == NULL )
+    throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void* memory) throw()
+{
+  free(memory);
+}
+
+std::vector<double> random_frame()
+{
+  std::vector<double> frame(glove_sensors::NB_SENSORS);
+  for( unsigned int i = 0; i < frame.size(); ++i )
+    frame[i] = (double)rand() / RAND_MAX * 2.0 - 0.5;
+  return frame;
+}
+
+/// The original J4 computation.
+void reference_abductions(const std::vector<double>& glove, std::vector<double>& vect)
+{
+  double middleIndexAb = std::max(0.0, glove[glove_sensors::MIDDLE_INDEX_AB]);
+  double ringMiddleAb = std::max(0.0, glove[glove_sensors::RING_MIDDLE_AB]);
+  double pinkieRingAb = std::max(0.0, glove[glove_sensors::PINKIE_RING_AB]);
+  double ab_total = middleIndexAb + ringMiddleAb +  pinkieRingAb;
+
+  if (ab_total/2 < middleIndexAb)
+  {
+    vect[mapped_joints::FFJ4] = -ab_total/2;
+    vect[mapped_joints::MFJ4] = middleIndexAb - ab_total/2;
+    vect[mapped_joints::RFJ4] = -(ringMiddleAb + vect[mapped_joints::MFJ4]);
+    vect[mapped_joints::LFJ4] = -pinkieRingAb + vect[mapped_joints::RFJ4];
+  }
+  else if (ab_total/2 < middleIndexAb + ringMiddleAb)
+  {
+    vect[mapped_joints::MFJ4] = -(ab_total/2 - middleIndexAb);
+    vect[mapped_joints::FFJ4] = -middleIndexAb + vect[mapped_joints::MFJ4];
+    vect[mapped_joints::RFJ4] = -(ringMiddleAb + vect[mapped_joints::MFJ4]);
+    vect[mapped_joints::LFJ4] = -pinkieRingAb + vect[mapped_joints::RFJ4];
+  }
+  else
+  {
+    vect[mapped_joints::LFJ4] = -ab_total/2;
+    vect[mapped_joints::RFJ4] = pinkieRingAb + vect[mapped_joints::LFJ4];
+    vect[mapped_joints::MFJ4] = -(ringMiddleAb + vect[mapped_joints::RFJ4]);
+    vect[mapped_joints::FFJ4] = -middleIndexAb + vect[mapped_joints::MFJ4];
+  }
+}
+
+/// The original J0 split: the J0s are halved between J1 and J2.
+std::vector<double> reference_split(const std::vector<double>& mapped)
+{
+  std::vector<double> hand;
+  for( unsigned int i = 0; i < mapped.size(); ++i )
+  {
+    if( mapped_joints::is_j0[i] )
+    {
+      hand.push_back(mapped[i] / 2);
+      hand.push_back(mapped[i] / 2);
+    }
+    else
+      hand.push_back(mapped[i]);
+  }
+  return hand;
+}
+
+/// A linear calibration for each sensor: raw [0, 1] -> [-1, 2] radians.
+std::vector<xml_calibration_parser::XmlCalibrationParser::JointCalibration> linear_calibration()
+{
+  std::vector<xml_calibration_parser::XmlCalibrationParser::JointCalibration> calibration(glove_sensors::NB_SENSORS);
+  for( unsigned int i = 0; i < calibration.size(); ++i )
+  {
+    calibration[i].name = glove_sensors::names[i];
+    xml_calibration_parser::XmlCalibrationParser::Calibration point;
+    point.raw_value = 0.0;
+    point.calibrated_value = -1.0;
+    calibration[i].calibrations.push_back(point);
+    point.raw_value = 1.0;
+    point.calibrated_value = 2.0;
+    calibration[i].calibrations.push_back(point);
+  }
+  return calibration;
+}
+
+void check_frame(const sr_remappers::GloveToHandPipeline& pipeline, const std::vector<double>& glove,
+                 double tolerance = epsilon)
+{
+  CalibrationParser mapping(path_to_mapping);
+  std::vector<double> expected_mapped = mapping.get_remapped_vector(glove);
+  reference_abductions(glove, expected_mapped);
+  std::vector<double> expected_hand = reference_split(expected_mapped);
+
+  ASSERT_EQ(expected_mapped.size(), pipeline.get_mapped_positions().size());
+  for( unsigned int j = 0; j < expected_mapped.size(); ++j )
+    EXPECT_NEAR(expected_mapped[j], pipeline.get_mapped_positions()[j], tolerance);
+
+  ASSERT_EQ(expected_hand.size(), pipeline.get_hand_positions().size());
+  for( unsigned int j = 0; j < expected_hand.size(); ++j )
+    EXPECT_NEAR(expected_hand[j], pipeline.get_hand_positions()[j], tolerance) << hand_joints::names[j];
+}
+
+TEST(GloveToHandPipeline, calibratedFrames)
+{
+  sr_remappers::GloveToHandPipeline pipeline(path_to_mapping);
+
+  for( unsigned int i = 0; i < 100; ++i )
+  {
+    std::vector<double> glove = random_frame();
+    ASSERT_TRUE(pipeline.process_calibrated(glove));
+    check_frame(pipeline, glove);
+  }
+}
+
+TEST(GloveToHandPipeline, rawFrames)
+{
+  sr_remappers::GloveToHandPipeline pipeline(linear_calibration(), path_to_mapping);
+
+  for( unsigned int i = 0; i < 100; ++i )
+  {
+    std::vector<float> raw(glove_sensors::NB_SENSORS);
+    std::vector<double> glove(glove_sensors::NB_SENSORS);
+    for( unsigned int j = 0; j < raw.size(); ++j )
+    {
+      //on the lookup table points, so that only the float precision is lost
+      raw[j] = (rand() % 1001) / 1000.0f;
+      glove[j] = -1.0 + 3.0 * raw[j];
+    }
+
+    ASSERT_TRUE(pipeline.process(raw));
+    check_frame(pipeline, glove, 1e-5);
+  }
+}
+
+TEST(GloveToHandPipeline, noCalibration)
+{
+  sr_remappers::GloveToHandPipeline pipeline(path_to_mapping);
+  EXPECT_FALSE(pipeline.process(std::vector<float>(glove_sensors::NB_SENSORS, 0.5f)));
+  EXPECT_FALSE(pipeline.process_calibrated(std::vector<double>(3, 0.5)));
+}
+
+TEST(GloveToHandPipeline, invalidMapping)
+{
+  EXPECT_TRUE(sr_remappers::GloveToHandPipeline(path_to_mapping).is_valid());
+  //the cybergrasp calibration isn't glove sensors x mapped joints
+  EXPECT_FALSE(sr_remappers::GloveToHandPipeline("param/shadowhandtocybergrasp.cal").is_valid());
+  EXPECT_FALSE(sr_remappers::GloveToHandPipeline(linear_calibration(), "param/no_such_mapping").is_valid());
+}
+
+TEST(GloveToHandPipeline, buffersAllocatedOnce)
+{
+  sr_remappers::GloveToHandPipeline pipeline(linear_calibration(), path_to_mapping);
+  ASSERT_TRUE(pipeline.process(std::vector<float>(glove_sensors::NB_SENSORS, 0.5f)));
+  const double* mapped = &pipeline.get_mapped_positions()[0];
+  const double* hand = &pipeline.get_hand_positions()[0];
+
+  for( unsigned int i = 0; i < 100; ++i )
+  {
+    ASSERT_TRUE(pipeline.process(std::vector<float>(glove_sensors::NB_SENSORS, (float)i / 100)));
+    ASSERT_TRUE(pipeline.process_calibrated(random_frame()));
+    EXPECT_EQ(mapped, &pipeline.get_mapped_positions()[0]);
+    EXPECT_EQ(hand, &pipeline.get_hand_positions()[0]);
+  }
+}
+
+std::vector<sr_remappers::GloveToHandPipeline::stage> timed_stages;
+
+void record_stage(sr_remappers::GloveToHandPipeline::stage finished_stage, double duration)
+{
+  EXPECT_GE(duration, 0.0);
+  timed_stages.push_back(finished_stage);
+}
+
+TEST(GloveToHandPipeline, timingHook)
+{
+  sr_remappers::GloveToHandPipeline pipeline(linear_calibration(), path_to_mapping);
+  pipeline.set_timing_hook(boost::bind(&record_stage, _1, _2));
+
+  timed_stages.clear();
+  ASSERT_TRUE(pipeline.process(std::vector<float>(glove_sensors::NB_SENSORS, 0.5f)));
+  ASSERT_EQ((unsigned int)sr_remappers::GloveToHandPipeline::NB_STAGES, timed_stages.size());
+  for( unsigned int i = 0; i < timed_stages.size(); ++i )
+    EXPECT_EQ(i, (unsigned int)timed_stages[i]);
+
+  //no calibration stage for calibrated frames
+  timed_stages.clear();
+  ASSERT_TRUE(pipeline.process_calibrated(random_frame()));
+  ASSERT_EQ(3u, timed_stages.size());
+  EXPECT_EQ(sr_remappers::GloveToHandPipeline::MAPPING, timed_stages[0]);
+}
+
+TEST(ProfileBank, select)
+{
+  sr_remappers::ProfileBank profiles;
+  EXPECT_FALSE(profiles.active());
+
+  sr_remappers::ProfileBank::PipelinePtr first(new sr_remappers::GloveToHandPipeline(path_to_mapping));
+  sr_remappers::ProfileBank::PipelinePtr second(new sr_remappers::GloveToHandPipeline(path_to_mapping));
+  EXPECT_TRUE(profiles.add("first", first));
+  EXPECT_TRUE(profiles.add("second", second));
+  EXPECT_FALSE(profiles.add("first", second));
+
+  //the first profile added is active
+  EXPECT_EQ(first, profiles.active());
+  EXPECT_EQ("first", profiles.active_name());
+
+  EXPECT_TRUE(profiles.select("second"));
+  EXPECT_EQ(second, profiles.active());
+
+  //an unknown profile doesn't change the active one
+  cyberglove::SelectProfile::Request req;
+  cyberglove::SelectProfile::Response res;
+  req.name = "third";
+  EXPECT_TRUE(profiles.select_profile(req, res));
+  EXPECT_FALSE(res.success);
+  EXPECT_EQ("second", res.active_profile);
+  EXPECT_EQ(2u, res.profiles.size());
+  EXPECT_EQ(second, profiles.active());
+}
+
+/// A frame being processed keeps the pipeline it started with.
+TEST(ProfileBank, switchDuringFrame)
+{
+  sr_remappers::ProfileBank profiles;
+  profiles.add("first", sr_remappers::ProfileBank::PipelinePtr(new sr_remappers::GloveToHandPipeline(path_to_mapping)));
+  profiles.add("second", sr_remappers::ProfileBank::PipelinePtr(new sr_remappers::GloveToHandPipeline(path_to_mapping)));
+
+  sr_remappers::ProfileBank::PipelinePtr pipeline = profiles.active();
+  profiles.select("second");
+  ASSERT_TRUE(pipeline->process_calibrated(random_frame()));
+  EXPECT_NE(pipeline, profiles.active());
+}
+
+TEST(MessagePool, reusesOnlyReleasedMessages)
+{
+  sr_robot_msgs::sendupdate prototype;
+  prototype.sendupdate_list.resize(2);
+  cyberglove::MessagePool<sr_robot_msgs::sendupdate> pool(prototype, 2);
+
+  cyberglove::MessagePool<sr_robot_msgs::sendupdate>::MessagePtr first = pool.get();
+  ASSERT_EQ(2u, first->sendupdate_list.size());
+  //still referenced (e.g. by a subscriber): a new one is handed out
+  cyberglove::MessagePool<sr_robot_msgs::sendupdate>::MessagePtr second = pool.get();
+  EXPECT_NE(first, second);
+  EXPECT_EQ(2u, pool.size());
+
+  //the pool is full: a message which isn't kept
+  cyberglove::MessagePool<sr_robot_msgs::sendupdate>::MessagePtr third = pool.get();
+  EXPECT_EQ(2u, pool.size());
+
+  sr_robot_msgs::sendupdate* released = first.get();
+  first.reset();
+  EXPECT_EQ(released, pool.get().get());
+}
+
+typedef shadowhand_to_cyberglove_remapper::ShadowhandToCybergloveRemapper Remapper;
+
+/**
+ * Runs the remapper's processing of each frame on the messages of a pool,
+ * with a subscriber keeping the last message: nothing is allocated once
+ * the pool is full.
+ *
+ * @return the last message published
+ */
+template <class M>
+typename cyberglove::MessagePool<M>::MessagePtr remap_frames(cyberglove::MessagePool<M>& pool)
+{
+  sr_remappers::GloveToHandPipeline pipeline(path_to_mapping);
+
+  std::vector<std::vector<double> > frames;
+  for( unsigned int i = 0; i < 100; ++i )
+    frames.push_back(random_frame());
+
+  //check the allocations are counted
+  unsigned long allocations = nb_allocations;
+  std::vector<double>* probe = new std::vector<double>(3);
+  delete probe;
+  EXPECT_LT(allocations, nb_allocations);
+
+  typename cyberglove::MessagePool<M>::MessagePtr subscriber;
+  for( unsigned int i = 0; i < 1000; ++i )
+  {
+    //the first frames fill the pool
+    if( i == 10 )
+      allocations = nb_allocations;
+
+    subscriber = Remapper::remap_frame(pipeline, pool, frames[i % frames.size()]);
+    if( !subscriber )
+    {
+      ADD_FAILURE() << "frame " << i << " rejected";
+      break;
+    }
+  }
+  EXPECT_EQ(0u, nb_allocations - allocations);
+  EXPECT_EQ(2u, pool.size());
+
+  //the last message holds the last frame
+  check_frame(pipeline, frames[999 % frames.size()]);
+  return subscriber;
+}
+
+TEST(RemapFrame, sendupdate)
+{
+  sr_robot_msgs::sendupdate prototype;
+  prototype.sendupdate_length = mapped_joints::NB_JOINTS;
+  prototype.sendupdate_list.resize(mapped_joints::NB_JOINTS);
+  for( unsigned int i = 0; i < mapped_joints::NB_JOINTS; ++i )
+    prototype.sendupdate_list[i].joint_name = mapped_joints::names[i];
+  cyberglove::MessagePool<sr_robot_msgs::sendupdate> pool(prototype);
+
+  cyberglove::MessagePool<sr_robot_msgs::sendupdate>::MessagePtr msg = remap_frames(pool);
+  ASSERT_TRUE(msg);
+  EXPECT_EQ(mapped_joints::names[3], msg->sendupdate_list[3].joint_name);
+
+  sr_remappers::GloveToHandPipeline pipeline(path_to_mapping);
+  ASSERT_TRUE(pipeline.process_calibrated(std::vector<double>(glove_sensors::NB_SENSORS, 0.3)));
+  Remapper::fill(pipeline, *msg);
+  for( unsigned int i = 0; i < mapped_joints::NB_JOINTS; ++i )
+    EXPECT_EQ(pipeline.get_mapped_positions()[i], msg->sendupdate_list[i].joint_target);
+}
+
+TEST(RemapFrame, array)
+{
+  std_msgs::Float64MultiArray prototype;
+  prototype.data.resize(hand_joints::NB_JOINTS);
+  cyberglove::MessagePool<std_msgs::Float64MultiArray> pool(prototype);
+
+  cyberglove::MessagePool<std_msgs::Float64MultiArray>::MessagePtr msg = remap_frames(pool);
+  ASSERT_TRUE(msg);
+
+  sr_remappers::GloveToHandPipeline pipeline(path_to_mapping);
+  ASSERT_TRUE(pipeline.process_calibrated(std::vector<double>(glove_sensors::NB_SENSORS, 0.3)));
+  Remapper::fill(pipeline, *msg);
+  ASSERT_EQ(pipeline.get_hand_positions().size(), msg->data.size());
+  for( unsigned int i = 0; i < hand_joints::NB_JOINTS; ++i )
+    EXPECT_EQ(pipeline.get_hand_positions()[i], msg->data[i]);
+}
+
+TEST(RemapFrame, trajectory)
+{
+  trajectory_msgs::JointTrajectory prototype;
+  prototype.points.resize(1);
+  prototype.points[0].positions.resize(hand_joints::NB_JOINTS);
+  cyberglove::MessagePool<trajectory_msgs::JointTrajectory> pool(prototype);
+
+  cyberglove::MessagePool<trajectory_msgs::JointTrajectory>::MessagePtr msg = remap_frames(pool);
+  ASSERT_TRUE(msg);
+
+  sr_remappers::GloveToHandPipeline pipeline(path_to_mapping);
+  ASSERT_TRUE(pipeline.process_calibrated(std::vector<double>(glove_sensors::NB_SENSORS, 0.3)));
+  Remapper::fill(pipeline, *msg);
+  ASSERT_EQ(1u, msg->points.size());
+  for( unsigned int i = 0; i < hand_joints::NB_JOINTS; ++i )
+    EXPECT_EQ(pipeline.get_hand_positions()[i], msg->points[0].positions[i]);
+}
+
+TEST(RemapFrame, rejectedFrame)
+{
+  sr_remappers::GloveToHandPipeline pipeline(path_to_mapping);
+  cyberglove::MessagePool<std_msgs::Float64MultiArray> pool((std_msgs::Float64MultiArray()));
+  EXPECT_FALSE(Remapper::remap_frame(pipeline, pool, std::vector<double>(3, 0.5)));
+  EXPECT_EQ(0u, pool.size());
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/
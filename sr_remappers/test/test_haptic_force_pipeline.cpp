@@ -0,0 +1,355 @@
+/**
+ * @file   test_haptic_force_pipeline.cpp
+ * @author Shadow Robot's software team <software@shadowrobot.com>
+ *
+*
+* Copyright 2014 Shadow Robot Company Ltd.
+*
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or (at your option)
+* any later version.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+ * @brief Checks the processing of the cybergrasp forces: the mapping, the
+ * deadband, the smoothing, the saturation and the release of the forces on
+ * a timeout, the averaging of the inputs faster than the loop and the ramp
+ * between the inputs slower than it.
+ *
+ */
+
+#include <ros/ros.h>
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <stdint.h>
+
+#include "sr_remappers/haptic_force_pipeline.h"
+
+using namespace sr_remappers;
+
+/// 6 inputs to 5 fingers: finger 0 is input 5, 1 is 4, 2 is 3, 3 is 2 and 4 is 0
+std::string path_to_calibration = "param/test.cal";
+
+double epsilon = 1e-9;
+
+/// no deadband, smoothing, saturation nor interpolation: the forces are the mapped inputs
+HapticForcePipeline::Settings raw_settings()
+{
+  HapticForcePipeline::Settings settings;
+  settings.deadband = 0.0;
+  settings.time_constant = 0.0;
+  settings.max_force = 100.0;
+  settings.interpolating = false;
+  return settings;
+}
+
+/// the same value on all the inputs
+std::vector<double> constant_input(double value)
+{
+  return std::vector<double>(6, value);
+}
+
+TEST(HapticForcePipeline, mapsAndRectifies)
+{
+  HapticForcePipeline pipeline(path_to_calibration, raw_settings());
+  EXPECT_EQ(6u, pipeline.get_calibration().get_nb_inputs());
+  EXPECT_EQ(HapticForcePipeline::nb_fingers, pipeline.get_calibration().get_nb_outputs());
+
+  //no forces before the first input
+  EXPECT_FALSE(pipeline.tick(0.0));
+
+  double values[] = {-0.5, 0.9, 0.1, -0.2, 0.3, 0.4};
+  EXPECT_TRUE(pipeline.add_input(std::vector<double>(values, values + 6), 0.0));
+  EXPECT_TRUE(pipeline.tick(0.01));
+  EXPECT_EQ(1u, pipeline.get_depth());
+  EXPECT_NEAR(0.01, pipeline.get_input_age(), epsilon);
+  EXPECT_FALSE(pipeline.timed_out());
+
+  //the fingers are only pushed: the sign of the data is dropped
+  const double* forces = pipeline.get_forces();
+  EXPECT_NEAR(0.4, forces[0], epsilon);
+  EXPECT_NEAR(0.3, forces[1], epsilon);
+  EXPECT_NEAR(0.2, forces[2], epsilon);
+  EXPECT_NEAR(0.1, forces[3], epsilon);
+  EXPECT_NEAR(0.5, forces[4], epsilon);
+
+  //no new input: the forces are kept
+  EXPECT_TRUE(pipeline.tick(0.02));
+  EXPECT_EQ(0u, pipeline.get_depth());
+  EXPECT_NEAR(0.4, pipeline.get_forces()[0], epsilon);
+}
+
+TEST(HapticForcePipeline, rejectsTheWrongSize)
+{
+  HapticForcePipeline pipeline(path_to_calibration, raw_settings());
+
+  EXPECT_FALSE(pipeline.add_input(std::vector<double>(5, 1.0), 0.0));
+  EXPECT_FALSE(pipeline.add_input(std::vector<double>(7, 1.0), 0.0));
+  EXPECT_FALSE(pipeline.tick(0.01));
+
+  //the tactile pressures are integers
+  std::vector<int16_t> pressures(6, 0);
+  pressures[5] = 3;
+  EXPECT_TRUE(pipeline.add_input(pressures, 0.0));
+  EXPECT_TRUE(pipeline.tick(0.01));
+  EXPECT_NEAR(3.0, pipeline.get_forces()[0], epsilon);
+  EXPECT_NEAR(0.0, pipeline.get_forces()[1], epsilon);
+}
+
+TEST(HapticForcePipeline, deadband)
+{
+  HapticForcePipeline::Settings settings = raw_settings();
+  settings.deadband = 0.1;
+  HapticForcePipeline pipeline(path_to_calibration, settings);
+
+  double values[] = {0.0, 0.0, 0.1, 0.3, 0.05, 0.6};
+  pipeline.add_input(std::vector<double>(values, values + 6), 0.0);
+  pipeline.tick(0.01);
+
+  //the small forces are ignored, the deadband is subtracted from the others
+  const double* forces = pipeline.get_forces();
+  EXPECT_NEAR(0.5, forces[0], epsilon);
+  EXPECT_NEAR(0.0, forces[1], epsilon);
+  EXPECT_NEAR(0.2, forces[2], epsilon);
+  EXPECT_NEAR(0.0, forces[3], epsilon);
+  EXPECT_NEAR(0.0, forces[4], epsilon);
+}
+
+TEST(HapticForcePipeline, lowPass)
+{
+  HapticForcePipeline::Settings settings = raw_settings();
+  settings.rate = 100.0;
+  settings.time_constant = 0.02;
+  HapticForcePipeline pipeline(path_to_calibration, settings);
+
+  //a step, filtered at the loop's rate
+  double alpha = 1.0 - exp(-1.0 / (100.0 * 0.02));
+  pipeline.add_input(constant_input(0.8), 0.0);
+
+  double expected = 0.0;
+  for( unsigned int i = 1; i <= 5; ++i )
+  {
+    pipeline.tick(0.01 * i);
+    expected += alpha * (0.8 - expected);
+    EXPECT_NEAR(expected, pipeline.get_forces()[0], epsilon);
+  }
+  //after 5 time constants, the step is reached
+  for( unsigned int i = 6; i <= 10; ++i )
+    pipeline.tick(0.01 * i);
+  EXPECT_NEAR(0.8, pipeline.get_forces()[0], 0.8 * exp(-5.0) + epsilon);
+}
+
+TEST(HapticForcePipeline, saturation)
+{
+  HapticForcePipeline::Settings settings = raw_settings();
+  settings.max_force = 0.5;
+  HapticForcePipeline pipeline(path_to_calibration, settings);
+
+  double values[] = {-2.0, 0.0, 0.0, 0.0, 0.4, 2.0};
+  pipeline.add_input(std::vector<double>(values, values + 6), 0.0);
+  pipeline.tick(0.01);
+
+  const double* forces = pipeline.get_forces();
+  EXPECT_NEAR(0.5, forces[0], epsilon);
+  EXPECT_NEAR(0.4, forces[1], epsilon);
+  EXPECT_NEAR(0.5, forces[4], epsilon);
+}
+
+TEST(HapticForcePipeline, timeoutReleasesTheForces)
+{
+  HapticForcePipeline::Settings settings = raw_settings();
+  settings.input_timeout = 0.1;
+  HapticForcePipeline pipeline(path_to_calibration, settings);
+
+  pipeline.add_input(constant_input(0.5), 0.0);
+  pipeline.tick(0.01);
+  pipeline.tick(0.09);
+  EXPECT_FALSE(pipeline.timed_out());
+  EXPECT_NEAR(0.5, pipeline.get_forces()[0], epsilon);
+
+  //the hand stopped sending data
+  EXPECT_TRUE(pipeline.tick(0.15));
+  EXPECT_TRUE(pipeline.timed_out());
+  for( unsigned int i = 0; i < HapticForcePipeline::nb_fingers; ++i )
+    EXPECT_NEAR(0.0, pipeline.get_forces()[i], epsilon);
+
+  //and started again
+  pipeline.add_input(constant_input(0.3), 0.5);
+  pipeline.tick(0.51);
+  EXPECT_FALSE(pipeline.timed_out());
+  EXPECT_NEAR(0.3, pipeline.get_forces()[0], epsilon);
+}
+
+TEST(HapticForcePipeline, timeoutScalesWithSlowInputs)
+{
+  HapticForcePipeline::Settings settings = raw_settings();
+  settings.input_timeout = 0.1;
+  settings.timeout_periods = 3.0;
+  HapticForcePipeline pipeline(path_to_calibration, settings);
+
+  //inputs at 5Hz, slower than the timeout: once their period is known (from
+  // the second one), the forces are held between them
+  for( unsigned int i = 0; i < 200; ++i )
+  {
+    double time = i * 0.01;
+    if( i % 20 == 0 )
+      pipeline.add_input(constant_input(0.5), time);
+    pipeline.tick(time);
+    if( i >= 20 )
+    {
+      EXPECT_FALSE(pipeline.timed_out()) << "at " << time << "s";
+      EXPECT_NEAR(0.5, pipeline.get_forces()[0], epsilon) << "at " << time << "s";
+    }
+  }
+  EXPECT_NEAR(0.2, pipeline.get_input_period(), epsilon);
+
+  //the hand stopped sending data: released after 3 periods (the last input was at 1.8s)
+  pipeline.tick(2.35);
+  EXPECT_FALSE(pipeline.timed_out());
+  pipeline.tick(2.45);
+  EXPECT_TRUE(pipeline.timed_out());
+  EXPECT_NEAR(0.0, pipeline.get_forces()[0], epsilon);
+}
+
+TEST(HapticForcePipeline, smoothedRelease)
+{
+  HapticForcePipeline::Settings settings = raw_settings();
+  settings.time_constant = 0.02;
+  settings.input_timeout = 0.1;
+  HapticForcePipeline pipeline(path_to_calibration, settings);
+
+  pipeline.add_input(constant_input(0.5), 0.0);
+  for( unsigned int i = 1; i <= 9; ++i )
+    pipeline.tick(0.01 * i);
+  double held = pipeline.get_forces()[0];
+
+  //on a timeout the forces go to 0 through the filter: no jolt in the fingers
+  pipeline.tick(0.11);
+  EXPECT_TRUE(pipeline.timed_out());
+  EXPECT_LT(0.0, pipeline.get_forces()[0]);
+  EXPECT_GT(held, pipeline.get_forces()[0]);
+}
+
+TEST(HapticForcePipeline, averagesTheInputsBetweenTicks)
+{
+  HapticForcePipeline pipeline(path_to_calibration, raw_settings());
+
+  //3 inputs at 1kHz between two ticks of the 100Hz loop
+  pipeline.add_input(constant_input(0.1), 0.001);
+  pipeline.add_input(constant_input(0.2), 0.002);
+  pipeline.add_input(constant_input(0.6), 0.003);
+  EXPECT_NEAR(0.001, pipeline.get_input_period(), epsilon);
+
+  pipeline.tick(0.01);
+  EXPECT_EQ(3u, pipeline.get_depth());
+  EXPECT_NEAR(0.007, pipeline.get_input_age(), epsilon);
+  EXPECT_NEAR(0.3, pipeline.get_forces()[0], epsilon);
+
+  //the sum restarts from the next input
+  pipeline.add_input(constant_input(0.5), 0.011);
+  pipeline.tick(0.02);
+  EXPECT_EQ(1u, pipeline.get_depth());
+  EXPECT_NEAR(0.5, pipeline.get_forces()[0], epsilon);
+}
+
+TEST(HapticForcePipeline, latestInputWithoutAveraging)
+{
+  HapticForcePipeline::Settings settings = raw_settings();
+  settings.averaging = false;
+  HapticForcePipeline pipeline(path_to_calibration, settings);
+
+  pipeline.add_input(constant_input(0.1), 0.001);
+  pipeline.add_input(constant_input(0.2), 0.002);
+  pipeline.add_input(constant_input(0.6), 0.003);
+
+  pipeline.tick(0.01);
+  EXPECT_EQ(3u, pipeline.get_depth());
+  EXPECT_NEAR(0.6, pipeline.get_forces()[0], epsilon);
+}
+
+TEST(HapticForcePipeline, rampsBetweenSlowInputs)
+{
+  HapticForcePipeline::Settings settings = raw_settings();
+  settings.rate = 100.0;
+  settings.interpolating = true;
+  HapticForcePipeline pipeline(path_to_calibration, settings);
+
+  //the first input is used at once: there's no period yet
+  pipeline.add_input(constant_input(1.0), 0.0);
+  pipeline.tick(0.0);
+  EXPECT_NEAR(1.0, pipeline.get_forces()[0], epsilon);
+
+  //inputs at 20Hz, 5 ticks per input: the forces ramp linearly to the new
+  // input over one input period (50ms)
+  pipeline.add_input(constant_input(2.0), 0.05);
+  EXPECT_NEAR(0.05, pipeline.get_input_period(), epsilon);
+
+  double times[] = {0.05, 0.0625, 0.075, 0.0875, 0.1, 0.11};
+  double expected[] = {1.0, 1.25, 1.5, 1.75, 2.0, 2.0};
+  for( unsigned int i = 0; i < 6; ++i )
+  {
+    pipeline.tick(times[i]);
+    EXPECT_NEAR(expected[i], pipeline.get_forces()[0], epsilon) << "at " << times[i] << "s";
+  }
+
+  //a new input ramps from where the forces are
+  pipeline.add_input(constant_input(0.0), 0.11);
+  pipeline.tick(0.11);
+  EXPECT_NEAR(2.0, pipeline.get_forces()[0], epsilon);
+  //the period is smoothed: 0.9 * 50ms + 0.1 * 60ms
+  double period = 0.051;
+  EXPECT_NEAR(period, pipeline.get_input_period(), epsilon);
+  pipeline.tick(0.11 + period / 2.0);
+  EXPECT_NEAR(1.0, pipeline.get_forces()[0], epsilon);
+}
+
+TEST(HapticForcePipeline, noRampWhenDisabled)
+{
+  HapticForcePipeline::Settings settings = raw_settings();
+  settings.rate = 100.0;
+  settings.interpolating = false;
+  HapticForcePipeline pipeline(path_to_calibration, settings);
+
+  pipeline.add_input(constant_input(1.0), 0.0);
+  pipeline.tick(0.0);
+  pipeline.add_input(constant_input(2.0), 0.05);
+  pipeline.tick(0.05);
+  EXPECT_NEAR(2.0, pipeline.get_forces()[0], epsilon);
+}
+
+TEST(HapticForcePipeline, noRampForFastInputs)
+{
+  HapticForcePipeline::Settings settings = raw_settings();
+  settings.rate = 100.0;
+  settings.interpolating = true;
+  HapticForcePipeline pipeline(path_to_calibration, settings);
+
+  //inputs faster than the loop (period * rate < 1): the new input is used at once
+  pipeline.add_input(constant_input(1.0), 0.0);
+  pipeline.add_input(constant_input(1.0), 0.005);
+  pipeline.tick(0.005);
+  pipeline.add_input(constant_input(2.0), 0.01);
+  pipeline.tick(0.01);
+  EXPECT_NEAR(2.0, pipeline.get_forces()[0], epsilon);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+/* For the emacs weenies in the crowd.
+Local Variables:
+   c-basic-offset: 2
+End:
+*/